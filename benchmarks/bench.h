@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lib/camera.h"
+#include "lib/color.h"
+#include "lib/image.h"
+#include "lib/light.h"
+#include "lib/math.h"
+#include "lib/model.h"
+#include "lib/objdata.h"
+#include "lib/object.h"
+#include "lib/scene.h"
+
+#ifndef SREN_ASSERTS_DIR
+#define SREN_ASSERTS_DIR "../asserts"
+#endif
+
+namespace sren {
+
+namespace bench {
+
+struct ModelInfo {
+  std::string name;
+  std::string file_path;
+  std::string file_ext;
+};
+
+// 用于性能测试的模型
+inline std::vector<ModelInfo> const &Models() {
+  static std::vector<ModelInfo> const models{
+      {"african", "african_head/african_head", "tga"},
+      {"diablo", "diablo3/diablo3_pose", "tga"},
+  };
+  return models;
+}
+
+// 加载模型和贴图，与 main.cc 中的加载方式一致
+inline bool LoadModel(ModelInfo const &info, Object *obj) {
+  auto const prefix = std::string(SREN_ASSERTS_DIR) + "/" + info.file_path;
+  Model model{};
+  if (!LoadObjFile(prefix + ".obj", &model)) {
+    std::fprintf(stderr, "failed to load %s.obj\n", prefix.c_str());
+    return false;
+  }
+  obj->set_model(std::move(model));
+  auto &material = obj->material();
+  auto const ext = "." + info.file_ext;
+  return LoadImage(prefix + "_diffuse" + ext, &material.diffuse_map()) &&
+         LoadImage(prefix + "_spec" + ext, &material.specular_map()) &&
+         LoadImage(prefix + "_nm_tangent" + ext, &material.normal_map());
+}
+
+// 设置与 main.cc 相同的相机和光照
+inline void SetupScene(int width, int height, Scene *scene) {
+  scene->camera().SetLookAt({0, 0, 2}, {0, 0, 0});
+  scene->camera().SetPerspective(Radian(90.0f), float(width) / float(height));
+  scene->lights().dir_lights().emplace_back(
+      Vector3(-3, -3, -3), colors::White(), LightCoefficient{0.1f, 1.0f, 1.0f});
+}
+
+// 从命令行读取整数参数，缺省时返回 def
+inline int IntArg(int argc, char **argv, int i, int def) {
+  return i < argc ? std::atoi(argv[i]) : def;
+}
+
+// 执行 iterations 次 func，返回平均每次耗时（毫秒），正式计时前先预热一次
+template <class Func>
+double TimeMs(int iterations, Func &&func) {
+  func();
+  auto const start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    func();
+  }
+  auto const end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         iterations;
+}
+
+}  // namespace bench
+
+}  // namespace sren
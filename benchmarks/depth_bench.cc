@@ -0,0 +1,106 @@
+// 各深度格式在 1080p 和 4K 下的带宽和耗时：
+// 立即清除整个帧缓冲、全屏多层深度测试与写入，以及渲染模型
+// 用法：depth_bench [次数] [全屏层数]
+
+#include <algorithm>
+#include <cstdio>
+
+#include "bench.h"
+#include "lib/depth.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+#include "lib/simd.h"
+#include "lib/span.h"
+
+using namespace sren;
+
+namespace {
+
+struct Resolution {
+  char const *name;
+  int width;
+  int height;
+};
+
+constexpr Resolution kResolutions[] = {
+    {"1080p", 1920, 1080},
+    {"4K", 3840, 2160},
+};
+
+constexpr DepthFormat kFormats[] = {
+    DepthFormat::kFloat32,
+    DepthFormat::kUnorm24,
+    DepthFormat::kUnorm16,
+};
+
+double ToMB(double bytes) { return bytes / 1048576.0; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 20);
+  int const layers = bench::IntArg(argc, argv, 2, 4);
+  auto const isa = simd::DetectIsa();
+  std::printf("detected isa: %s\n", simd::IsaName(isa));
+
+  for (auto const &res : kResolutions) {
+    std::printf("%s (%dx%d)\n", res.name, res.width, res.height);
+    FrameBuffer fb(res.width, res.height);
+    double const pixels = double(res.width) * res.height;
+    for (auto const format : kFormats) {
+      fb.set_depth_format(format);
+      auto const depth_mb = ToMB(pixels * fb.depth_bytes());
+
+      fb.set_lazy_clear(false);
+      auto const clear_ms = bench::TimeMs(iterations, [&] { fb.Clear(); });
+      fb.set_lazy_clear(true);
+
+      // 由远及近画 layers 层全屏平面，每个像素每层都通过测试并写入深度，
+      // 每次先清除，结果中扣除清除的耗时
+      auto const &kernel = spans::GetKernel(isa, format);
+      int const bytes = fb.depth_bytes();
+      auto const test_ms = bench::TimeMs(iterations, [&] {
+        fb.Clear();
+        fb.Resolve();
+        for (int layer = 0; layer < layers; layer++) {
+          SpanSetup setup{};
+          setup.start[SpanSetup::kZ] = 0.1f + 0.2f * layer;
+          setup.step[SpanSetup::kZ] = 1e-6f;
+          for (int y = 0; y < res.height; y++) {
+            auto const row = fb.depth_row(y);
+            for (int x = 0; x < res.width; x += kernel.lanes) {
+              int const n = std::min(kernel.lanes, res.width - x);
+              auto const depth = row + x * bytes;
+              auto const mask = kernel.depth_test(setup, depth, x, n);
+              kernel.store_depth(setup, depth, x, n, mask);
+            }
+          }
+        }
+      });
+      std::printf(
+          "  %-8s depth %6.2f MB  clear %7.3f ms  %d layers test+store "
+          "%8.3f ms (%7.2f MB/layer)\n",
+          depths::FormatName(format), depth_mb, clear_ms, layers,
+          test_ms - clear_ms, depth_mb * 2);
+    }
+
+    for (auto const &info : bench::Models()) {
+      Scene scene{};
+      bench::SetupScene(res.width, res.height, &scene);
+      if (!bench::LoadModel(info, scene.add_object(info.name))) {
+        return 1;
+      }
+      std::printf("  %-8s", info.name.c_str());
+      for (auto const format : kFormats) {
+        fb.set_depth_format(format);
+        auto const ms = bench::TimeMs(iterations, [&] {
+          scene.Render(&fb);
+          fb.Resolve();
+        });
+        std::printf("  %s %8.3f ms", depths::FormatName(format), ms);
+      }
+      std::printf("\n");
+    }
+  }
+  return 0;
+}
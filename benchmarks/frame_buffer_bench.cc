@@ -0,0 +1,97 @@
+// 帧缓冲清除和半透明混合的耗时，与逐字节存储、浮点混合的实现对比，
+// 以及渲染模型时立即清除和延迟清除每帧的清除写入量
+// 用法：frame_buffer_bench [次数] [宽] [高]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+#include "lib/simd.h"
+#include "lib/span.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 200);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  std::printf("detected isa: %s\n", simd::IsaName(simd::DetectIsa()));
+
+  // 按字节存储颜色时的清除方式
+  std::vector<std::uint8_t> bytes(width * height * 4);
+  std::vector<float> depth(width * height);
+  auto const byte_clear = bench::TimeMs(iterations, [&] {
+    std::fill(bytes.begin(), bytes.end(), 0);
+    std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::min());
+  });
+  FrameBuffer fb(width, height);
+  fb.set_lazy_clear(false);
+  auto const packed_clear = bench::TimeMs(iterations, [&] { fb.Clear(); });
+  fb.set_lazy_clear(true);
+  auto const lazy_clear = bench::TimeMs(iterations, [&] { fb.Clear(); });
+  std::printf("clear   bytes %8.3f ms  packed %8.3f ms  lazy %8.3f ms\n",
+              byte_clear, packed_clear, lazy_clear);
+  fb.Resolve();
+
+  // 整帧以半透明颜色混合一遍
+  auto const src = Color::RGBA(0x40, 0x80, 0xC0, 0x80);
+  auto const float_blend = bench::TimeMs(iterations, [&] {
+    for (int y = 0; y < height; y++) {
+      auto const row = fb.color_row(y);
+      for (int x = 0; x < width; x++) {
+        auto c = src;
+        c.SetBlend(FrameBuffer::UnpackColor(row[x]));
+        c.SetFix();
+        row[x] = FrameBuffer::PackColor(c);
+      }
+    }
+  });
+  std::printf("blend   float %8.3f ms", float_blend);
+  std::uint32_t shaded[spans::kMaxLanes];
+  std::fill(shaded, shaded + spans::kMaxLanes, FrameBuffer::PackColor(src));
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    if (isa > simd::DetectIsa()) {
+      break;
+    }
+    auto const &kernel = spans::GetKernel(isa);
+    unsigned const mask = (1u << kernel.lanes) - 1;
+    auto const ms = bench::TimeMs(iterations, [&] {
+      for (int y = 0; y < height; y++) {
+        auto const row = fb.color_row(y);
+        for (int x = 0; x < width; x += kernel.lanes) {
+          int const n = std::min(kernel.lanes, width - x);
+          kernel.blend_color(shaded, row + x, n, mask);
+        }
+      }
+    });
+    std::printf("  %s %8.3f ms", simd::IsaName(isa), ms);
+  }
+  std::printf("\n");
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    std::printf("%-8s", info.name.c_str());
+    for (bool lazy : {false, true}) {
+      fb.set_lazy_clear(lazy);
+      auto const ms = bench::TimeMs(iterations / 10 + 1, [&] {
+        scene.Render(&fb);
+      });
+      auto const rendered = fb.ClearedBytes();
+      fb.Resolve();
+      std::printf("  %s %8.3f ms/frame %7.2f MB cleared (%.2f MB presented)",
+                  lazy ? "lazy" : "eager", ms, rendered / 1048576.0,
+                  fb.ClearedBytes() / 1048576.0);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
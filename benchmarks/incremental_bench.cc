@@ -0,0 +1,70 @@
+// 增量渲染的收益：静止的模型旁有一个旋转的小立方体，
+// 比较每帧整帧重绘与只重绘改变区域的耗时，以及完全静止时的耗时，
+// 前向着色和延迟着色分别测量
+// 用法：incremental_bench [次数] [宽] [高]
+
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.h"
+#include "lib/damage.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 50);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  double const pixels = double(width) * height;
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    Model cube_model{};
+    if (!LoadObjFile(std::string(SREN_ASSERTS_DIR) + "/cube/cube.obj",
+                     &cube_model)) {
+      return 1;
+    }
+    for (auto &c : cube_model.colors()) {
+      c = colors::Red();
+    }
+    auto const cube = scene.add_object("cube");
+    cube->set_model(std::move(cube_model));
+    cube->set_render_style(kRenderColor);
+    cube->transform().set_world_pos({1.6f, 1.0f, -1.0f});
+
+    FrameBuffer fb(width, height);
+    std::printf("%-8s\n", info.name.c_str());
+    for (auto shading : {Shading::kForward, Shading::kDeferred}) {
+      scene.set_shading(shading);
+      for (bool incremental : {false, true}) {
+        scene.set_incremental(incremental);
+        float angle = 0;
+        std::int64_t redrawn = 0;
+        auto const moving_ms = bench::TimeMs(iterations, [&] {
+          angle += 0.05f;
+          cube->transform().set_rotation({angle, angle, 0});
+          scene.Render(&fb);
+          fb.Resolve();
+          redrawn += rects::Area(scene.redrawn());
+        });
+        auto const static_ms = bench::TimeMs(iterations, [&] {
+          scene.Render(&fb);
+          fb.Resolve();
+        });
+        std::printf(
+            "  %-8s %-11s moving cube %8.3f ms/frame (redrawn %6.2f%%)  "
+            "static %8.3f ms/frame\n",
+            shading == Shading::kForward ? "forward" : "deferred",
+            incremental ? "incremental" : "full", moving_ms,
+            100.0 * redrawn / ((iterations + 1) * pixels), static_ms);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+// 工作窃取线程池的扩展性测试：场景中放置不同数量的同一个模型，
+// 每帧重新设置所有物体的变换，比较不同线程数下每帧的耗时。
+// 裁剪矩形为空，不写入像素，耗时主要是逐物体的顶点阶段。
+// 最后测量任务图的调度开销：依次执行的空任务链和并行的空任务
+// 用法：job_bench [帧数] [最大线程数]，最大线程数缺省为硬件线程数
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/object.h"
+#include "lib/scene.h"
+#include "lib/thread_pool.h"
+
+using namespace sren;
+
+namespace {
+
+// 在相机前方按网格排列 n 个物体，物体多时向远处排列
+void PlaceObjects(Scene *scene, Model const &model, int n) {
+  int const side = int(std::ceil(std::sqrt(float(n))));
+  for (int i = 0; i < n; i++) {
+    auto const obj = i == 0 ? scene->object(0) : scene->add_object("copy");
+    if (i > 0) {
+      obj->set_model(model);
+    }
+    float const x = (i % side - (side - 1) * 0.5f) * 1.2f;
+    float const y = (i / side - (side - 1) * 0.5f) * 1.2f;
+    obj->transform().set_world_pos({x, y, -0.3f * float(side - 1)});
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 50);
+  int const max_threads =
+      bench::IntArg(argc, argv, 2, ThreadPool::HardwareThreads());
+  std::vector<int> nthreads{};
+  for (int n = 1; n < max_threads; n *= 2) {
+    nthreads.push_back(n);
+  }
+  nthreads.push_back(max_threads);
+
+  for (auto const &info : bench::Models()) {
+    for (int const nobjects : {1, 4, 16, 64}) {
+      Scene scene{};
+      bench::SetupScene(800, 600, &scene);
+      if (!bench::LoadModel(info, scene.add_object(info.name))) {
+        return 1;
+      }
+      PlaceObjects(&scene, scene.object(0)->model(), nobjects);
+      FrameBuffer fb(800, 600);
+      fb.set_scissor({});
+      double serial_ms = 0.0;
+      for (auto const n : nthreads) {
+        scene.set_nthreads(n);
+        // 重新设置相同的旋转只改变版本，所有物体都需要重新变换
+        auto const ms = bench::TimeMs(frames, [&] {
+          for (int i = 0; i < scene.nobjects(); i++) {
+            auto &transform = scene.object(i)->transform();
+            transform.set_rotation(transform.rotation());
+          }
+          scene.Render(&fb);
+        });
+        serial_ms = n == 1 ? ms : serial_ms;
+        std::printf("%-8s %2d objects %2d threads %8.3f ms/frame  x%.2f\n",
+                    info.name.c_str(), nobjects, n, ms, serial_ms / ms);
+      }
+    }
+  }
+
+  // 调度开销：每个任务依赖前一个任务的链，以及没有依赖的一组任务
+  int const ntasks = 256;
+  for (auto const n : nthreads) {
+    ThreadPool pool(n);
+    TaskGraph chain{};
+    TaskGraph wide{};
+    for (int i = 0; i < ntasks; i++) {
+      chain.Add([] {});
+      wide.Add([] {});
+      if (i > 0) {
+        chain.Precede(i - 1, i);
+      }
+    }
+    auto const chain_ms = bench::TimeMs(frames, [&] { pool.Run(&chain); });
+    auto const wide_ms = bench::TimeMs(frames, [&] { pool.Run(&wide); });
+    std::printf("graph %2d threads  chain %7.2f us/task  wide %7.2f us/task\n",
+                n, chain_ms * 1000.0 / ntasks, wide_ms * 1000.0 / ntasks);
+  }
+  return 0;
+}
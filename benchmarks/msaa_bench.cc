@@ -0,0 +1,68 @@
+// 多重采样抗锯齿的开销：渲染模型时单采样与 4 倍采样每帧的耗时和清除写入量，
+// 各采样点颜色分开存放的边缘像素比例，以及各指令集下解析颜色的耗时
+// 用法：msaa_bench [次数] [宽] [高]
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+#include "lib/simd.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 20);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  std::printf("detected isa: %s\n", simd::IsaName(simd::DetectIsa()));
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    FrameBuffer fb(width, height);
+    std::printf("%-8s\n", info.name.c_str());
+    for (int samples : {1, FrameBuffer::kMaxSamples}) {
+      fb.set_samples(samples);
+      std::uint64_t cleared = 0;
+      auto const ms = bench::TimeMs(iterations, [&] {
+        scene.Render(&fb);
+        cleared = fb.ClearedBytes();
+        fb.Resolve();
+      });
+      int edges = 0;
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          edges += fb.multi_color(x, y) ? 1 : 0;
+        }
+      }
+      std::printf(
+          "  %dx: %8.3f ms/frame  cleared %7.2f MB  multi-color pixels "
+          "%6d (%.2f%%)\n",
+          samples, ms, cleared / 1048576.0, edges,
+          100.0 * edges / (double(width) * height));
+    }
+  }
+
+  // 整帧的所有像素都需要取平均时解析的耗时
+  int const pixels = width * height;
+  std::vector<std::uint32_t> src(pixels * 4);
+  std::vector<std::uint32_t> dst(pixels);
+  for (int i = 0; i < int(src.size()); i++) {
+    src[i] = std::uint32_t(i) * 2654435761u;
+  }
+  std::printf("resolve %d pixels:", pixels);
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    auto const ms = bench::TimeMs(iterations, [&] {
+      simd::Average4x32(src.data(), dst.data(), pixels, isa);
+    });
+    std::printf("  %s %7.3f ms", simd::IsaName(isa), ms);
+  }
+  std::printf("\n");
+  return 0;
+}
@@ -0,0 +1,66 @@
+// 多视图渲染：四个相机各占帧缓冲的四分之一，比较一次渲染所有视口，
+// 与分别渲染到单独的帧缓冲后再拷贝到一起的耗时
+// 用法：multiview_bench [次数] [宽] [高]
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 20);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  int const w = width / 2;
+  int const h = height / 2;
+  Vector3 const positions[] = {
+      {0, 0, 2}, {2, 0, 0}, {0, 2, 0.01f}, {-2, 0, 0}};
+
+  std::vector<View> views{};
+  for (int i = 0; i < 4; i++) {
+    View view{};
+    view.camera.SetLookAt(positions[i], {0, 0, 0});
+    view.camera.SetPerspective(Radian(90.0f), float(w) / float(h));
+    view.viewport = {i % 2 * w, i / 2 * h, i % 2 * w + w, i / 2 * h + h};
+    views.push_back(view);
+  }
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    FrameBuffer fb(width, height);
+    auto const views_ms = bench::TimeMs(iterations, [&] {
+      scene.RenderViews(&fb, views);
+      fb.Resolve();
+    });
+
+    FrameBuffer single(w, h);
+    auto const copy_ms = bench::TimeMs(iterations, [&] {
+      fb.Clear();
+      for (auto const &view : views) {
+        scene.camera() = view.camera;
+        scene.Render(&single);
+        single.Resolve();
+        auto const &r = view.viewport;
+        fb.Touch(r);
+        for (int y = 0; y < h; y++) {
+          std::memcpy(fb.color_row(r.y0 + y) + r.x0, single.color_row(y),
+                      w * sizeof(std::uint32_t));
+        }
+      }
+      fb.Resolve();
+    });
+    std::printf(
+        "%-8s 4 views: one frame buffer %8.3f ms  separate + copy %8.3f ms\n",
+        info.name.c_str(), views_ms, copy_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+// 渲染与呈现流水线在不同在途帧数下的吞吐。呈现阶段用拷贝到纹理内存
+// 加上固定的等待时间模拟上传和交换缓冲
+// 用法：pipeline_bench [帧数] [呈现等待毫秒] [宽] [高]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_pipeline.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 100);
+  int const present_wait = bench::IntArg(argc, argv, 2, 4);
+  int const width = bench::IntArg(argc, argv, 3, 800);
+  int const height = bench::IntArg(argc, argv, 4, 600);
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    std::vector<std::uint8_t> texture(width * height * 4);
+    std::printf("%-8s\n", info.name.c_str());
+    for (int latency = 1; latency <= FramePipeline::kMaxLatency; latency++) {
+      FramePipeline pipeline;
+      pipeline.Resize(width, height, YOrigin::kTop);
+      pipeline.set_latency(latency);
+      pipeline.set_render_func([&](FrameBuffer *fb) { scene.Render(fb); });
+      auto const ms = bench::TimeMs(frames, [&] {
+        pipeline.Sync();
+        pipeline.Submit();
+        if (auto const fb = pipeline.Acquire()) {
+          fb->Resolve();
+          for (int y = 0; y < height; y++) {
+            std::memcpy(&texture[y * width * 4],
+                        fb->data() + y * fb->stride() * 4, width * 4);
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(present_wait));
+          pipeline.Release(fb);
+        }
+      });
+      auto const &stats = pipeline.stats();
+      std::printf(
+          "  latency %d: %8.3f ms/frame  render %7.3f  present %7.3f  "
+          "overlap x%.2f\n",
+          latency, ms, stats.render_ms, stats.present_ms, stats.overlap());
+    }
+  }
+  return 0;
+}
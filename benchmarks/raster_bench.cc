@@ -0,0 +1,34 @@
+// 梯形扫描线光栅化与半空间光栅化的对比测试
+// 用法：raster_bench [帧数] [宽] [高]
+
+#include <cstdio>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/render_style.h"
+#include "lib/scene.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 50);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    FrameBuffer fb(width, height);
+
+    scene.set_rasterizer(Rasterizer::kTrapezoid);
+    auto const trap_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+    scene.set_rasterizer(Rasterizer::kHalfSpace);
+    auto const half_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+    std::printf("%-8s trapezoid %8.3f ms/frame  half-space %8.3f ms/frame  x%.2f\n",
+                info.name.c_str(), trap_ms, half_ms, trap_ms / half_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+// 前向着色与延迟着色的对比测试
+// 用法：shading_bench [帧数] [宽] [高] [线程数]
+
+#include <cstdio>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/render_style.h"
+#include "lib/scene.h"
+#include "lib/thread_pool.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 50);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  int const nthreads =
+      bench::IntArg(argc, argv, 4, ThreadPool::HardwareThreads());
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    scene.set_tiled(nthreads > 1);
+    scene.set_nthreads(nthreads);
+    FrameBuffer fb(width, height);
+
+    scene.set_shading(Shading::kForward);
+    auto const forward_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+    scene.set_shading(Shading::kDeferred);
+    auto const deferred_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+    std::printf("%-8s forward %8.3f ms/frame  deferred %8.3f ms/frame  x%.2f\n",
+                info.name.c_str(), forward_ms, deferred_ms,
+                forward_ms / deferred_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+// 扫描线着色内核在各指令集下的对比测试
+// 用法：span_bench [帧数] [宽] [高]
+
+#include <cstdio>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+#include "lib/simd.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 50);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+
+  std::printf("detected isa: %s\n", simd::IsaName(simd::DetectIsa()));
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    FrameBuffer fb(width, height);
+
+    std::printf("%-8s", info.name.c_str());
+    for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      if (isa > simd::DetectIsa()) {
+        break;
+      }
+      scene.set_simd_isa(isa);
+      auto const ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+      std::printf("  %s %8.3f ms/frame", simd::IsaName(isa), ms);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
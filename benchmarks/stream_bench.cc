@@ -0,0 +1,98 @@
+// 1080p 下录制每一帧的开销：逐帧编码保存图片与连续写入原始 RGBA 和 Y4M 流，
+// 流分别通过 fwrite 和内存映射写入，以及边渲染边写入时每帧增加的耗时，
+// 与 60 帧每秒的 16.7 毫秒预算比较
+// 用法：stream_bench [帧数] [输出文件]
+
+#include <cstdio>
+#include <string>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/frame_stream.h"
+#include "lib/image.h"
+#include "lib/scene.h"
+
+using namespace sren;
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr double kBudgetMs = 1000.0 / 60.0;
+
+double ToMB(double bytes) { return bytes / 1048576.0; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 120);
+  std::string const out = argc > 2 ? argv[2] : "stream_bench.out";
+
+  auto const &info = bench::Models().front();
+  Scene scene{};
+  bench::SetupScene(kWidth, kHeight, &scene);
+  if (!bench::LoadModel(info, scene.add_object(info.name))) {
+    return 1;
+  }
+  FrameBuffer fb(kWidth, kHeight);
+  fb.set_y_origin(YOrigin::kTop);
+  scene.Render(&fb);
+  std::printf("%s %dx%d, %d frames, budget %.2f ms/frame\n",
+              info.name.c_str(), kWidth, kHeight, frames, kBudgetMs);
+
+  // 逐帧编码保存图片，PNG 很慢，只保存少量几帧
+  for (auto const ext : {".ppm", ".png"}) {
+    auto const path = out + ext;
+    auto const ms = bench::TimeMs(ext[2] == 'n' ? 3 : 10,
+                                  [&] { SaveImage(path, &fb); });
+    std::printf("  image %-4s %8.3f ms/frame\n", ext + 1, ms);
+    std::remove(path.c_str());
+  }
+
+  // 不渲染，只写入同一帧，测流本身的吞吐。计时包括打开文件和 Close 等待全部写完
+  for (auto const format : {StreamFormat::kRgba, StreamFormat::kY4m}) {
+    for (bool mmap : {false, true}) {
+      FrameStream stream;
+      stream.set_mmap(mmap);
+      bool ok = true;
+      auto const ms = bench::TimeMs(1, [&] {
+        ok = stream.Open(out, kWidth, kHeight, format);
+        for (int i = 0; ok && i < frames; i++) {
+          ok = stream.Write(&fb);
+        }
+        ok = stream.Close() && ok;
+      }) / frames;
+      if (!ok) {
+        std::fprintf(stderr, "failed to write %s\n", out.c_str());
+        return 1;
+      }
+      auto const stats = stream.stats();
+      std::printf(
+          "  %-4s %-6s %8.3f ms/frame  %6.1f fps  %7.1f MB/s  copy %6.3f  "
+          "stall %6.3f  writer %6.3f\n",
+          format == StreamFormat::kRgba ? "rgba" : "y4m",
+          mmap ? "mmap" : "fwrite", ms, 1000.0 / ms,
+          ToMB(double(stream.frame_bytes())) * 1000.0 / ms, stats.copy_ms,
+          stats.stall_ms, stats.write_ms);
+    }
+  }
+
+  // 边渲染边写入 Y4M，写线程与渲染重叠时每帧增加的只有拷贝和等待
+  auto const render_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+  FrameStream stream;
+  if (!stream.Open(out, kWidth, kHeight, StreamFormat::kY4m)) {
+    return 1;
+  }
+  auto const record_ms = bench::TimeMs(frames, [&] {
+    scene.Render(&fb);
+    stream.Write(&fb);
+  });
+  stream.Close();
+  std::printf(
+      "  render %8.3f ms/frame  render+y4m %8.3f ms/frame  overhead %6.3f  "
+      "%s 60 fps\n",
+      render_ms, record_ms, record_ms - render_ms,
+      record_ms <= kBudgetMs ? "within" : "over");
+  std::remove(out.c_str());
+  return 0;
+}
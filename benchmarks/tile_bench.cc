@@ -0,0 +1,47 @@
+// 分块多线程光栅化的线程数扩展性测试
+// 用法：tile_bench [帧数] [宽] [高]
+
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "lib/frame_buffer.h"
+#include "lib/scene.h"
+#include "lib/thread_pool.h"
+
+using namespace sren;
+
+int main(int argc, char **argv) {
+  int const frames = bench::IntArg(argc, argv, 1, 50);
+  int const width = bench::IntArg(argc, argv, 2, 800);
+  int const height = bench::IntArg(argc, argv, 3, 600);
+  int const max_threads = ThreadPool::HardwareThreads();
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(width, height, &scene);
+    if (!bench::LoadModel(info, scene.add_object(info.name))) {
+      return 1;
+    }
+    FrameBuffer fb(width, height);
+
+    auto const serial_ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+    std::printf("%-8s serial          %8.3f ms/frame\n", info.name.c_str(),
+                serial_ms);
+
+    std::vector<int> nthreads{};
+    for (int n = 1; n < max_threads; n *= 2) {
+      nthreads.push_back(n);
+    }
+    nthreads.push_back(max_threads);
+
+    scene.set_tiled(true);
+    for (auto const n : nthreads) {
+      scene.set_nthreads(n);
+      auto const ms = bench::TimeMs(frames, [&] { scene.Render(&fb); });
+      std::printf("%-8s tiled %2d threads %8.3f ms/frame  x%.2f\n",
+                  info.name.c_str(), n, ms, serial_ms / ms);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+// 顶点变换的耗时：逐个顶点用 Vector4 * Matrix4x4 变换 AoS 数组，
+// 与各指令集下批量变换 SoA 顶点流比较。每帧的变换与渲染时相同：
+// 法线乘旋转矩阵，顶点乘模型矩阵，再乘相机矩阵。
+// 整个顶点阶段还包括裁剪标记、透视除法和视口变换，比较逐步处理 AoS 数组
+// 与单遍处理的耗时。三角形设置读取顶点时，比较每次从各个数组收集顶点的属性
+// 与先组装好共用的顶点再按下标读取的耗时。最后比较不写入像素时，
+// 静止的物体与每帧重新设置变换的物体每帧的耗时，
+// 静止的物体沿用上一帧的变换结果，没有顶点阶段。
+// 背面剔除比较逐个求法线与批量求有向面积的耗时
+// 用法：vertex_bench [次数]
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "lib/clip.h"
+#include "lib/frame_buffer.h"
+#include "lib/object.h"
+#include "lib/scene.h"
+#include "lib/simd.h"
+#include "lib/vertex_stream.h"
+
+using namespace sren;
+
+namespace {
+
+void ApplyToAll(Matrix4x4 const &m, std::vector<Vector4> *vs) {
+  for (auto &v : *vs) {
+    v = v * m;
+  }
+}
+
+// 三角形设置读取顶点的方式：背面剔除求法线读 4 次，光栅化复制 3 个顶点
+template <class GetVertex>
+float SetupTriangles(int nfaces, GetVertex &&get) {
+  float sum = 0.0f;
+  for (int f = 0; f < nfaces; f++) {
+    auto const p0 = get(f, 0).pos().AsVector3();
+    auto const e1 = get(f, 1).pos().AsVector3() - p0;
+    auto const e2 = get(f, 2).pos().AsVector3() - get(f, 0).pos().AsVector3();
+    std::array<Vertex, 3> const verts{get(f, 0), get(f, 1), get(f, 2)};
+    sum += (e1 ^ e2).z() + verts[0].uv().x() + verts[1].color().r() +
+           verts[2].normal().z();
+  }
+  return sum;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int const iterations = bench::IntArg(argc, argv, 1, 200);
+  std::printf("detected isa: %s\n", simd::IsaName(simd::DetectIsa()));
+
+  for (auto const &info : bench::Models()) {
+    Scene scene{};
+    bench::SetupScene(800, 600, &scene);
+    auto const obj = scene.add_object(info.name);
+    if (!bench::LoadModel(info, obj)) {
+      return 1;
+    }
+    auto const &model = obj->model();
+    auto const &transform = obj->transform();
+    auto const &camera = scene.camera();
+    std::printf("%-8s %d vertexs %d normals\n", info.name.c_str(),
+                int(model.vertexs().size()), int(model.normals().size()));
+
+    std::vector<Vector4> world;
+    std::vector<Vector4> normals;
+    std::vector<Vector4> trans;
+    auto const aos_ms = bench::TimeMs(iterations, [&] {
+      vectors::CopyFrom3To4(model.vertexs(), &world);
+      vectors::CopyFrom3To4(model.normals(), &normals);
+      ApplyToAll(transform.rotate_matrix(), &normals);
+      ApplyToAll(transform.model_matrix(), &world);
+      trans = world;
+      ApplyToAll(camera.transform_matrix(), &trans);
+    });
+    std::printf("  transform aos        %8.4f ms\n", aos_ms);
+
+    VertexStream world_s;
+    VertexStream normals_s;
+    VertexStream trans_s;
+    for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      auto const ms = bench::TimeMs(iterations, [&] {
+        world_s.Assign(model.vertexs(), 1.0f);
+        normals_s.Assign(model.normals(), 1.0f);
+        normals_s.Transform(transform.rotate_matrix(), isa);
+        world_s.Transform(transform.model_matrix(), isa);
+        world_s.TransformTo(camera.transform_matrix(), &trans_s, isa);
+      });
+      std::printf("  transform soa %-6s %8.4f ms  x%.2f\n",
+                  simd::IsaName(isa), ms, aos_ms / ms);
+    }
+
+    // 原来的顶点阶段：复制并逐步变换后，再逐个求裁剪标记并投影到屏幕
+    ViewportTransform viewport{};
+    viewport.scale = {400.0f, 300.0f, 1.0f};
+    viewport.offset = {400.0f, 300.0f, 0.0f};
+    std::vector<Vector4> clip;
+    std::vector<unsigned> codes;
+    auto const stage_ms = bench::TimeMs(iterations, [&] {
+      vectors::CopyFrom3To4(model.vertexs(), &world);
+      vectors::CopyFrom3To4(model.normals(), &normals);
+      ApplyToAll(transform.rotate_matrix(), &normals);
+      ApplyToAll(transform.model_matrix(), &world);
+      trans = world;
+      ApplyToAll(camera.transform_matrix(), &trans);
+      clip = trans;
+      codes.resize(clip.size());
+      for (int i = 0; i < int(clip.size()); i++) {
+        codes[i] = clips::Outcode(clip[i]);
+        if (!(codes[i] & kClipNear)) {
+          trans[i] = viewport.Apply(trans[i]);
+        }
+      }
+    });
+    std::printf("  stage aos            %8.4f ms\n", stage_ms);
+    auto const mvp = transform.model_matrix() * camera.transform_matrix();
+    VertexStream clip_s;
+    for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      auto const ms = bench::TimeMs(iterations, [&] {
+        obj->model_normals().TransformTo(transform.rotate_matrix(), &normals_s,
+                                         isa);
+        vertexs::Project(obj->model_vertexs(), transform.model_matrix(), mvp,
+                         viewport, &world_s, &clip_s, &trans_s, &codes, isa);
+      });
+      std::printf("  stage fused %-6s   %8.4f ms  x%.2f\n", simd::IsaName(isa),
+                  ms, stage_ms / ms);
+    }
+
+    // 每次读取时从顶点、颜色、纹理坐标和法线数组收集一个顶点
+    // 结果写入 volatile 变量，避免读取被优化掉
+    volatile float sink = 0.0f;
+    auto const gather_ms = bench::TimeMs(iterations, [&] {
+      sink += SetupTriangles(model.nfaces(), [&](int f, int i) {
+        auto const &index = model.face_index(f, i);
+        return Vertex{trans_s[index.vertex], world_s[index.vertex],
+                      model.colors()[index.vertex], model.uvs()[index.uv],
+                      normals_s[index.normal]};
+      });
+    });
+    std::printf("  setup gather         %8.4f ms\n", gather_ms);
+    auto const &polygons = obj->polygons();
+    std::vector<Vertex> assembled;
+    auto const assembled_ms = bench::TimeMs(iterations, [&] {
+      vertexs::Assemble(obj->unique_indexs(), trans_s, world_s, normals_s,
+                        model, &assembled);
+      sink += SetupTriangles(model.nfaces(),
+                             [&](int f, int i) -> Vertex const & {
+                               return assembled[polygons[f].index(i)];
+                             });
+    });
+    std::printf("  setup assembled      %8.4f ms  x%.2f  %d of %d vertexs\n",
+                assembled_ms, gather_ms / assembled_ms,
+                int(obj->unique_indexs().size()), model.nfaces() * 3);
+
+    // 裁剪矩形为空时不写入像素，耗时主要是顶点阶段。
+    // 重新设置相同的旋转只改变版本，物体需要重新变换
+    FrameBuffer fb(800, 600);
+    fb.set_scissor({});
+    auto const moving_ms = bench::TimeMs(iterations, [&] {
+      obj->transform().set_rotation(transform.rotation());
+      scene.Render(&fb);
+    });
+    auto const static_ms =
+        bench::TimeMs(iterations, [&] { scene.Render(&fb); });
+    std::printf("  frame moving         %8.4f ms  static %8.4f ms  x%.2f\n",
+                moving_ms, static_ms, moving_ms / static_ms);
+
+    // 背面剔除：逐个多边形求归一化的法线，与按索引缓冲批量求有向面积比较，
+    // 两者都输出可见的面的下标
+    auto const &polys = obj->polygons();
+    int const npolys = int(polys.size());
+    std::vector<int> visible;
+    auto const normal_ms = bench::TimeMs(iterations, [&] {
+      visible.clear();
+      for (int i = 0; i < npolys; i++) {
+        if (polys[i].normal() * Vector3(0, 0, 1) < 0) {
+          visible.push_back(i);
+        }
+      }
+    });
+    std::printf("  cull normal          %8.4f ms  %d of %d culled\n", normal_ms,
+                npolys - int(visible.size()), npolys);
+    auto const &screen = obj->trans_vertexs();
+    std::vector<float> areas(npolys);
+    for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      auto const ms = bench::TimeMs(iterations, [&] {
+        simd::SignedAreas(screen.component(0), screen.component(1),
+                          obj->vertex_indexs().data(), npolys, areas.data(),
+                          isa);
+        visible.clear();
+        for (int i = 0; i < npolys; i++) {
+          if (areas[i] < 0) {
+            visible.push_back(i);
+          }
+        }
+      });
+      std::printf("  cull batch %-6s    %8.4f ms  x%.2f\n", simd::IsaName(isa),
+                  ms, normal_ms / ms);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,236 @@
+// 离屏渲染模型并保存为图片序列
+// 用法：headless <模型路径前缀> [选项]
+//   --frames N          渲染的帧数，默认 60
+//   --size WxH          图像大小，默认 800x600
+//   --out PATTERN       输出路径的 printf 格式，如 out/%04d.png，默认不保存
+//   --stream PATH       所有帧依次写入一个文件，.rgba 为原始 RGBA，其他为 Y4M，
+//                       - 为以 Y4M 写到标准输出，如 --stream - | ffmpeg -i - out.mp4
+//   --buffers N         写入流的环形缓冲个数，默认 3
+//   --mmap              流写入普通文件时使用内存映射
+//   --path orbit|spin|none
+//                       相机绕模型旋转、模型自转或静止，默认 orbit
+//   --texture-ext EXT   贴图扩展名，默认 tga
+//   --depth FORMAT      深度格式 float32、unorm24 或 unorm16，默认 float32
+//   --msaa              4 倍多重采样抗锯齿
+//   --half-space        使用 half-space 光栅化
+//   --deferred          使用延迟着色
+//   --tiled             分块渲染
+//   --threads N         分块渲染的线程数
+// 模型路径前缀如 asserts/african_head/african_head，
+// 贴图按 main.cc 的约定从 _diffuse、_spec 和 _nm_tangent 后缀的文件中加载
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "lib/camera.h"
+#include "lib/color.h"
+#include "lib/depth.h"
+#include "lib/headless.h"
+#include "lib/image.h"
+#include "lib/light.h"
+#include "lib/math.h"
+#include "lib/model.h"
+#include "lib/objdata.h"
+#include "lib/object.h"
+#include "lib/render_style.h"
+#include "lib/scene.h"
+
+using namespace sren;
+
+namespace {
+
+Vector3 const kObjectPos = {0, 0, 0};
+float const kCameraDistance = 2.0f;
+Vector3 const kLightDir = {-3, -3, -3};
+LightCoefficient const kCoefficient = {
+    0.1f,  // ambient
+    1.0f,  // diffuse
+    1.0f,  // specular
+};
+
+enum class Path { kNone, kOrbit, kSpin };
+
+struct Options {
+  std::string model{};
+  std::string texture_ext{"tga"};
+  std::string out{};
+  std::string stream{};
+  int buffers{3};
+  bool mmap{};
+  int frames{60};
+  int width{800};
+  int height{600};
+  Path path{Path::kOrbit};
+  DepthFormat depth_format{DepthFormat::kFloat32};
+  bool msaa{};
+  bool half_space{};
+  bool deferred{};
+  bool tiled{};
+  int threads{1};
+};
+
+void PrintUsage(char const *name) {
+  std::fprintf(stderr,
+               "usage: %s <model prefix> [--frames N] [--size WxH] "
+               "[--out PATTERN] [--stream PATH] [--buffers N] [--mmap] "
+               "[--path orbit|spin|none] [--texture-ext EXT] "
+               "[--depth FORMAT] [--msaa] [--half-space] [--deferred] "
+               "[--tiled] [--threads N]\n",
+               name);
+}
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    std::string const arg = argv[i];
+    auto const has_value = i + 1 < argc;
+    if (arg == "--frames" && has_value) {
+      options->frames = std::atoi(argv[++i]);
+    } else if (arg == "--size" && has_value) {
+      if (std::sscanf(argv[++i], "%dx%d", &options->width, &options->height) !=
+          2) {
+        return false;
+      }
+    } else if (arg == "--out" && has_value) {
+      options->out = argv[++i];
+    } else if (arg == "--stream" && has_value) {
+      options->stream = argv[++i];
+    } else if (arg == "--buffers" && has_value) {
+      options->buffers = std::atoi(argv[++i]);
+    } else if (arg == "--mmap") {
+      options->mmap = true;
+    } else if (arg == "--path" && has_value) {
+      std::string const path = argv[++i];
+      if (path == "orbit") {
+        options->path = Path::kOrbit;
+      } else if (path == "spin") {
+        options->path = Path::kSpin;
+      } else if (path == "none") {
+        options->path = Path::kNone;
+      } else {
+        return false;
+      }
+    } else if (arg == "--texture-ext" && has_value) {
+      options->texture_ext = argv[++i];
+    } else if (arg == "--depth" && has_value) {
+      std::string const name = argv[++i];
+      int f = 0;
+      while (f < kDepthFormatCount &&
+             name != depths::FormatName(DepthFormat(f))) {
+        f++;
+      }
+      if (f == kDepthFormatCount) {
+        return false;
+      }
+      options->depth_format = DepthFormat(f);
+    } else if (arg == "--msaa") {
+      options->msaa = true;
+    } else if (arg == "--half-space") {
+      options->half_space = true;
+    } else if (arg == "--deferred") {
+      options->deferred = true;
+    } else if (arg == "--tiled") {
+      options->tiled = true;
+    } else if (arg == "--threads" && has_value) {
+      options->threads = std::atoi(argv[++i]);
+    } else if (arg[0] != '-' && options->model.empty()) {
+      options->model = arg;
+    } else {
+      return false;
+    }
+  }
+  return !options->model.empty() && options->frames > 0 &&
+         options->width > 0 && options->height > 0 && options->threads > 0 &&
+         options->buffers > 0;
+}
+
+bool LoadModel(Options const &options, Object *obj) {
+  auto const &prefix = options.model;
+  Model model{};
+  if (!LoadObjFile(prefix + ".obj", &model)) {
+    std::fprintf(stderr, "failed to load %s.obj\n", prefix.c_str());
+    return false;
+  }
+  obj->set_model(std::move(model));
+  obj->transform().set_world_pos(kObjectPos);
+  auto &material = obj->material();
+  auto const ext = "." + options.texture_ext;
+  if (!LoadImage(prefix + "_diffuse" + ext, &material.diffuse_map())) {
+    std::fprintf(stderr, "failed to load %s_diffuse%s\n", prefix.c_str(),
+                 ext.c_str());
+    return false;
+  }
+  // 高光和法线贴图是可选的
+  LoadImage(prefix + "_spec" + ext, &material.specular_map());
+  LoadImage(prefix + "_nm_tangent" + ext, &material.normal_map());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options{};
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  Scene scene{};
+  scene.camera().SetLookAt(kObjectPos + Vector3(0, 0, kCameraDistance),
+                           kObjectPos);
+  scene.camera().SetPerspective(Radian(90.0f),
+                                float(options.width) / float(options.height));
+  scene.lights().dir_lights().emplace_back(kLightDir, colors::White(),
+                                           kCoefficient);
+  scene.set_rasterizer(options.half_space ? Rasterizer::kHalfSpace
+                                          : Rasterizer::kTrapezoid);
+  scene.set_shading(options.deferred ? Shading::kDeferred : Shading::kForward);
+  scene.set_tiled(options.tiled);
+  scene.set_nthreads(options.threads);
+  auto const obj = scene.add_object("model");
+  if (!LoadModel(options, obj)) {
+    return 1;
+  }
+
+  Headless headless(options.width, options.height);
+  headless.set_output(options.out);
+  headless.set_stream(options.stream);
+  headless.stream().set_buffers(options.buffers);
+  headless.stream().set_mmap(options.mmap);
+  headless.frame_buffer().set_depth_format(options.depth_format);
+  headless.frame_buffer().set_samples(options.msaa ? FrameBuffer::kMaxSamples
+                                                   : 1);
+  headless.set_main_loop([&](Headless *h) {
+    switch (options.path) {
+      case Path::kOrbit:
+        paths::Orbit(h->progress(), kObjectPos, kCameraDistance, 0.0f,
+                     &scene.camera());
+        break;
+      case Path::kSpin:
+        paths::Spin(h->progress(), obj);
+        break;
+      case Path::kNone:
+        break;
+    }
+    scene.Render(&h->frame_buffer());
+  });
+  if (!headless.Run(options.frames)) {
+    return 1;
+  }
+  // 流写到标准输出时统计信息输出到标准错误
+  auto const log = options.stream == "-" ? stderr : stdout;
+  std::fprintf(log,
+               "%d frames %dx%d  render %.3f ms/frame  write %.3f ms/frame\n",
+               headless.frames(), options.width, options.height,
+               headless.render_ms(), headless.write_ms());
+  if (!options.stream.empty()) {
+    auto const stats = headless.stream().stats();
+    std::fprintf(log,
+                 "stream %.1f MB  copy %.3f ms/frame  stall %.3f ms/frame  "
+                 "writer %.3f ms/frame\n",
+                 stats.bytes / 1048576.0, stats.copy_ms, stats.stall_ms,
+                 stats.write_ms);
+  }
+  return 0;
+}
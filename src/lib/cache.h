@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <utility>
 
 namespace sren {
@@ -30,4 +32,15 @@ class Cache {
   T data_{};
 };
 
+namespace caches {
+
+// 全局递增的版本号，从 1 开始。不同对象的每次修改都得到不同的版本号，
+// 版本号相同说明是同一个状态或它的拷贝
+inline std::uint64_t NextVersion() {
+  static std::atomic<std::uint64_t> next{0};
+  return ++next;
+}
+
+}  // namespace caches
+
 }  // namespace sren
@@ -11,6 +11,7 @@ void Camera::SetLookAt(Vector3 const& pos, Vector3 const& target,
   up_ = up;
   view_matrix_cache_.mark_dirty();
   transform_matrix_cache_.mark_dirty();
+  version_ = caches::NextVersion();
 }
 
 void Camera::SetPerspective(float fov_radian_v, float aspect, float near_clip,
@@ -21,6 +22,7 @@ void Camera::SetPerspective(float fov_radian_v, float aspect, float near_clip,
   far_clip_ = far_clip;
   projection_matrix_cache_.mark_dirty();
   transform_matrix_cache_.mark_dirty();
+  version_ = caches::NextVersion();
 }
 
 Matrix4x4 const& Camera::view_matrix() const {
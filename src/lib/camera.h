@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "cache.h"
 #include "matrix.h"
 #include "vector.h"
@@ -24,6 +26,8 @@ class Camera {
   void SetPerspective(float fov_radian_v, float aspect, float near_clip,
                       float far_clip);
 
+  // 每次调用 SetLookAt 或 SetPerspective 后改变，版本相同时各矩阵也相同
+  std::uint64_t version() const { return version_; }
   Matrix4x4 const& view_matrix() const;
   Matrix4x4 const& projection_matrix() const;
   Matrix4x4 const& transform_matrix() const;
@@ -43,6 +47,7 @@ class Camera {
   float aspect_ = 1.0f;
   float near_clip_{0.1f};
   float far_clip_{10000.0f};
+  std::uint64_t version_{caches::NextVersion()};
   mutable Cache<Matrix4x4> view_matrix_cache_{};
   mutable Cache<Matrix4x4> projection_matrix_cache_{};
   mutable Cache<Matrix4x4> transform_matrix_cache_{};
@@ -0,0 +1,94 @@
+#include "clip.h"
+
+#include <algorithm>
+
+namespace sren {
+
+namespace clips {
+
+namespace {
+
+// 点到平面的有向距离，不小于 0 时在内侧
+float Distance(Vector4 const &p, unsigned plane) {
+  switch (plane) {
+    case kClipLeft:
+      return p.x() + p.w();
+    case kClipRight:
+      return p.w() - p.x();
+    case kClipBottom:
+      return p.y() + p.w();
+    case kClipTop:
+      return p.w() - p.y();
+    case kClipNear:
+      return p.z();
+    case kClipFar:
+      return p.w() - p.z();
+    case kClipGuardLeft:
+      return p.x() + kGuardBand * p.w();
+    case kClipGuardRight:
+      return kGuardBand * p.w() - p.x();
+    case kClipGuardBottom:
+      return p.y() + kGuardBand * p.w();
+    case kClipGuardTop:
+      return kGuardBand * p.w() - p.y();
+  }
+  return 0.0f;
+}
+
+// 用一个平面裁剪凸多边形
+int ClipAgainst(Vertex const *in, int n, unsigned plane, Vertex *out) {
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    auto const &a = in[i];
+    auto const &b = in[(i + 1) % n];
+    float const da = Distance(a.pos(), plane);
+    float const db = Distance(b.pos(), plane);
+    if (da >= 0.0f) {
+      out[count++] = a;
+    }
+    if ((da >= 0.0f) != (db >= 0.0f)) {
+      out[count++] = a + (b - a) * (da / (da - db));
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+bool BoxOutside(Vector3 const &min, Vector3 const &max, Matrix4x4 const &mvp) {
+  unsigned all = kFrustumCodes;
+  for (int i = 0; i < 8; i++) {
+    Vector4 const corner(i & 1 ? max.x() : min.x(), i & 2 ? max.y() : min.y(),
+                         i & 4 ? max.z() : min.z(), 1.0f);
+    all &= Outcode(corner * mvp);
+    if (all == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ClipTriangle(std::array<Vertex, 3> const &in, unsigned planes,
+                 std::array<Vertex, kMaxVertexs> *out) {
+  // 每个平面最多增加一个顶点，两块缓冲交替使用
+  std::array<Vertex, kMaxVertexs> tmp{};
+  Vertex *src = out->data();
+  Vertex *dst = tmp.data();
+  std::copy(in.begin(), in.end(), src);
+  int n = 3;
+  for (unsigned plane = kClipLeft; plane <= kClipGuardTop && n >= 3;
+       plane <<= 1) {
+    if (planes & plane) {
+      n = ClipAgainst(src, n, plane, dst);
+      std::swap(src, dst);
+    }
+  }
+  if (src != out->data()) {
+    std::copy(src, src + n, out->data());
+  }
+  return n;
+}
+
+}  // namespace clips
+
+}  // namespace sren
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "matrix.h"
+#include "vector.h"
+#include "vertex.h"
+
+namespace sren {
+
+// 裁剪空间中顶点在各个平面外侧的标记，可见范围为
+// -w <= x <= w，-w <= y <= w，0 <= z <= w
+enum ClipCode : unsigned {
+  kClipLeft = 0x1,
+  kClipRight = 0x2,
+  kClipBottom = 0x4,
+  kClipTop = 0x8,
+  kClipNear = 0x10,
+  kClipFar = 0x20,
+  // 超出保护带的标记，保护带内的三角形交给光栅化阶段按屏幕范围裁剪
+  kClipGuardLeft = 0x40,
+  kClipGuardRight = 0x80,
+  kClipGuardBottom = 0x100,
+  kClipGuardTop = 0x200,
+};
+
+// 跳过或裁剪多边形时的统计
+struct ClipStats {
+  int objects_culled{};     // 包围盒在视锥外的物体
+  int polygons_culled{};    // 完全在某个平面外侧的多边形
+  int polygons_clipped{};   // 经过裁剪的多边形
+  int polygons_emitted{};   // 裁剪生成的多边形
+  int polygons_backface{};  // 背面剔除的多边形，包括裁剪生成的多边形
+  int objects_reused{};     // 沿用上次变换结果的物体，其余各项计入上次的结果
+
+  ClipStats &operator+=(ClipStats const &rhs) {
+    objects_culled += rhs.objects_culled;
+    polygons_culled += rhs.polygons_culled;
+    polygons_clipped += rhs.polygons_clipped;
+    polygons_emitted += rhs.polygons_emitted;
+    polygons_backface += rhs.polygons_backface;
+    objects_reused += rhs.objects_reused;
+    return *this;
+  }
+};
+
+namespace clips {
+
+// 保护带为屏幕在 x 和 y 方向上的倍数
+constexpr float kGuardBand = 4.0f;
+
+// 视锥的六个平面
+constexpr unsigned kFrustumCodes =
+    kClipLeft | kClipRight | kClipBottom | kClipTop | kClipNear | kClipFar;
+// 需要真正裁剪的平面：近平面之后 w 可能为负，保护带之外坐标过大
+constexpr unsigned kMustClipCodes = kClipNear | kClipGuardLeft |
+                                    kClipGuardRight | kClipGuardBottom |
+                                    kClipGuardTop;
+
+// 裁剪一个三角形最多产生的顶点数，每个平面最多增加一个顶点
+constexpr int kMaxVertexs = 3 + 10;
+
+// 计算裁剪空间中的点 (x, y, z, w) 在哪些平面外侧。
+// 只有比较和按位或，批量处理按分量存放的顶点时编译器可以向量化
+inline unsigned Outcode(float x, float y, float z, float w) {
+  float const gw = kGuardBand * w;
+  unsigned code = 0;
+  code |= x < -w ? kClipLeft : 0u;
+  code |= x > w ? kClipRight : 0u;
+  code |= y < -w ? kClipBottom : 0u;
+  code |= y > w ? kClipTop : 0u;
+  code |= z < 0.0f ? kClipNear : 0u;
+  code |= z > w ? kClipFar : 0u;
+  code |= x < -gw ? kClipGuardLeft : 0u;
+  code |= x > gw ? kClipGuardRight : 0u;
+  code |= y < -gw ? kClipGuardBottom : 0u;
+  code |= y > gw ? kClipGuardTop : 0u;
+  return code;
+}
+
+inline unsigned Outcode(Vector4 const &p) {
+  return Outcode(p.x(), p.y(), p.z(), p.w());
+}
+
+// 模型空间的包围盒经过 mvp 变换后是否完全在视锥某个平面的外侧
+bool BoxOutside(Vector3 const &min, Vector3 const &max, Matrix4x4 const &mvp);
+
+// 用 planes 中的平面裁剪裁剪空间中的三角形，顶点的所有属性线性插值。
+// 结果为凸多边形，返回顶点数，少于 3 个时表示被完全裁掉。
+int ClipTriangle(std::array<Vertex, 3> const &in, unsigned planes,
+                 std::array<Vertex, kMaxVertexs> *out);
+
+}  // namespace clips
+
+}  // namespace sren
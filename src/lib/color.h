@@ -7,7 +7,6 @@
 #include <iterator>
 
 #include "data2d.h"
-#include "key.h"
 #include "math.h"
 #include "vector.h"
 
@@ -0,0 +1,130 @@
+#include "damage.h"
+
+#include <limits>
+
+namespace sren {
+
+DamageTracker::DamageTracker() : history_(kHistory) {}
+
+void DamageTracker::BeginFrame(bool full) {
+  frame_++;
+  auto &f = history_[slot(frame_)];
+  f.full = full;
+  f.rects.clear();
+}
+
+void DamageTracker::Add(Rect const &rect) {
+  auto &f = history_[slot(frame_)];
+  if (!f.full) {
+    rects::Add(rect, kMaxRects, &f.rects);
+  }
+}
+
+bool DamageTracker::Collect(FrameBuffer const &fb,
+                            std::vector<Rect> *rects) const {
+  rects->clear();
+  std::uint64_t last = 0;
+  for (auto const &t : targets_) {
+    if (t.clear_id == fb.clear_id()) {
+      last = t.frame;
+    }
+  }
+  if (last == 0 || last >= frame_ || frame_ - last > kHistory) {
+    return false;
+  }
+  for (auto f = last + 1; f <= frame_; f++) {
+    auto const &frame = history_[slot(f)];
+    if (frame.full) {
+      return false;
+    }
+    for (auto const &r : frame.rects) {
+      rects::Add(r, kMaxRects, rects);
+    }
+  }
+  return true;
+}
+
+void DamageTracker::MarkRendered(FrameBuffer const &fb) {
+  // 替换同一帧缓冲的记录，记录过多时丢弃最久未更新的
+  Target *oldest = nullptr;
+  for (auto &t : targets_) {
+    if (t.clear_id == fb.clear_id()) {
+      t.frame = frame_;
+      return;
+    }
+    if (!oldest || t.frame < oldest->frame) {
+      oldest = &t;
+    }
+  }
+  if (int(targets_.size()) < kHistory) {
+    targets_.push_back({fb.clear_id(), frame_});
+  } else {
+    *oldest = {fb.clear_id(), frame_};
+  }
+}
+
+void DamageTracker::Reset() { targets_.clear(); }
+
+namespace rects {
+
+namespace {
+
+std::int64_t RectArea(Rect const &r) {
+  return r.empty() ? 0 : std::int64_t(r.width()) * r.height();
+}
+
+}  // namespace
+
+void Add(Rect const &rect, int max, std::vector<Rect> *rects) {
+  if (rect.empty()) {
+    return;
+  }
+  auto &rs = *rects;
+  auto r = rect;
+  // 合并后的矩形变大，可能又与其他矩形相交
+  for (bool merged = true; merged;) {
+    merged = false;
+    for (int i = 0; i < int(rs.size()); i++) {
+      if (!r.Intersect(rs[i]).empty()) {
+        r = r.Union(rs[i]);
+        rs.erase(rs.begin() + i);
+        merged = true;
+        break;
+      }
+    }
+  }
+  rs.push_back(r);
+  if (int(rs.size()) <= max) {
+    return;
+  }
+  int bi = 0;
+  int bj = 1;
+  auto best = std::numeric_limits<std::int64_t>::max();
+  for (int i = 0; i < int(rs.size()); i++) {
+    for (int j = i + 1; j < int(rs.size()); j++) {
+      auto const cost =
+          RectArea(rs[i].Union(rs[j])) - RectArea(rs[i]) - RectArea(rs[j]);
+      if (cost < best) {
+        best = cost;
+        bi = i;
+        bj = j;
+      }
+    }
+  }
+  auto const merged = rs[bi].Union(rs[bj]);
+  rs.erase(rs.begin() + bj);
+  rs.erase(rs.begin() + bi);
+  Add(merged, max, rects);
+}
+
+std::int64_t Area(std::vector<Rect> const &rects) {
+  std::int64_t area = 0;
+  for (auto const &r : rects) {
+    area += RectArea(r);
+  }
+  return area;
+}
+
+}  // namespace rects
+
+}  // namespace sren
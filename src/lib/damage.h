@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_buffer.h"
+#include "rect.h"
+
+namespace sren {
+
+// 记录最近几帧中每一帧相对前一帧改变的区域。
+// 流水线中多个帧缓冲轮流渲染，某个帧缓冲需要重绘的是它上次渲染之后
+// 所有帧改变区域的并集。
+class DamageTracker {
+ public:
+  // 保留的帧数，不少于流水线中同时使用的帧缓冲数
+  static constexpr int kHistory = 4;
+  // 每帧最多记录的矩形数，超出时与最接近的矩形合并
+  static constexpr int kMaxRects = 8;
+
+  DamageTracker();
+
+  // 开始新的一帧，full 时整帧都视为改变
+  void BeginFrame(bool full);
+  // 本帧中 rect 内的内容发生了改变
+  void Add(Rect const &rect);
+  // 求出 fb 更新到本帧需要重绘的区域。fb 从未渲染过、之后被清除过，
+  // 或上次渲染的帧已不在记录中时返回 false，此时需要整帧重绘
+  bool Collect(FrameBuffer const &fb, std::vector<Rect> *rects) const;
+  // fb 已更新到本帧
+  void MarkRendered(FrameBuffer const &fb);
+  // 忘记所有帧缓冲，之后每个帧缓冲都需要整帧重绘一次
+  void Reset();
+
+  // 本帧的帧号，从 1 开始
+  std::uint64_t frame() const { return frame_; }
+  // 本帧是否整帧改变
+  bool full() const { return history_[slot(frame_)].full; }
+  // 本帧相对前一帧改变的区域
+  std::vector<Rect> const &rects() const {
+    return history_[slot(frame_)].rects;
+  }
+
+ private:
+  struct Frame {
+    bool full{true};
+    std::vector<Rect> rects{};
+  };
+  // 帧缓冲最后一次清除的编号和之后更新到的帧号
+  struct Target {
+    std::uint64_t clear_id{};
+    std::uint64_t frame{};
+  };
+
+  static int slot(std::uint64_t frame) { return int(frame % kHistory); }
+
+  std::uint64_t frame_{};
+  std::vector<Frame> history_{};
+  std::vector<Target> targets_{};
+};
+
+namespace rects {
+
+// 将 rect 加入 rects，与已有矩形相交时合并，合并后可能继续与其他矩形合并。
+// 数量超过 max 时将面积增加最少的两个矩形合并
+void Add(Rect const &rect, int max, std::vector<Rect> *rects);
+// rects 覆盖的像素数，矩形之间互不相交
+std::int64_t Area(std::vector<Rect> const &rects);
+
+}  // namespace rects
+
+}  // namespace sren
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace sren {
+
+// 深度缓冲的存储格式。深度为 near / w，近平面处为 1，越远越接近 0，
+// 越大越近，清除后为最远。
+enum class DepthFormat {
+  // 32 位浮点数。深度随距离倒数变化，远处浮点数的精度更高，即 reverse-Z
+  kFloat32,
+  // 24 位定点数，放在 32 位中，高 8 位保留不用，带宽与 kFloat32 相同
+  kUnorm24,
+  // 16 位定点数，带宽为 kFloat32 的一半，远处精度较差
+  kUnorm16,
+};
+
+constexpr int kDepthFormatCount = 3;
+
+// 每种格式的存储类型和编码方式。Encode 保持大小顺序，
+// 深度测试在存储类型上比较 stored < Encode(z)
+template <DepthFormat F>
+struct DepthTraits;
+
+template <>
+struct DepthTraits<DepthFormat::kFloat32> {
+  using Type = float;
+  static float Encode(float z) { return z; }
+  // 深度非负，按位解释为无符号整数后大小顺序不变
+  static std::uint32_t Key(float d) {
+    std::uint32_t bits{};
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits;
+  }
+};
+
+// 定点数格式将 [0, 1] 映射到 [0, kMax]，按就近取偶舍入，与 SIMD 转换的结果一致
+template <class T, std::uint32_t M>
+struct UnormDepthTraits {
+  using Type = T;
+  static constexpr std::uint32_t kMax = M;
+  static T Encode(float z) {
+    return T(std::nearbyint(std::min(std::max(z, 0.0f), 1.0f) * float(kMax)));
+  }
+  static std::uint32_t Key(T d) { return d; }
+};
+
+template <>
+struct DepthTraits<DepthFormat::kUnorm24>
+    : UnormDepthTraits<std::uint32_t, 0xFFFFFF> {};
+
+template <>
+struct DepthTraits<DepthFormat::kUnorm16>
+    : UnormDepthTraits<std::uint16_t, 0xFFFF> {};
+
+namespace depths {
+
+// 清除后的深度，比任何可见片元都远
+constexpr float kClear = std::numeric_limits<float>::min();
+
+inline char const *FormatName(DepthFormat format) {
+  switch (format) {
+    case DepthFormat::kFloat32:
+      return "float32";
+    case DepthFormat::kUnorm24:
+      return "unorm24";
+    case DepthFormat::kUnorm16:
+      return "unorm16";
+  }
+  return "";
+}
+
+// 每个像素的深度占用的字节数
+inline int BytesPerPixel(DepthFormat format) {
+  return format == DepthFormat::kUnorm16 ? 2 : 4;
+}
+
+// 对 format 格式的深度做 func 中的操作，func 接受 DepthTraits 类型的参数
+template <class Func>
+auto Dispatch(DepthFormat format, Func &&func)
+    -> decltype(func(DepthTraits<DepthFormat::kFloat32>{})) {
+  switch (format) {
+    case DepthFormat::kUnorm24:
+      return func(DepthTraits<DepthFormat::kUnorm24>{});
+    case DepthFormat::kUnorm16:
+      return func(DepthTraits<DepthFormat::kUnorm16>{});
+    case DepthFormat::kFloat32:
+      break;
+  }
+  return func(DepthTraits<DepthFormat::kFloat32>{});
+}
+
+// 深度 z 编码后用于比较的无符号整数，与存储值的 Key 可以直接比较大小
+inline std::uint32_t ToKey(DepthFormat format, float z) {
+  return Dispatch(format, [z](auto traits) {
+    using Traits = decltype(traits);
+    return Traits::Key(Traits::Encode(z));
+  });
+}
+
+}  // namespace depths
+
+}  // namespace sren
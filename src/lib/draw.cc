@@ -1,11 +1,20 @@
 #include "draw.h"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
 
 #include "color.h"
+#include "edge_function.h"
 #include "frame_buffer.h"
+#include "g_buffer.h"
+#include "object.h"
 #include "render_style.h"
 #include "scene.h"
+#include "span.h"
+#include "tiles.h"
 #include "trapezoid.h"
 #include "vector.h"
 
@@ -17,10 +26,7 @@ namespace draw {
 
 namespace {
 
-void PreInterpFix(Vertex *v) {
-  v->color() *= v->pos().z();
-  v->uv() *= v->pos().z();
-}
+using vertexs::PreInterpFix;
 
 inline Vertex InterpVertex(Vertex v1, Vertex v2, float t) {
   PreInterpFix(&v1);
@@ -39,62 +45,518 @@ inline Vertex CalcRenderPoint(Vertex const &top, Vertex const &bot, float y) {
   return InterpVertex(bot, top, y_diff_curr / y_diff_total);
 }
 
-void RenderOneLine(Trapezoid const &trap, float y, Polygon const &poly,
-                   Vector3 const &camera_pos, Lights const &lights,
-                   FrameBuffer *fb) {
-  auto left = CalcRenderPoint(trap.left.top, trap.left.bottom, y);
-  auto right = CalcRenderPoint(trap.right.top, trap.right.bottom, y);
+// 多重采样时三角形在每个采样点处相对像素的常量
+struct SampleSetup {
+  explicit SampleSetup(TriangleSetup const &tri) {
+    constexpr float kToPixel = 1.0f / edges::kSubPixels;
+    for (int s = 0; s < edges::kMsaaSamples; s++) {
+      auto const ox = edges::kSampleX[s];
+      auto const oy = edges::kSampleY[s];
+      // 深度在屏幕空间中是线性的
+      dz[s] = tri.dx.pos().z() * (ox * kToPixel - 0.5f) +
+              tri.dy.pos().z() * (oy * kToPixel - 0.5f);
+      for (int k = 0; k < 3; k++) {
+        de[k][s] = tri.edges[k].a * ox + tri.edges[k].b * oy;
+      }
+    }
+  }
+
+  // e 为三条边在像素左下角处的值，返回被覆盖的采样点掩码，
+  // 与 edges::SampleCoverage 的结果相同
+  unsigned Coverage(std::array<std::int64_t, 3> const &e) const {
+    unsigned mask = 0;
+    for (int s = 0; s < edges::kMsaaSamples; s++) {
+      if (((e[0] + de[0][s]) | (e[1] + de[1][s]) | (e[2] + de[2][s])) >= 0) {
+        mask |= 1u << s;
+      }
+    }
+    return mask;
+  }
+
+  // 采样点 s 处的深度相对像素中心的增量
+  std::array<float, edges::kMsaaSamples> dz{};
+  // 边 k 在采样点 s 处的值相对像素左下角的增量
+  std::array<std::array<std::int64_t, edges::kMsaaSamples>, 3> de{};
+};
+
+// 光栅化一个多边形时共用的着色参数
+struct ShadeContext {
+  Polygon const &poly;
+  Vector3 const &camera_pos;
+  Lights const &lights;
+  spans::Kernel const &kernel;
+  FrameBuffer *fb;
+  // 为空时不使用分层深度缓冲剔除
+  HiZStats *hi_z;
+  // 不为空时只写入几何属性，不着色
+  GBuffer *gbuffer;
+  std::uint32_t material;
+};
+
+// 取出一组插值结果中第 lane 个像素的属性 k
+inline float LaneValue(spans::Lanes const &lanes, int k, int lane) {
+  return lanes.values[k][lane];
+}
+
+// 纹理着色：采样材质贴图，计算环境光、漫反射和高光
+struct TextureShader {
+  static constexpr unsigned kVaryings =
+      spans::kUvAttrs | spans::kWorldAttrs | spans::kNormalAttrs;
+
+  static Color Shade(ShadeContext const &ctx, spans::Lanes const &lanes,
+                     int j) {
+    Vertex vert{};
+    vert.uv() = {LaneValue(lanes, SpanSetup::kU, j),
+                 LaneValue(lanes, SpanSetup::kV, j)};
+    vert.world_pos() = {LaneValue(lanes, SpanSetup::kWorldX, j),
+                        LaneValue(lanes, SpanSetup::kWorldY, j),
+                        LaneValue(lanes, SpanSetup::kWorldZ, j), 1.0f};
+    vert.normal() = {LaneValue(lanes, SpanSetup::kNormalX, j),
+                     LaneValue(lanes, SpanSetup::kNormalY, j),
+                     LaneValue(lanes, SpanSetup::kNormalZ, j), 0.0f};
+    return ctx.lights.Illuminate(vert, ctx.poly.material(), ctx.camera_pos);
+  }
+
+  static void Store(spans::Lanes const &lanes, int j, GSample *sample) {
+    sample->attr[0] = LaneValue(lanes, SpanSetup::kU, j);
+    sample->attr[1] = LaneValue(lanes, SpanSetup::kV, j);
+  }
+};
+
+// 顶点颜色着色：只计算环境光和漫反射，不需要 uv 和世界坐标
+struct ColorShader {
+  static constexpr unsigned kVaryings = spans::kColorAttrs | spans::kNormalAttrs;
+
+  static Color Shade(ShadeContext const &ctx, spans::Lanes const &lanes,
+                     int j) {
+    Vertex vert{};
+    vert.color() = {LaneValue(lanes, SpanSetup::kR, j),
+                    LaneValue(lanes, SpanSetup::kG, j),
+                    LaneValue(lanes, SpanSetup::kB, j),
+                    LaneValue(lanes, SpanSetup::kA, j)};
+    vert.normal() = {LaneValue(lanes, SpanSetup::kNormalX, j),
+                     LaneValue(lanes, SpanSetup::kNormalY, j),
+                     LaneValue(lanes, SpanSetup::kNormalZ, j), 0.0f};
+    return ctx.lights.Illuminate(vert, vert.color(), ctx.camera_pos);
+  }
+
+  static void Store(spans::Lanes const &lanes, int j, GSample *sample) {
+    sample->attr[0] = LaneValue(lanes, SpanSetup::kR, j);
+    sample->attr[1] = LaneValue(lanes, SpanSetup::kG, j);
+    sample->attr[2] = LaneValue(lanes, SpanSetup::kB, j);
+    sample->attr[3] = LaneValue(lanes, SpanSetup::kA, j);
+  }
+};
+
+// 按着色器、是否半透明混合和是否延迟着色特化的光栅化流水线，
+// 像素循环只插值着色器需要的属性，且不再判断渲染方式
+template <class Shader, bool kAlpha, bool kDeferred>
+struct Pipeline {
+  static_assert(!(kAlpha && kDeferred), "translucent pixels are not deferred");
+
+  // 延迟着色时世界坐标和法线总是写入 G-buffer
+  static constexpr unsigned kVaryings =
+      Shader::kVaryings |
+      (kDeferred ? spans::kWorldAttrs | spans::kNormalAttrs : 0u);
+
+  static void WriteSample(ShadeContext const &ctx, spans::Lanes const &lanes,
+                          int j, GSample *sample) {
+    sample->normal[0] = LaneValue(lanes, SpanSetup::kNormalX, j);
+    sample->normal[1] = LaneValue(lanes, SpanSetup::kNormalY, j);
+    sample->normal[2] = LaneValue(lanes, SpanSetup::kNormalZ, j);
+    sample->world_pos[0] = LaneValue(lanes, SpanSetup::kWorldX, j);
+    sample->world_pos[1] = LaneValue(lanes, SpanSetup::kWorldY, j);
+    sample->world_pos[2] = LaneValue(lanes, SpanSetup::kWorldZ, j);
+    Shader::Store(lanes, j, sample);
+    sample->material = ctx.material;
+  }
+
+  // 计算一个像素的颜色，半透明时由内核写回时再与原有颜色混合
+  static std::uint32_t ShadePixel(ShadeContext const &ctx,
+                                  spans::Lanes const &lanes, int j) {
+    auto c = Shader::Shade(ctx, lanes, j);
+    c.SetFix();
+    return FrameBuffer::PackColor(c);
+  }
+
+  // 着色 y 行中 [x0, x1] 范围内的像素，start 为 x0 处的插值结果，
+  // step 为 x 每增加 1 时的增量。每次由内核处理一组像素：
+  // 先整组做深度测试，再只对通过测试的像素插值和着色，最后按掩码写回。
+  // 扫描线按分层深度缓冲的块切分成段，整段被遮挡时直接跳过。
+  static void ShadeSpan(ShadeContext const &ctx, int y, int x0, int x1,
+                        Vertex const &start, Vertex const &step) {
+    if (x0 > x1) {
+      return;
+    }
+    auto const fb = ctx.fb;
+    assert(y >= 0 && y < fb->height() && x0 >= 0 && x1 < fb->width());
+    auto const &kernel = ctx.kernel;
+    auto const setup = spans::MakeSetup(start, step);
+    int const depth_bytes = fb->depth_bytes();
+    auto const depth = fb->depth_row(y) + x0 * depth_bytes;
+    auto const color = fb->color_row(y) + x0;
+    auto const samples = kDeferred ? ctx.gbuffer->row(y) + x0 : nullptr;
+    float const z0 = setup.start[SpanSetup::kZ];
+    float const dz = setup.step[SpanSetup::kZ];
+    int const n = x1 - x0 + 1;
+    spans::Lanes lanes;
+    std::uint32_t shaded[spans::kMaxLanes];
+    for (int seg = 0; seg < n;) {
+      int const seg_end =
+          std::min(n, (x0 + seg) / HiZ::kTileSize * HiZ::kTileSize +
+                          HiZ::kTileSize - x0);
+      if (ctx.hi_z) {
+        // z 沿扫描线线性变化，段内最大值在某个端点取得
+        float const zmax = std::max(z0 + dz * seg, z0 + dz * (seg_end - 1));
+        if (fb->DepthOccluded({x0 + seg, y, x0 + seg_end, y + 1}, zmax)) {
+          ctx.hi_z->spans++;
+          ctx.hi_z->fragments += seg_end - seg;
+          seg = seg_end;
+          continue;
+        }
+      }
+      unsigned written = 0;
+      for (int i = seg; i < seg_end; i += kernel.lanes) {
+        int const m = std::min(kernel.lanes, seg_end - i);
+        auto const mask =
+            kernel.depth_test(setup, depth + i * depth_bytes, i, m);
+        if (mask == 0) {
+          continue;
+        }
+        kernel.interp(setup, kVaryings, i, m, &lanes);
+        for (int j = 0; j < m; j++) {
+          if (!(mask & (1u << j))) {
+            continue;
+          }
+          if (kDeferred) {
+            WriteSample(ctx, lanes, j, &samples[i + j]);
+          } else {
+            shaded[j] = ShadePixel(ctx, lanes, j);
+          }
+        }
+        // 半透明物体不写入深度
+        if (!kAlpha) {
+          kernel.store_depth(setup, depth + i * depth_bytes, i, m, mask);
+          written |= mask;
+        }
+        if (kAlpha) {
+          kernel.blend_color(shaded, color + i, m, mask);
+        } else if (!kDeferred) {
+          kernel.store_color(shaded, color + i, m, mask);
+        }
+      }
+      if (written) {
+        fb->MarkDepthDirty(y, x0 + seg, x0 + seg_end - 1);
+      }
+      seg = seg_end;
+    }
+  }
+
+  // 多重采样时着色 y 行中 [x0, x1] 范围内的像素。
+  // 每个采样点单独判断覆盖并做深度测试，每个像素只在中心插值和着色一次，
+  // 颜色只写入通过测试的采样点。full 时所有像素的采样点都被三角形覆盖。
+  static void ShadeSamples(ShadeContext const &ctx, TriangleSetup const &tri,
+                           SampleSetup const &ss, int y, int x0, int x1,
+                           bool full) {
+    static_assert(edges::kMsaaSamples == FrameBuffer::kMaxSamples,
+                  "sample pattern must match frame buffer samples");
+    assert(!kDeferred);
+    auto const fb = ctx.fb;
+    auto const &kernel = ctx.kernel;
+    auto const setup = spans::MakeSetup(tri.At(x0, y), tri.dx);
+    float const z0 = setup.start[SpanSetup::kZ];
+    float const dzx = setup.step[SpanSetup::kZ];
+    int const n = x1 - x0 + 1;
+    spans::Lanes lanes;
+    unsigned passed[spans::kMaxLanes];
+    float z[edges::kMsaaSamples];
+    // 三条边在当前像素左下角处的值，逐像素累加
+    std::array<std::int64_t, 3> e{};
+    for (int k = 0; k < 3; k++) {
+      e[k] = tri.edges[k](std::int64_t(x0) * edges::kSubPixels,
+                          std::int64_t(y) * edges::kSubPixels);
+    }
+    bool written = false;
+    for (int i = 0; i < n; i += kernel.lanes) {
+      int const m = std::min(kernel.lanes, n - i);
+      unsigned mask = 0;
+      for (int j = 0; j < m; j++) {
+        int const x = x0 + i + j;
+        auto const coverage = full ? edges::kAllSamples : ss.Coverage(e);
+        for (int k = 0; k < 3; k++) {
+          e[k] += tri.edges[k].step_x();
+        }
+        passed[j] = 0;
+        if (coverage == 0) {
+          continue;
+        }
+        float const zc = z0 + dzx * (i + j);
+        for (int s = 0; s < edges::kMsaaSamples; s++) {
+          z[s] = zc + ss.dz[s];
+        }
+        // 半透明物体不写入深度
+        passed[j] = fb->TestSamples(x, y, z, coverage, !kAlpha);
+        if (passed[j]) {
+          mask |= 1u << j;
+        }
+      }
+      if (mask == 0) {
+        continue;
+      }
+      kernel.interp(setup, kVaryings, i, m, &lanes);
+      for (int j = 0; j < m; j++) {
+        if (!(mask & (1u << j))) {
+          continue;
+        }
+        auto const color = ShadePixel(ctx, lanes, j);
+        if (kAlpha) {
+          fb->BlendSamples(x0 + i + j, y, passed[j], color);
+        } else {
+          fb->WriteSamples(x0 + i + j, y, passed[j], color);
+        }
+      }
+      written = written || !kAlpha;
+    }
+    if (written) {
+      fb->MarkDepthDirty(y, x0, x1);
+    }
+  }
+};
+
+template <class P>
+void RenderOneLine(Trapezoid const &trap, float yf, ShadeContext const &ctx,
+                   Rect const &clip) {
+  auto left = CalcRenderPoint(trap.left.top, trap.left.bottom, yf);
+  auto right = CalcRenderPoint(trap.right.top, trap.right.bottom, yf);
   PreInterpFix(&left);
   PreInterpFix(&right);
   int const leftx = left.pos().x();
   int const rightx = right.pos().x();
   auto const width = (rightx - leftx) + 1;
   auto const step = (right - left) / width;
-  for (int x = leftx; x <= rightx; x++) {
-    auto vert = left;
-    left += step;
-    int const y = vert.pos().y();
-    float const z = vert.pos().z();
-    if (!fb->NeedRender(x, y, z)) {
-      continue;
+  // 只遍历裁剪范围内的像素，起点处的插值直接计算得出
+  int const startx = std::max(leftx, clip.x0);
+  int const endx = std::min(rightx, clip.x1 - 1);
+  if (startx > leftx) {
+    left += step * float(startx - leftx);
+  }
+  P::ShadeSpan(ctx, int(yf), startx, endx, left, step);
+}
+
+template <class P>
+void RenderTrapezoid(Trapezoid const &trap, ShadeContext const &ctx,
+                     Rect const &clip) {
+  // 跳过裁剪范围下方的扫描线，y 保持与 trap.bottom 相差整数
+  float y = trap.bottom;
+  if (y < clip.y0) {
+    y += std::ceil(clip.y0 - y);
+  }
+  for (; y < trap.top && y < clip.y1; y++) {
+    RenderOneLine<P>(trap, y, ctx, clip);
+  }
+}
+
+// 在块的一行中查找被三角形覆盖的像素范围，三角形是凸的，覆盖的像素必然连续
+bool FindCoveredSpan(TriangleSetup const &setup, Rect const &block, int y,
+                     int *x0, int *x1) {
+  std::array<std::int64_t, 3> e{};
+  for (int i = 0; i < 3; i++) {
+    e[i] = setup.edges[i].AtPixel(block.x0, y);
+  }
+  int first = block.x1;
+  int last = block.x0 - 1;
+  for (int x = block.x0; x < block.x1; x++) {
+    if ((e[0] | e[1] | e[2]) >= 0) {
+      first = std::min(first, x);
+      last = x;
     }
-    vert.uv() /= z;
-    if (poly.render_style() & kRenderTexture) {
-      auto color = lights.Illuminate(vert, poly.material(), camera_pos);
-      if (poly.is_alpha()) {
-        color.SetBlend(fb->Get(x, y));
-        color.SetFix();
-        fb->Set(x, y, color);
-      } else {
-        color.SetFix();
-        fb->Set(x, y, z, color);
+    for (int i = 0; i < 3; i++) {
+      e[i] += setup.edges[i].step_x();
+    }
+  }
+  *x0 = first;
+  *x1 = last;
+  return first <= last;
+}
+
+// 块内三角形平面上深度的最大值不超过 zmax，也不超过平面在块四角像素中心处的最大值，
+// 多重采样时采样点离像素中心不超过半个像素
+bool BlockOccluded(TriangleSetup const &setup, Rect const &block, float zmax,
+                   FrameBuffer *fb) {
+  float const dzx = setup.dx.pos().z();
+  float const dzy = setup.dy.pos().z();
+  float z = setup.origin.pos().z() + dzx * (block.x0 - setup.origin_x) +
+            dzy * (block.y0 - setup.origin_y);
+  z += std::max(0.0f, dzx * (block.width() - 1));
+  z += std::max(0.0f, dzy * (block.height() - 1));
+  if (fb->samples() > 1) {
+    z += 0.5f * (std::abs(dzx) + std::abs(dzy));
+  }
+  return fb->DepthOccluded(block, std::min(z, zmax));
+}
+
+template <class P>
+void RenderHalfSpace(std::array<Vertex, 3> const &verts, float zmax,
+                     ShadeContext const &ctx, Rect const &clip) {
+  TriangleSetup setup{};
+  if (!edges::SetupTriangle(verts, clip, &setup)) {
+    return;
+  }
+  auto const &bounds = setup.bounds;
+  constexpr int kBlock = edges::kBlockSize;
+  // 块按屏幕对齐，与分块渲染的块边界保持一致
+  int const bx0 = bounds.x0 - bounds.x0 % kBlock;
+  int const by0 = bounds.y0 - bounds.y0 % kBlock;
+  for (int by = by0; by < bounds.y1; by += kBlock) {
+    for (int bx = bx0; bx < bounds.x1; bx += kBlock) {
+      auto const block =
+          Rect(bx, by, bx + kBlock, by + kBlock).Intersect(bounds);
+      auto const coverage = edges::ClassifyBlock(setup, block);
+      if (coverage == BlockCoverage::kNone) {
+        continue;
+      }
+      if (ctx.hi_z && BlockOccluded(setup, block, zmax, ctx.fb)) {
+        ctx.hi_z->blocks++;
+        ctx.hi_z->fragments += block.width() * block.height();
+        continue;
+      }
+      for (int y = block.y0; y < block.y1; y++) {
+        int x0 = block.x0;
+        int x1 = block.x1 - 1;
+        if (coverage == BlockCoverage::kPartial &&
+            !FindCoveredSpan(setup, block, y, &x0, &x1)) {
+          continue;
+        }
+        P::ShadeSpan(ctx, y, x0, x1, setup.At(x0, y), setup.dx);
       }
     }
-    if (poly.render_style() & kRenderColor) {
-      vert.color() /= z;
-      auto color = lights.Illuminate(vert, vert.color(), camera_pos);
-      if (poly.is_alpha()) {
-        color.SetBlend(fb->Get(x, y));
-        color.SetFix();
-        fb->Set(x, y, color);
-      } else {
-        color.SetFix();
-        fb->Set(x, y, z, color);
+  }
+}
+
+// 多重采样的半空间光栅化，块和遍历范围都按采样点而不是像素中心判断
+template <class P>
+void RenderMultisample(std::array<Vertex, 3> const &verts, float zmax,
+                       ShadeContext const &ctx, Rect const &clip) {
+  int const samples = ctx.fb->samples();
+  TriangleSetup setup{};
+  if (!edges::SetupTriangle(verts, clip, &setup, samples)) {
+    return;
+  }
+  SampleSetup const samples_setup(setup);
+  auto const &bounds = setup.bounds;
+  constexpr int kBlock = edges::kBlockSize;
+  int const bx0 = bounds.x0 - bounds.x0 % kBlock;
+  int const by0 = bounds.y0 - bounds.y0 % kBlock;
+  for (int by = by0; by < bounds.y1; by += kBlock) {
+    for (int bx = bx0; bx < bounds.x1; bx += kBlock) {
+      auto const block =
+          Rect(bx, by, bx + kBlock, by + kBlock).Intersect(bounds);
+      auto const coverage = edges::ClassifyBlock(setup, block, samples);
+      if (coverage == BlockCoverage::kNone) {
+        continue;
+      }
+      if (ctx.hi_z && BlockOccluded(setup, block, zmax, ctx.fb)) {
+        ctx.hi_z->blocks++;
+        ctx.hi_z->fragments += block.width() * block.height();
+        continue;
+      }
+      for (int y = block.y0; y < block.y1; y++) {
+        P::ShadeSamples(ctx, setup, samples_setup, y, block.x0, block.x1 - 1,
+                        coverage == BlockCoverage::kFull);
       }
     }
   }
 }
 
-void RenderTrapezoid(Trapezoid const &trap, Polygon const &poly,
-                     Scene const &scene, FrameBuffer *fb) {
-  for (float y = trap.bottom; y < trap.top; y++) {
-    if (y >= 0 && y < fb->height()) {
-      RenderOneLine(trap, y, poly, scene.camera().pos(), scene.lights(), fb);
+// 按光栅化方式和流水线特化的三角形填充
+template <Rasterizer kRaster, class P>
+void FillTriangle(Polygon const &poly, Scene const &scene, Rect const &rect,
+                  GBuffer *gbuffer, FrameBuffer *fb) {
+  // 之后逐行、逐像素的遍历都限制在裁剪范围内，不再检查是否越界
+  auto const clip = rect.Intersect(fb->scissor());
+  HiZStats stats{};
+  ShadeContext const ctx{poly,
+                         scene.view_camera().pos(),
+                         scene.lights(),
+                         spans::GetKernel(scene.simd_isa(), fb->depth_format()),
+                         fb,
+                         scene.hi_z() ? &stats : nullptr,
+                         gbuffer,
+                         gbuffer ? gbuffer->MaterialId(poly.object()) : 0};
+  std::array<Vertex, 3> const verts{poly.vertex(0), poly.vertex(1),
+                                    poly.vertex(2)};
+  float const zmax =
+      std::max({verts[0].pos().z(), verts[1].pos().z(), verts[2].pos().z()});
+  auto const bounds = tiles::PolygonBounds(poly).Intersect(clip);
+  if (bounds.empty()) {
+    return;
+  }
+  if (ctx.hi_z && fb->DepthOccluded(bounds, zmax)) {
+    stats.triangles++;
+    stats.fragments += std::uint64_t(bounds.width()) * bounds.height();
+  } else if (fb->samples() > 1) {
+    // 多重采样总是使用半空间光栅化，并且不支持延迟着色
+    assert(!gbuffer);
+    fb->Touch(bounds);
+    RenderMultisample<P>(verts, zmax, ctx, clip);
+  } else if (kRaster == Rasterizer::kHalfSpace) {
+    fb->Touch(bounds);
+    RenderHalfSpace<P>(verts, zmax, ctx, clip);
+  } else {
+    fb->Touch(bounds);
+    std::array<Trapezoid, 2> traps{};
+    int const count = trapezoids::CutTriangle(verts, &traps);
+    if (count >= 1) {
+      RenderTrapezoid<P>(traps[0], ctx, clip);
     }
-    if (y >= fb->height()) {
-      break;
+    if (count >= 2) {
+      RenderTrapezoid<P>(traps[1], ctx, clip);
     }
   }
+  if (ctx.hi_z) {
+    fb->hi_z().AddStats(stats);
+  }
+}
+
+// 半透明且同时使用纹理和颜色时，先混合纹理着色的结果再混合颜色着色的结果。
+// 半透明物体不写入深度，两遍的深度测试结果相同，与逐像素依次混合等价。
+template <Rasterizer kRaster>
+void FillLayered(Polygon const &poly, Scene const &scene, Rect const &clip,
+                 GBuffer *gbuffer, FrameBuffer *fb) {
+  FillTriangle<kRaster, Pipeline<TextureShader, true, false>>(
+      poly, scene, clip, gbuffer, fb);
+  FillTriangle<kRaster, Pipeline<ColorShader, true, false>>(poly, scene, clip,
+                                                            gbuffer, fb);
+}
+
+void FillNothing(Polygon const &, Scene const &, Rect const &, GBuffer *,
+                 FrameBuffer *) {}
+
+template <Rasterizer kRaster>
+FillFunc SelectFill(unsigned style, bool alpha, bool deferred) {
+  bool const texture = style & kRenderTexture;
+  bool const color = style & kRenderColor;
+  if (!texture && !color) {
+    return FillNothing;
+  }
+  if (alpha) {
+    if (texture && color) {
+      return FillLayered<kRaster>;
+    }
+    return texture
+               ? FillTriangle<kRaster, Pipeline<TextureShader, true, false>>
+               : FillTriangle<kRaster, Pipeline<ColorShader, true, false>>;
+  }
+  // 不透明时每个像素只需一种着色器，见 render_styles::OpaqueTexture
+  bool const opaque_texture = render_styles::OpaqueTexture(style);
+  if (deferred) {
+    return opaque_texture
+               ? FillTriangle<kRaster, Pipeline<TextureShader, false, true>>
+               : FillTriangle<kRaster, Pipeline<ColorShader, false, true>>;
+  }
+  return opaque_texture
+             ? FillTriangle<kRaster, Pipeline<TextureShader, false, false>>
+             : FillTriangle<kRaster, Pipeline<ColorShader, false, false>>;
 }
 
 }  // namespace
@@ -106,24 +568,36 @@ void Pixel(Vector4 p, Color const &c, FrameBuffer *fb) {
 
 // 画线
 void Line(Vector4 p0, Vector4 p1, Color const &c, FrameBuffer *fb) {
+  Line(p0, p1, c, fb->scissor(), fb);
+}
+
+// 画线，只绘制 clip 范围内的像素
+void Line(Vector4 p0, Vector4 p1, Color const &c, Rect const &rect,
+          FrameBuffer *fb) {
+  auto const clip = rect.Intersect(fb->scissor());
+  auto const set = [&](int x, int y) {
+    if (clip.Contains(x, y)) {
+      fb->Set(x, y, c);
+    }
+  };
   if (p0.x() == p1.x() && p0.y() == p1.y()) {
-    fb->Set(p0.x(), p0.y(), c);
+    set(p0.x(), p0.y());
   } else if (p0.x() == p1.x()) {
     int const inc = (p0.y() <= p1.y()) ? 1 : -1;
     int const y0 = p0.y();
     int const y1 = p1.y();
     for (int y = y0; y != y1; y += inc) {
-      fb->Set(p0.x(), y, c);
+      set(p0.x(), y);
     }
-    fb->Set(p1.x(), p1.y(), c);
+    set(p1.x(), p1.y());
   } else if (p0.y() == p1.y()) {
     int const inc = (p0.x() <= p1.x()) ? 1 : -1;
     int const x0 = std::floor(p0.x());
     int const x1 = std::floor(p1.x());
     for (int x = x0; x != x1; x += inc) {
-      fb->Set(x, p0.y(), c);
+      set(x, p0.y());
     }
-    fb->Set(p1.x(), p1.y(), c);
+    set(p1.x(), p1.y());
   } else {
     int const dx = std::abs(p1.x() - p0.x());
     int const dy = std::abs(p1.y() - p0.y());
@@ -136,15 +610,15 @@ void Line(Vector4 p0, Vector4 p1, Color const &c, FrameBuffer *fb) {
       int const x1 = p1.x();
       int const y0 = p0.y();
       for (int x = x0, y = y0; x <= x1; x++) {
-        fb->Set(x, y, c);
+        set(x, y);
         rem += dy;
         if (rem >= dx) {
           rem -= dx;
           y += (p1.y() >= p0.y()) ? 1 : -1;
-          fb->Set(x, y, c);
+          set(x, y);
         }
       }
-      fb->Set(p1.x(), p1.y(), c);
+      set(p1.x(), p1.y());
     } else {
       if (p1.y() < p0.y()) {
         std::swap(p0, p1);
@@ -154,36 +628,63 @@ void Line(Vector4 p0, Vector4 p1, Color const &c, FrameBuffer *fb) {
       int const y0 = p0.y();
       int const y1 = p1.y();
       for (int x = x0, y = y0; y <= y1; y++) {
-        fb->Set(x, y, c);
+        set(x, y);
         rem += dx;
         if (rem >= dy) {
           rem -= dy;
           x += (p1.x() >= p0.x()) ? 1 : -1;
-          fb->Set(x, y, c);
+          set(x, y);
         }
       }
-      fb->Set(p1.x(), p1.y(), c);
+      set(p1.x(), p1.y());
     }
   }
 }
 
 // 画三角形
 void Triangle(Polygon const &poly, Scene const &scene, FrameBuffer *fb) {
-  if (poly.render_style() & (kRenderColor | kRenderTexture)) {
-    std::array<Trapezoid, 2> traps{};
-    int const count = trapezoids::CutTriangle(
-        {poly.vertex(0), poly.vertex(1), poly.vertex(2)}, &traps);
-    if (count >= 1) {
-      RenderTrapezoid(traps[0], poly, scene, fb);
-    }
-    if (count >= 2) {
-      RenderTrapezoid(traps[1], poly, scene, fb);
-    }
+  Triangle(poly, scene, fb->scissor(), fb);
+}
+
+// 画三角形，只绘制 clip 范围内的像素
+void Triangle(Polygon const &poly, Scene const &scene, Rect const &clip,
+              FrameBuffer *fb) {
+  Triangle(poly, scene, clip, nullptr, fb);
+}
+
+// 画三角形，gbuffer 不为空时不透明三角形只写入几何属性，也不画线框
+void Triangle(Polygon const &poly, Scene const &scene, Rect const &clip,
+              GBuffer *gbuffer, FrameBuffer *fb) {
+  if (poly.is_alpha()) {
+    gbuffer = nullptr;
+  }
+  SelectFill(*poly.object(), scene, gbuffer != nullptr)(poly, scene, clip,
+                                                        gbuffer, fb);
+  if (!gbuffer) {
+    Wireframe(poly, scene, clip, fb);
   }
+}
+
+// 选出物体的三角形填充函数
+FillFunc SelectFill(Object const &obj, Scene const &scene, bool deferred) {
+  bool const alpha = obj.is_alpha();
+  deferred = deferred && !alpha;
+  if (scene.rasterizer() == Rasterizer::kHalfSpace) {
+    return SelectFill<Rasterizer::kHalfSpace>(obj.render_style(), alpha,
+                                              deferred);
+  }
+  return SelectFill<Rasterizer::kTrapezoid>(obj.render_style(), alpha,
+                                            deferred);
+}
+
+// 画三角形的线框，只绘制 clip 范围内的像素
+void Wireframe(Polygon const &poly, Scene const &scene, Rect const &clip,
+               FrameBuffer *fb) {
   if (poly.render_style() & kRenderWireframe) {
-    Line(poly.vertex(0).pos(), poly.vertex(1).pos(), scene.foreground(), fb);
-    Line(poly.vertex(1).pos(), poly.vertex(2).pos(), scene.foreground(), fb);
-    Line(poly.vertex(0).pos(), poly.vertex(2).pos(), scene.foreground(), fb);
+    auto const &c = scene.foreground();
+    Line(poly.pos(0), poly.pos(1), c, clip, fb);
+    Line(poly.pos(1), poly.pos(2), c, clip, fb);
+    Line(poly.pos(0), poly.pos(2), c, clip, fb);
   }
 }
 
@@ -2,7 +2,9 @@
 
 #include "color.h"
 #include "frame_buffer.h"
+#include "g_buffer.h"
 #include "polygon.h"
+#include "rect.h"
 #include "vector.h"
 
 namespace sren {
@@ -35,9 +37,34 @@ void Pixel(Vector4 p, Color const &c, FrameBuffer *fb);
 // 画线
 void Line(Vector4 p0, Vector4 p1, Color const &c, FrameBuffer *fb);
 
+// 画线，只绘制 clip 范围内的像素
+void Line(Vector4 p0, Vector4 p1, Color const &c, Rect const &clip,
+          FrameBuffer *fb);
+
 // 画三角形
 void Triangle(Polygon const &poly, Scene const &scene, FrameBuffer *fb);
 
+// 画三角形，只绘制 clip 范围内的像素
+void Triangle(Polygon const &poly, Scene const &scene, Rect const &clip,
+              FrameBuffer *fb);
+
+// 画三角形，gbuffer 不为空时不透明三角形只写入几何属性，也不画线框
+void Triangle(Polygon const &poly, Scene const &scene, Rect const &clip,
+              GBuffer *gbuffer, FrameBuffer *fb);
+
+// 填充三角形，只绘制 clip 范围内的像素，gbuffer 不为空时只写入几何属性
+using FillFunc = void (*)(Polygon const &poly, Scene const &scene,
+                          Rect const &clip, GBuffer *gbuffer, FrameBuffer *fb);
+
+// 按物体的渲染方式、是否半透明、场景的光栅化方式和是否延迟着色，
+// 选出编译期特化的填充函数。同一物体的三角形共用一个函数，
+// 像素循环中不再判断这些条件，也只插值着色需要的属性。
+FillFunc SelectFill(Object const &obj, Scene const &scene, bool deferred);
+
+// 画三角形的线框，只绘制 clip 范围内的像素
+void Wireframe(Polygon const &poly, Scene const &scene, Rect const &clip,
+               FrameBuffer *fb);
+
 }  // namespace draw
 
 }  // namespace sren
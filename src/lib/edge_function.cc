@@ -0,0 +1,165 @@
+#include "edge_function.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "math.h"
+
+namespace sren {
+
+namespace edges {
+
+namespace {
+
+// 定点数坐标的范围，保证边函数的乘积不会溢出 int64
+constexpr float kMaxFixed = float(1 << 27);
+
+// 从 v0 指向 v1 的边，三角形为逆时针时内部在边的左侧
+EdgeFunction MakeEdge(std::int64_t x0, std::int64_t y0, std::int64_t x1,
+                      std::int64_t y1) {
+  return {y0 - y1, x1 - x0, x0 * y1 - x1 * y0};
+}
+
+// 内部在边的右侧（左边），或者边水平且内部在边的下方（上边），y 轴向上
+bool IsTopLeft(EdgeFunction const &e) { return e.a > 0 || (e.a == 0 && e.b < 0); }
+
+// 不小于 f / kSubPixels 的最小整数
+int CeilPixel(std::int64_t f) {
+  return int((f + kSubPixels - 1) >> kSubPixelBits);
+}
+
+// 像素内采样点相对像素左下角的最小和最大偏移，单采样时只有像素中心
+void SampleExtent(int samples, int *lo, int *hi) {
+  if (samples <= 1) {
+    *lo = *hi = kSubPixels / 2;
+    return;
+  }
+  *lo = *std::min_element(kSampleX, kSampleX + kMsaaSamples);
+  *hi = *std::max_element(kSampleX, kSampleX + kMsaaSamples);
+}
+
+}  // namespace
+
+std::int32_t ToFixed(float f) {
+  return std::int32_t(
+      std::lround(Clamp(-kMaxFixed, kMaxFixed, f * float(kSubPixels))));
+}
+
+bool SetupTriangle(std::array<Vertex, 3> const &verts, Rect const &clip,
+                   TriangleSetup *setup, int samples) {
+  std::array<std::int64_t, 3> x{};
+  std::array<std::int64_t, 3> y{};
+  for (int i = 0; i < 3; i++) {
+    if (!std::isfinite(verts[i].pos().x()) ||
+        !std::isfinite(verts[i].pos().y())) {
+      return false;
+    }
+    x[i] = ToFixed(verts[i].pos().x());
+    y[i] = ToFixed(verts[i].pos().y());
+  }
+  // 整数运算，面积为 0 的判断是精确的
+  auto const det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+  if (det == 0) {
+    return false;
+  }
+
+  // 包围盒内像素中至少有一个采样点满足 minx <= x * 16 + offset <= maxx，
+  // 单采样时 offset 为像素中心 8。两个方向上采样点偏移的范围相同
+  int lo = 0;
+  int hi = 0;
+  SampleExtent(samples, &lo, &hi);
+  auto const minx = std::min({x[0], x[1], x[2]});
+  auto const miny = std::min({y[0], y[1], y[2]});
+  auto const maxx = std::max({x[0], x[1], x[2]});
+  auto const maxy = std::max({y[0], y[1], y[2]});
+  Rect const bounds(CeilPixel(minx - hi), CeilPixel(miny - hi),
+                    int((maxx - lo) >> kSubPixelBits) + 1,
+                    int((maxy - lo) >> kSubPixelBits) + 1);
+  setup->bounds = bounds.Intersect(clip);
+  setup->origin_x = bounds.x0;
+  setup->origin_y = bounds.y0;
+  if (setup->bounds.empty()) {
+    return false;
+  }
+
+  setup->edges = {MakeEdge(x[1], y[1], x[2], y[2]),
+                  MakeEdge(x[2], y[2], x[0], y[0]),
+                  MakeEdge(x[0], y[0], x[1], y[1])};
+  for (auto &e : setup->edges) {
+    if (det < 0) {
+      e = {-e.a, -e.b, -e.c};
+    }
+    // 不是上边或左边时排除恰好在边上的点
+    if (!IsTopLeft(e)) {
+      e.c -= 1;
+    }
+  }
+
+  // 属性平面按对齐后的坐标计算，与覆盖判断保持一致
+  auto v0 = verts[0];
+  auto v1 = verts[1];
+  auto v2 = verts[2];
+  vertexs::PreInterpFix(&v0);
+  vertexs::PreInterpFix(&v1);
+  vertexs::PreInterpFix(&v2);
+  constexpr float kToFloat = 1.0f / kSubPixels;
+  float const px0 = x[0] * kToFloat;
+  float const py0 = y[0] * kToFloat;
+  float const ex1 = (x[1] - x[0]) * kToFloat;
+  float const ey1 = (y[1] - y[0]) * kToFloat;
+  float const ex2 = (x[2] - x[0]) * kToFloat;
+  float const ey2 = (y[2] - y[0]) * kToFloat;
+  auto const d1 = v1 - v0;
+  auto const d2 = v2 - v0;
+  auto const inv_det = 1.0f / (ex1 * ey2 - ex2 * ey1);
+  setup->dx = (d1 * ey2 - d2 * ey1) * inv_det;
+  setup->dy = (d2 * ex1 - d1 * ex2) * inv_det;
+  setup->origin = v0 + setup->dx * (bounds.x0 + 0.5f - px0) +
+                  setup->dy * (bounds.y0 + 0.5f - py0);
+  return true;
+}
+
+BlockCoverage ClassifyBlock(TriangleSetup const &setup, Rect const &block,
+                            int samples) {
+  // 边函数是线性的，只需检查块内所有采样点的包围盒的四个角，
+  // 单采样时即四个角上的像素中心
+  int lo = 0;
+  int hi = 0;
+  SampleExtent(samples, &lo, &hi);
+  std::int64_t const x0 = std::int64_t(block.x0) * kSubPixels + lo;
+  std::int64_t const y0 = std::int64_t(block.y0) * kSubPixels + lo;
+  std::int64_t const x1 = std::int64_t(block.x1 - 1) * kSubPixels + hi;
+  std::int64_t const y1 = std::int64_t(block.y1 - 1) * kSubPixels + hi;
+  bool full = true;
+  for (auto const &e : setup.edges) {
+    auto const e00 = e(x0, y0);
+    auto const e10 = e(x1, y0);
+    auto const e01 = e(x0, y1);
+    auto const e11 = e(x1, y1);
+    auto const lo = std::min({e00, e10, e01, e11});
+    auto const hi = std::max({e00, e10, e01, e11});
+    if (hi < 0) {
+      return BlockCoverage::kNone;
+    }
+    if (lo < 0) {
+      full = false;
+    }
+  }
+  return full ? BlockCoverage::kFull : BlockCoverage::kPartial;
+}
+
+unsigned SampleCoverage(TriangleSetup const &setup, int x, int y) {
+  unsigned mask = 0;
+  for (int s = 0; s < kMsaaSamples; s++) {
+    auto const &e = setup.edges;
+    if ((e[0].AtSample(x, y, s) | e[1].AtSample(x, y, s) |
+         e[2].AtSample(x, y, s)) >= 0) {
+      mask |= 1u << s;
+    }
+  }
+  return mask;
+}
+
+}  // namespace edges
+
+}  // namespace sren
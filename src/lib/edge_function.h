@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "rect.h"
+#include "vertex.h"
+
+namespace sren {
+
+namespace edges {
+
+// 顶点坐标使用 28.4 定点数，即每个像素 16 个子像素
+constexpr int kSubPixelBits = 4;
+constexpr int kSubPixels = 1 << kSubPixelBits;
+
+// 多重采样时每个像素的采样点数和采样点在像素内的位置，以子像素为单位，
+// 按旋转网格排列，水平和竖直方向上各有 4 个不同的位置
+constexpr int kMsaaSamples = 4;
+constexpr int kSampleX[kMsaaSamples] = {6, 14, 2, 10};
+constexpr int kSampleY[kMsaaSamples] = {2, 6, 10, 14};
+constexpr unsigned kAllSamples = (1u << kMsaaSamples) - 1;
+
+}  // namespace edges
+
+// 三角形一条边的定点数边函数 E(x, y) = a * x + b * y + c，x 和 y 为 28.4 定点数。
+// 三角形内部 E >= 0，c 中已包含左上填充规则的偏置：
+// 恰好落在边上的像素只属于以该边为上边或左边的三角形。
+struct EdgeFunction {
+  std::int64_t operator()(std::int64_t x, std::int64_t y) const {
+    return a * x + b * y + c;
+  }
+
+  // 像素 (x, y) 中心处的值
+  std::int64_t AtPixel(int x, int y) const {
+    return (*this)(std::int64_t(x) * edges::kSubPixels + edges::kSubPixels / 2,
+                   std::int64_t(y) * edges::kSubPixels + edges::kSubPixels / 2);
+  }
+
+  // 像素 (x, y) 中第 s 个多重采样点处的值
+  std::int64_t AtSample(int x, int y, int s) const {
+    return (*this)(std::int64_t(x) * edges::kSubPixels + edges::kSampleX[s],
+                   std::int64_t(y) * edges::kSubPixels + edges::kSampleY[s]);
+  }
+
+  // x 增加一个像素时的增量
+  std::int64_t step_x() const { return a * edges::kSubPixels; }
+
+  std::int64_t a{};
+  std::int64_t b{};
+  std::int64_t c{};
+};
+
+// 半空间光栅化所需的三角形数据：三条边函数以及所有属性的平面方程。
+// 属性在像素中心采样，颜色和 uv 已乘以 z 用于透视修正。
+// 覆盖判断完全使用整数，属性按对齐到子像素后的顶点坐标计算。
+struct TriangleSetup {
+  // 像素 (x, y) 中心处的属性值
+  Vertex At(int x, int y) const {
+    return origin + dx * float(x - origin_x) + dy * float(y - origin_y);
+  }
+
+  std::array<EdgeFunction, 3> edges{};
+  // 需要遍历的像素范围
+  Rect bounds{};
+  // 属性在像素 (origin_x, origin_y) 处的值，该像素只取决于三角形本身，
+  // 与裁剪范围无关，分块渲染时每个像素的结果与不分块时完全一致
+  Vertex origin{};
+  int origin_x{};
+  int origin_y{};
+  // 属性对 x 的偏导
+  Vertex dx{};
+  // 属性对 y 的偏导
+  Vertex dy{};
+};
+
+// 块内像素被三角形覆盖的情况
+enum class BlockCoverage {
+  kNone,
+  kPartial,
+  kFull,
+};
+
+namespace edges {
+
+// 光栅化时遍历的块大小
+constexpr int kBlockSize = 8;
+
+// 将屏幕坐标转换为 28.4 定点数，就近取整
+std::int32_t ToFixed(float f);
+
+// 计算三角形的边函数和属性平面方程，只遍历 clip 范围内的像素。
+// samples 大于 1 时按多重采样点而不是像素中心计算遍历范围。
+// 对齐到子像素后面积为 0 或不覆盖任何像素时返回 false。
+bool SetupTriangle(std::array<Vertex, 3> const &verts, Rect const &clip,
+                   TriangleSetup *setup, int samples = 1);
+
+// 判断 block 中的像素被三角形覆盖的情况，samples 大于 1 时按多重采样点判断
+BlockCoverage ClassifyBlock(TriangleSetup const &setup, Rect const &block,
+                            int samples = 1);
+
+// 像素 (x, y) 中被三角形覆盖的多重采样点掩码，第 s 位对应第 s 个采样点
+unsigned SampleCoverage(TriangleSetup const &setup, int x, int y);
+
+}  // namespace edges
+
+}  // namespace sren
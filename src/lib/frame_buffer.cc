@@ -1,91 +1,427 @@
 #include "frame_buffer.h"
 
 #include <algorithm>
-#include <limits>
+#include <atomic>
+#include <cstring>
 
 #include "lib/color.h"
 #include "math.h"
 
 namespace sren {
 
-int FrameBuffer::data_index(int x, int y) const {
-  return y * width_ * 4 + x * 4;
+namespace {
+
+// 每行按缓存行对齐所需的像素数
+constexpr int kRowAlign = simd::kCacheLine / sizeof(std::uint32_t);
+
+// 所有帧缓冲共用的清除编号
+std::atomic<std::uint64_t> gClearId{0};
+
+}  // namespace
+
+int FrameBuffer::pixel_index(int x, int y) const {
+  return x + memory_row(y) * stride_;
+}
+
+int FrameBuffer::z_buffer_index(int x, int y) const {
+  return sample_index(x, y) * depth_bytes();
+}
+
+std::uint32_t FrameBuffer::PackColor(Color const &color) {
+  std::uint8_t const bytes[4] = {
+      std::uint8_t(color.r_hex()),
+      std::uint8_t(color.g_hex()),
+      std::uint8_t(color.b_hex()),
+      std::uint8_t(color.a_hex()),
+  };
+  std::uint32_t packed{};
+  std::memcpy(&packed, bytes, sizeof(packed));
+  return packed;
+}
+
+Color FrameBuffer::UnpackColor(std::uint32_t packed) {
+  std::uint8_t bytes[4]{};
+  std::memcpy(bytes, &packed, sizeof(packed));
+  return Color::RGBA(bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+std::uint32_t FrameBuffer::BlendPacked(std::uint32_t src, std::uint32_t dst) {
+  // 小端序下 A 位于最高字节。R、B 和 G、A 两两一组，每个通道占 16 位，
+  // 同时计算 t = s * a + d * (255 - a) + 128，再用 (t + (t >> 8)) >> 8
+  // 得到四舍五入后的 t / 255
+  std::uint32_t const a = src >> 24;
+  std::uint32_t const ia = 255 - a;
+  std::uint32_t rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia;
+  rb += 0x00800080;
+  rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+  std::uint32_t ga =
+      ((src >> 8) & 0x00FF00FF) * a + ((dst >> 8) & 0x00FF00FF) * ia;
+  ga += 0x00800080;
+  ga = (ga + ((ga >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+  return rb | ga;
+}
+
+Rect FrameBuffer::tile_rect(int tx, int ty) const {
+  int const x0 = tx * kClearTileSize;
+  int const y0 = ty * kClearTileSize;
+  return {x0, y0, std::min(x0 + kClearTileSize, width_),
+          std::min(y0 + kClearTileSize, height_)};
+}
+
+void FrameBuffer::ClearDepth(Rect const &rect) {
+  int const x0 = rect.x0 * samples_;
+  int const n = rect.width() * samples_;
+  if (depth_format_ == DepthFormat::kUnorm16) {
+    // 定点数格式清除后为 0
+    for (int y = rect.y0; y < rect.y1; y++) {
+      std::memset(depth_row(y) + x0 * 2, 0, n * 2);
+    }
+    return;
+  }
+  auto const depth = depths::ToKey(depth_format_, depths::kClear);
+  for (int y = rect.y0; y < rect.y1; y++) {
+    simd::Fill32(reinterpret_cast<std::uint32_t *>(depth_row(y)) + x0, n,
+                 depth);
+  }
+}
+
+void FrameBuffer::ClearTile(int tx, int ty) {
+  auto const rect = tile_rect(tx, ty);
+  auto const color = PackColor(background_);
+  for (int y = rect.y0; y < rect.y1; y++) {
+    simd::Fill32(color_row(y) + rect.x0, rect.width(), color);
+  }
+  ClearDepth(rect);
+  // 各采样点的颜色不需要清除，像素重新被分开时会先复制 color_row 中的颜色
+  if (samples_ > 1) {
+    for (int y = rect.y0; y < rect.y1; y++) {
+      std::memset(&multi_color_[rect.x0 + y * width_], 0, rect.width());
+    }
+  }
+  tile_generations_[ty * tiles_x_ + tx] = generation_;
+}
+
+void FrameBuffer::Touch(Rect const &rect) {
+  auto const r = rect.Intersect(bounds());
+  if (r.empty()) {
+    return;
+  }
+  for (int ty = r.y0 / kClearTileSize; ty <= (r.y1 - 1) / kClearTileSize;
+       ty++) {
+    for (int tx = r.x0 / kClearTileSize; tx <= (r.x1 - 1) / kClearTileSize;
+         tx++) {
+      if (!TileCleared(tx, ty)) {
+        ClearTile(tx, ty);
+      }
+    }
+  }
+}
+
+void FrameBuffer::Resolve() {
+  Touch(bounds());
+  if (samples_ > 1) {
+    ResolveSamples();
+  }
+}
+
+void FrameBuffer::ResolveSamples() {
+  // 只有三角形边缘处的像素需要取平均，按行找出连续的一段后整段计算
+  for (int y = 0; y < height_; y++) {
+    auto const flags = &multi_color_[y * width_];
+    auto const end = flags + width_;
+    for (auto p = std::find(flags, end, 1); p != end;) {
+      auto const q = std::find(p, end, 0);
+      int const x = p - flags;
+      simd::Average4x32(&sample_colors_[sample_index(x, y)], color_row(y) + x,
+                        q - p);
+      p = std::find(q, end, 1);
+    }
+  }
+}
+
+std::uint32_t *FrameBuffer::SplitSamples(int x, int y) {
+  auto const colors = &sample_colors_[sample_index(x, y)];
+  auto &flag = multi_color_[x + y * width_];
+  if (!flag) {
+    std::fill(colors, colors + samples_, pixels_[pixel_index(x, y)]);
+    flag = 1;
+  }
+  return colors;
+}
+
+bool FrameBuffer::multi_color(int x, int y) const {
+  return samples_ > 1 && InBound(x, y) &&
+         tile_generations_[tile_index(x, y)] == generation_ &&
+         multi_color_[x + y * width_];
+}
+
+unsigned FrameBuffer::TestSamples(int x, int y, float const *z,
+                                  unsigned coverage, bool write_depth) {
+  auto const depth = &z_buffer_[z_buffer_index(x, y)];
+  return depths::Dispatch(depth_format_, [&](auto traits) {
+    using Traits = decltype(traits);
+    auto const d = reinterpret_cast<typename Traits::Type *>(depth);
+    unsigned passed = 0;
+    for (int s = 0; s < samples_; s++) {
+      if (!(coverage & (1u << s))) {
+        continue;
+      }
+      auto const v = Traits::Encode(z[s]);
+      if (Traits::Key(d[s]) < Traits::Key(v)) {
+        passed |= 1u << s;
+        if (write_depth) {
+          d[s] = v;
+        }
+      }
+    }
+    return passed;
+  });
+}
+
+void FrameBuffer::WriteSamples(int x, int y, unsigned mask,
+                               std::uint32_t color) {
+  unsigned const all = (1u << samples_) - 1;
+  mask &= all;
+  if (mask == 0) {
+    return;
+  }
+  if (mask == all) {
+    if (samples_ > 1) {
+      multi_color_[x + y * width_] = 0;
+    }
+    pixels_[pixel_index(x, y)] = color;
+    return;
+  }
+  auto const colors = SplitSamples(x, y);
+  for (int s = 0; s < samples_; s++) {
+    if (mask & (1u << s)) {
+      colors[s] = color;
+    }
+  }
+  // 三角形的相邻边缘可能让所有采样点重新变为相同的颜色
+  if (std::all_of(colors + 1, colors + samples_,
+                  [&](std::uint32_t c) { return c == colors[0]; })) {
+    multi_color_[x + y * width_] = 0;
+    pixels_[pixel_index(x, y)] = colors[0];
+  }
+}
+
+void FrameBuffer::BlendSamples(int x, int y, unsigned mask,
+                               std::uint32_t color) {
+  unsigned const all = (1u << samples_) - 1;
+  mask &= all;
+  if (mask == 0) {
+    return;
+  }
+  if (mask == all && !multi_color(x, y)) {
+    auto &dst = pixels_[pixel_index(x, y)];
+    dst = BlendPacked(color, dst);
+    return;
+  }
+  auto const colors = SplitSamples(x, y);
+  for (int s = 0; s < samples_; s++) {
+    if (mask & (1u << s)) {
+      colors[s] = BlendPacked(color, colors[s]);
+    }
+  }
 }
 
-int FrameBuffer::z_buffer_index(int x, int y) const { return x + y * width_; }
+std::uint64_t FrameBuffer::ClearedBytes() const {
+  std::uint64_t pixels = 0;
+  for (int ty = 0; ty < tiles_y_; ty++) {
+    for (int tx = 0; tx < tiles_x_; tx++) {
+      if (TileCleared(tx, ty)) {
+        auto const rect = tile_rect(tx, ty);
+        pixels += std::uint64_t(rect.width()) * rect.height();
+      }
+    }
+  }
+  // 多重采样时还要清除每个像素的颜色是否分开存放的标记
+  return pixels * (sizeof(std::uint32_t) + depth_bytes() * samples_ +
+                   (samples_ > 1 ? 1 : 0));
+}
 
 void FrameBuffer::Set(int x, int y, Color const &color) {
   if (!InBound(x, y)) {
     return;
   }
-  int n = data_index(x, y);
-  data_[n] = color.r_hex();
-  data_[n + 1] = color.g_hex();
-  data_[n + 2] = color.b_hex();
-  data_[n + 3] = color.a_hex();
+  TouchPixel(x, y);
+  WriteSamples(x, y, ~0u, PackColor(color));
+}
+
+void FrameBuffer::Blend(int x, int y, Color const &color) {
+  if (!InBound(x, y)) {
+    return;
+  }
+  TouchPixel(x, y);
+  BlendSamples(x, y, ~0u, PackColor(color.Fix()));
+}
+
+void FrameBuffer::FillRow(int y, int x0, int x1, Color const &color) {
+  if (y < 0 || y >= height_) {
+    return;
+  }
+  x0 = std::max(x0, 0);
+  x1 = std::min(x1, width_ - 1);
+  if (x0 > x1) {
+    return;
+  }
+  Touch({x0, y, x1 + 1, y + 1});
+  simd::Fill32(color_row(y) + x0, x1 - x0 + 1, PackColor(color));
+  if (samples_ > 1) {
+    std::memset(&multi_color_[x0 + y * width_], 0, x1 - x0 + 1);
+  }
 }
 
 Color FrameBuffer::Get(int x, int y) {
   if (!InBound(x, y)) {
     return Color{};
   }
-  int n = data_index(x, y);
-  return Color::RGBA(data_[n], data_[n + 1], data_[n + 2], data_[n + 3]);
+  if (tile_generations_[tile_index(x, y)] != generation_) {
+    return background_;
+  }
+  if (multi_color(x, y)) {
+    std::uint32_t avg{};
+    simd::Average4x32(&sample_colors_[sample_index(x, y)], &avg, 1);
+    return UnpackColor(avg);
+  }
+  return UnpackColor(pixels_[pixel_index(x, y)]);
 }
 
 void FrameBuffer::Set(int x, int y, float z, Color const &color) {
   if (!InBound(x, y)) {
     return;
   }
-  z_buffer_[z_buffer_index(x, y)] = z;
-  int n = data_index(x, y);
-  data_[n] = color.r_hex();
-  data_[n + 1] = color.g_hex();
-  data_[n + 2] = color.b_hex();
-  data_[n + 3] = color.a_hex();
+  TouchPixel(x, y);
+  auto const depth = &z_buffer_[z_buffer_index(x, y)];
+  depths::Dispatch(depth_format_, [&](auto traits) {
+    using Traits = decltype(traits);
+    std::fill_n(reinterpret_cast<typename Traits::Type *>(depth), samples_,
+                Traits::Encode(z));
+  });
+  MarkDepthDirty(y, x, x);
+  WriteSamples(x, y, ~0u, PackColor(color));
 }
 
 void FrameBuffer::Resize(int width, int height) {
   width_ = width;
   height_ = height;
-  data_.resize(width * height * 4);
-  z_buffer_.resize(width * height);
-  Clear();
+  stride_ = (width + kRowAlign - 1) / kRowAlign * kRowAlign;
+  pixels_.resize(stride_ * height);
+  z_buffer_.resize(width * height * samples_ * depth_bytes());
+  if (samples_ > 1) {
+    sample_colors_.resize(width * height * samples_);
+    multi_color_.assign(width * height, 0);
+  } else {
+    sample_colors_ = {};
+    multi_color_ = {};
+  }
+  hi_z_.Resize(width * samples_, height, depths::kClear, depth_format_);
+  tiles_x_ = (width + kClearTileSize - 1) / kClearTileSize;
+  tiles_y_ = (height + kClearTileSize - 1) / kClearTileSize;
+  tile_generations_.assign(tiles_x_ * tiles_y_, 0);
+  generation_ = 0;
+  ResetScissor();
+  Clear(background_);
 }
 
-void FrameBuffer::Clear() {
-  std::fill(data_.begin(), data_.end(), 0);
-  std::fill(z_buffer_.begin(), z_buffer_.end(),
-            std::numeric_limits<float>::min());
+void FrameBuffer::Clear(Color const &background) {
+  background_ = background;
+  clear_id_ = ++gClearId;
+  damage_frame_ = 0;
+  damage_.assign(1, bounds());
+  if (++generation_ == 0) {
+    std::fill(tile_generations_.begin(), tile_generations_.end(), 0);
+    generation_ = 1;
+  }
+  hi_z_.Clear(depths::kClear);
+  if (!lazy_clear_) {
+    Resolve();
+  }
+}
+
+void FrameBuffer::ClearRect(Rect const &rect) {
+  auto const r = rect.Intersect(bounds());
+  if (r.empty()) {
+    return;
+  }
+  // 先按块清除本帧尚未清除的块，之后整个 rect 都属于本帧
+  Touch(r);
+  auto const color = PackColor(background_);
+  for (int y = r.y0; y < r.y1; y++) {
+    simd::Fill32(color_row(y) + r.x0, r.width(), color);
+    if (samples_ > 1) {
+      std::memset(&multi_color_[r.x0 + y * width_], 0, r.width());
+    }
+    // 深度变远后分层深度缓冲中的下界需要重新计算
+    MarkDepthDirty(y, r.x0, r.x1 - 1);
+  }
+  ClearDepth(r);
 }
 
 bool FrameBuffer::NeedRender(int x, int y, float z) const {
-  return InBound(x, y) && z_buffer_[z_buffer_index(x, y)] < z;
+  if (!InBound(x, y)) {
+    return false;
+  }
+  auto const key = depths::ToKey(depth_format_, z);
+  if (tile_generations_[tile_index(x, y)] != generation_) {
+    return depths::ToKey(depth_format_, depths::kClear) < key;
+  }
+  // 多重采样时只要有一个采样点更远就需要绘制
+  auto const depth = &z_buffer_[z_buffer_index(x, y)];
+  return depths::Dispatch(depth_format_, [&](auto traits) {
+    using Traits = decltype(traits);
+    auto const d = reinterpret_cast<typename Traits::Type const *>(depth);
+    return std::any_of(d, d + samples_, [key](typename Traits::Type v) {
+      return Traits::Key(v) < key;
+    });
+  });
+}
+
+void FrameBuffer::set_depth_format(DepthFormat format) {
+  if (format == depth_format_) {
+    return;
+  }
+  depth_format_ = format;
+  Resize(width_, height_);
+}
+
+void FrameBuffer::set_samples(int samples) {
+  samples = samples > 1 ? kMaxSamples : 1;
+  if (samples == samples_) {
+    return;
+  }
+  samples_ = samples;
+  Resize(width_, height_);
 }
 
 bool FrameBuffer::InBound(int x, int y) const {
-  if (x < 0 || x >= width_ || y < 0 || y > height_) {
+  if (x < 0 || x >= width_ || y < 0 || y >= height_) {
     return false;
   }
   return true;
 }
 
-void FrameBuffer::FlipVertically() {
-  for (int i = 0; i < width_; i++) {
-    for (int j = 0; j < height_ / 2; j++) {
-      auto const k = height_ - j - 1;
-      SwapAt(i, j, i, k);
-    }
+void FrameBuffer::set_y_origin(YOrigin y_origin) {
+  if (y_origin == y_origin_) {
+    return;
   }
+  // 内存中的行倒序后，每一行在新的顺序下仍对应原来的 y
+  for (int j = 0; j < height_ / 2; j++) {
+    auto const row = &pixels_[j * stride_];
+    std::swap_ranges(row, row + width_, &pixels_[(height_ - j - 1) * stride_]);
+  }
+  y_origin_ = y_origin;
 }
 
-void FrameBuffer::SwapAt(int x1, int y1, int x2, int y2) {
-  auto const idx1 = data_index(x1, y1);
-  auto const idx2 = data_index(x2, y2);
-  std::swap(data_[idx1], data_[idx2]);
-  std::swap(data_[idx1 + 1], data_[idx2 + 1]);
-  std::swap(data_[idx1 + 2], data_[idx2 + 2]);
-  std::swap(data_[idx1 + 3], data_[idx2 + 3]);
+void FrameBuffer::FlipVertically() {
+  Resolve();
+  for (int j = 0; j < height_ / 2; j++) {
+    auto const row = color_row(j);
+    std::swap_ranges(row, row + width_, color_row(height_ - j - 1));
+  }
+  // 翻转后各采样点的颜色不再对应原来的像素，只保留解析后的颜色
+  std::fill(multi_color_.begin(), multi_color_.end(), 0);
 }
 
 }  // namespace sren
@@ -2,14 +2,37 @@
 
 #include <array>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "color.h"
+#include "depth.h"
+#include "hi_z.h"
+#include "rect.h"
+#include "simd.h"
 
 namespace sren {
 
+// 颜色缓冲中的行在内存中的顺序。坐标系的 y 轴总是向上，
+// kBottom 时 y = 0 的行在最前，kTop 时 y = height - 1 的行在最前，
+// 与图片和纹理上传时从上到下的顺序一致
+enum class YOrigin {
+  kBottom,
+  kTop,
+};
+
+// 颜色按 RGBA 字节顺序打包为 32 位存放，每行按缓存行对齐，行间距为 stride。
+// 默认延迟清除：Clear 只增加帧号，每个 kClearTileSize 大小的块记录最后一次清除时的帧号，
+// 块在本帧第一次被写入时才清除为背景色，Resolve 时再填充从未写入的块。
+// 直接写入 depth_row 和 color_row 前需先调用 Touch。
+// 多重采样时每个像素有 samples 个深度，颜色只在三角形边缘处按采样点分开存放：
+// 所有采样点颜色相同的像素只在 color_row 中存一个颜色，
+// 其余像素的各采样点颜色在 Resolve 时取平均后写入 color_row。
 class FrameBuffer {
  public:
+  static constexpr int kClearTileSize = 64;
+  static constexpr int kMaxSamples = 4;
+
   FrameBuffer() = default;
   FrameBuffer(int width, int height) : width_(width), height_(height) {
     Resize(width, height);
@@ -17,31 +40,186 @@ class FrameBuffer {
 
   ~FrameBuffer() = default;
 
+  // 多重采样时写入所有采样点
   void Set(int x, int y, Color const &color);
   void Set(int x, int y, float z, Color const &color);
+  // 按 color 的 alpha 与 (x, y) 处已有的颜色混合
+  void Blend(int x, int y, Color const &color);
+
+  // 多重采样时对 (x, y) 中 coverage 包含的采样点做深度测试，z[s] 为采样点 s 的深度，
+  // 返回通过测试的采样点掩码，write_depth 时写入通过的采样点的深度。
+  // 像素所在的块需已清除，写入深度后需调用 MarkDepthDirty
+  unsigned TestSamples(int x, int y, float const *z, unsigned coverage,
+                       bool write_depth);
+  // 将 mask 包含的采样点的颜色设为打包的 color，覆盖所有采样点时像素恢复为单个颜色
+  void WriteSamples(int x, int y, unsigned mask, std::uint32_t color);
+  // 按 color 的 alpha 与 mask 包含的采样点已有的颜色混合
+  void BlendSamples(int x, int y, unsigned mask, std::uint32_t color);
+  // 将 y 行 [x0, x1] 范围内的像素设为 color，超出帧缓冲的部分忽略
+  void FillRow(int y, int x0, int x1, Color const &color);
   Color Get(int x, int y);
-  void Clear();
+  // 将颜色清除为 background，深度清除为最远
+  void Clear(Color const &background = Color{});
+  // 立即将 rect 内的颜色清除为当前背景色，深度清除为最远，不开始新的一帧，
+  // 用于只重绘部分区域
+  void ClearRect(Rect const &rect);
   void Resize(int width, int height);
   bool NeedRender(int x, int y, float z) const;
+  // 上下翻转图像，翻转前会先调用 Resolve
   void FlipVertically();
 
+  // 清除 rect 覆盖的块中本帧尚未清除的块，不同线程可以同时处理互不相交的块
+  void Touch(Rect const &rect);
+  // 清除所有本帧尚未清除的块，多重采样时将各采样点的颜色取平均，
+  // 之后 data 和 color_row 中的内容都是本帧的结果
+  void Resolve();
+  // 块 (tx, ty) 在本帧是否已清除，未清除的块中所有像素都应视为背景色
+  bool TileCleared(int tx, int ty) const {
+    return tile_generations_[ty * tiles_x_ + tx] == generation_;
+  }
+  // 本帧清除所写入的颜色和深度的字节数
+  std::uint64_t ClearedBytes() const;
+  // 每次 Clear 时从全局计数器取得的编号，不同帧缓冲之间也不重复。
+  // 编号不变时帧缓冲中仍是上次绘制的内容
+  std::uint64_t clear_id() const { return clear_id_; }
+
+  // 最近一帧相对前一帧改变的区域，以及这一帧的帧号，帧号为 0 时表示未知。
+  // Clear 后为整个帧缓冲，增量渲染时由 Scene 设置，呈现时可以只上传这些区域
+  std::vector<Rect> const &damage() const { return damage_; }
+  std::uint64_t damage_frame() const { return damage_frame_; }
+  void set_damage(std::uint64_t frame, std::vector<Rect> rects) {
+    damage_frame_ = frame;
+    damage_ = std::move(rects);
+  }
+
+  // 改变后已有的图像保持不变，只重新排列内存中的行
+  YOrigin y_origin() const { return y_origin_; }
+  void set_y_origin(YOrigin y_origin);
+
+  Color const &background() const { return background_; }
+  // 关闭时 Clear 立即清除整个帧缓冲
+  bool lazy_clear() const { return lazy_clear_; }
+  void set_lazy_clear(bool lazy_clear) { lazy_clear_ = lazy_clear; }
+
+  // 改变格式会重新分配深度缓冲并清除整个帧缓冲
+  DepthFormat depth_format() const { return depth_format_; }
+  void set_depth_format(DepthFormat format);
+  // 每个采样点的深度占用的字节数
+  int depth_bytes() const { return depths::BytesPerPixel(depth_format_); }
+
+  // 每个像素的采样点数，只支持 1 和 kMaxSamples，改变时重新分配并清除整个帧缓冲
+  int samples() const { return samples_; }
+  void set_samples(int samples);
+  // (x, y) 的各采样点颜色是否分开存放，此时 color_row 中的颜色在 Resolve 后才有效
+  bool multi_color(int x, int y) const;
+
+  // 第 y 行像素的深度，按 depth_format 的格式存放，
+  // 多重采样时每个像素的各采样点深度连续存放
+  std::uint8_t *depth_row(int y) { return &z_buffer_[z_buffer_index(0, y)]; }
+  // 第 y 行像素的颜色，起始地址按缓存行对齐
+  std::uint32_t *color_row(int y) { return &pixels_[memory_row(y) * stride_]; }
+  std::uint32_t const *color_row(int y) const {
+    return &pixels_[memory_row(y) * stride_];
+  }
+
+  // 直接写入 depth_row 后需标记 y 行 [x0, x1] 的深度已变化
+  void MarkDepthDirty(int y, int x0, int x1) {
+    hi_z_.MarkDirty(y, x0 * samples_, x1 * samples_ + samples_ - 1);
+  }
+  // rect 内深度为 z 的片元是否必然无法通过深度测试。
+  // 多重采样时分层深度缓冲按采样点划分，每个块在 x 方向上覆盖的像素更少
+  bool DepthOccluded(Rect const &rect, float z) {
+    return hi_z_.Occluded(
+        {rect.x0 * samples_, rect.y0, rect.x1 * samples_, rect.y1}, z,
+        z_buffer_.data());
+  }
+  HiZ &hi_z() { return hi_z_; }
+  HiZ const &hi_z() const { return hi_z_; }
+
+  // 将颜色按帧缓冲中的 RGBA 字节顺序打包
+  static std::uint32_t PackColor(Color const &color);
+  static Color UnpackColor(std::uint32_t packed);
+  // 按 src 的 alpha 将打包的颜色 src 与 dst 混合，与 Color::SetBlend 一致，
+  // 全程使用 8 位整数运算
+  static std::uint32_t BlendPacked(std::uint32_t src, std::uint32_t dst);
+
+  // 整个帧缓冲的范围
+  Rect bounds() const { return {0, 0, width_, height_}; }
+  // 光栅化只写入裁剪矩形内的像素，默认为整个帧缓冲，改变大小时重置
+  Rect const &scissor() const { return scissor_; }
+  void set_scissor(Rect const &scissor) { scissor_ = scissor.Intersect(bounds()); }
+  void ResetScissor() { scissor_ = bounds(); }
+
   int width() const { return width_; }
   int height() const { return height_; }
-  int size() const { return data_.size(); }
-  std::uint8_t *data() { return data_.data(); }
-  std::uint8_t const *data() const { return data_.data(); }
+  // 每行占用的像素数，不小于 width
+  int stride() const { return stride_; }
+  // 颜色数据的字节数，行按 y_origin 的顺序排列
+  int size() const { return pixels_.size() * sizeof(std::uint32_t); }
+  std::uint8_t *data() {
+    return reinterpret_cast<std::uint8_t *>(pixels_.data());
+  }
+  std::uint8_t const *data() const {
+    return reinterpret_cast<std::uint8_t const *>(pixels_.data());
+  }
 
  private:
+  template <class T>
+  using AlignedVector = std::vector<T, simd::AlignedAllocator<T>>;
+
   bool InBound(int x, int y) const;
-  void SwapAt(int x1, int y1, int x2, int y2);
+  int tile_index(int x, int y) const {
+    return y / kClearTileSize * tiles_x_ + x / kClearTileSize;
+  }
+  Rect tile_rect(int tx, int ty) const;
+  void ClearTile(int tx, int ty);
+  // 像素所在的块已清除后才能读写
+  void TouchPixel(int x, int y) {
+    auto &gen = tile_generations_[tile_index(x, y)];
+    if (gen != generation_) {
+      ClearTile(x / kClearTileSize, y / kClearTileSize);
+    }
+  }
+
+  // 按格式将 rect 内所有采样点的深度清除为 depths::kClear
+  void ClearDepth(Rect const &rect);
+  // 多重采样时将各采样点颜色不同的像素取平均后写入 color_row
+  void ResolveSamples();
+  // 让 (x, y) 的各采样点分开存放颜色，之前的颜色复制到所有采样点
+  std::uint32_t *SplitSamples(int x, int y);
 
-  int data_index(int x, int y) const;
+  // 第 y 行在内存中是第几行
+  int memory_row(int y) const {
+    return y_origin_ == YOrigin::kTop ? height_ - 1 - y : y;
+  }
+  int pixel_index(int x, int y) const;
+  // 深度缓冲中像素第一个采样点的字节偏移
   int z_buffer_index(int x, int y) const;
+  int sample_index(int x, int y) const { return (x + y * width_) * samples_; }
 
   int width_{};
   int height_{};
-  std::vector<std::uint8_t> data_{};
-  std::vector<float> z_buffer_{};
+  int stride_{};
+  AlignedVector<std::uint32_t> pixels_{};
+  AlignedVector<std::uint8_t> z_buffer_{};
+  DepthFormat depth_format_{DepthFormat::kFloat32};
+  int samples_{1};
+  // 各采样点的颜色按 y 而不是 y_origin 的顺序存放，只有 multi_color_ 的像素有效
+  AlignedVector<std::uint32_t> sample_colors_{};
+  std::vector<std::uint8_t> multi_color_{};
+  HiZ hi_z_{};
+  Rect scissor_{};
+  YOrigin y_origin_{YOrigin::kBottom};
+  Color background_{};
+  bool lazy_clear_{true};
+  // 当前帧号，每次 Clear 加 1，从 1 开始
+  std::uint32_t generation_{};
+  std::uint64_t clear_id_{};
+  std::uint64_t damage_frame_{};
+  std::vector<Rect> damage_{};
+  int tiles_x_{};
+  int tiles_y_{};
+  std::vector<std::uint32_t> tile_generations_{};
 };
 
 }  // namespace sren
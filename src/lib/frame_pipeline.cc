@@ -0,0 +1,148 @@
+#include "frame_pipeline.h"
+
+#include <cassert>
+
+#include "math.h"
+
+namespace sren {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+float Ms(Clock::duration d) {
+  return std::chrono::duration<float, std::milli>(d).count();
+}
+
+// 指数滑动平均，第一次直接取样本
+void Smooth(float sample, float *avg) {
+  constexpr float kWeight = 0.1f;
+  *avg = *avg == 0.0f ? sample : *avg + (sample - *avg) * kWeight;
+}
+
+}  // namespace
+
+FramePipeline::~FramePipeline() {
+  Sync();
+  StopThread();
+}
+
+void FramePipeline::Resize(int width, int height, YOrigin y_origin) {
+  Sync();
+  for (auto &fb : buffers_) {
+    fb.set_y_origin(y_origin);
+    fb.Resize(width, height);
+  }
+  ResetBuffers();
+}
+
+void FramePipeline::set_latency(int latency) {
+  latency = Clamp(1, kMaxLatency, latency);
+  if (latency == latency_) {
+    return;
+  }
+  Sync();
+  latency_ = latency;
+  ResetBuffers();
+  if (latency_ > 1) {
+    StartThread();
+  } else {
+    StopThread();
+  }
+}
+
+void FramePipeline::ResetBuffers() {
+  ready_.clear();
+  free_.clear();
+  // 倒序放入，串行时总是使用 buffer(0)
+  for (int i = latency_ - 1; i >= 0; i--) {
+    free_.push_back(&buffers_[i]);
+  }
+}
+
+void FramePipeline::Sync() {
+  while (rendering_ > 0) {
+    Done done{};
+    WaitUntil([&] { return done_.Pop(&done); });
+    rendering_--;
+    ready_.push_back(done.fb);
+    Smooth(done.render_ms, &stats_.render_ms);
+  }
+}
+
+void FramePipeline::Submit() {
+  auto const now = Clock::now();
+  if (last_submit_ != Clock::time_point{}) {
+    Smooth(Ms(now - last_submit_), &stats_.frame_ms);
+  }
+  last_submit_ = now;
+
+  assert(!free_.empty());
+  auto const fb = free_.back();
+  free_.pop_back();
+  if (!thread_.joinable()) {
+    Smooth(Render(fb), &stats_.render_ms);
+    ready_.push_back(fb);
+    return;
+  }
+  bool const pushed = todo_.Push(fb);
+  assert(pushed);
+  (void)pushed;
+  rendering_++;
+}
+
+FrameBuffer *FramePipeline::Acquire() {
+  // 在途帧数达到 latency 时才呈现最早的一帧，否则继续积累
+  if (ready_.empty() || int(ready_.size()) + rendering_ < latency_) {
+    return nullptr;
+  }
+  auto const fb = ready_.front();
+  ready_.pop_front();
+  acquire_time_ = Clock::now();
+  return fb;
+}
+
+void FramePipeline::Release(FrameBuffer *fb) {
+  Smooth(Ms(Clock::now() - acquire_time_), &stats_.present_ms);
+  free_.push_back(fb);
+}
+
+void FramePipeline::StartThread() {
+  if (thread_.joinable()) {
+    return;
+  }
+  quit_ = false;
+  thread_ = std::thread([this] { RenderLoop(); });
+}
+
+void FramePipeline::StopThread() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  quit_ = true;
+  thread_.join();
+}
+
+void FramePipeline::RenderLoop() {
+  for (;;) {
+    FrameBuffer *fb = nullptr;
+    WaitUntil([&] { return quit_ || todo_.Pop(&fb); });
+    if (fb == nullptr) {
+      return;
+    }
+    float const ms = Render(fb);
+    bool const pushed = done_.Push({fb, ms});
+    assert(pushed);
+    (void)pushed;
+  }
+}
+
+float FramePipeline::Render(FrameBuffer *fb) {
+  auto const start = Clock::now();
+  if (render_func_) {
+    render_func_(fb);
+  }
+  return Ms(Clock::now() - start);
+}
+
+}  // namespace sren
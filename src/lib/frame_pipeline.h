@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "frame_buffer.h"
+#include "spsc_queue.h"
+
+namespace sren {
+
+// 流水线各阶段每帧的平均耗时（毫秒）
+struct FramePipelineStats {
+  // 渲染线程绘制一帧
+  float render_ms{};
+  // 主线程从取出一帧到归还该帧，即上传呈现所用的时间
+  float present_ms{};
+  // 相邻两次提交之间的间隔，即实际的帧时间
+  float frame_ms{};
+
+  // 渲染与呈现重叠带来的吞吐提升，串行时约为 1
+  float overlap() const {
+    return frame_ms > 0.0f ? (render_ms + present_ms) / frame_ms : 1.0f;
+  }
+};
+
+// 渲染与呈现的流水线。latency 为同时在途的帧数：
+// 为 1 时在调用线程中串行渲染；大于 1 时由渲染线程绘制第 N + 1 帧，
+// 同时主线程呈现第 N 帧，两个线程通过无锁的单生产者单消费者队列交接帧缓冲。
+// 主线程每帧依次调用 Sync、Submit、Acquire 和 Release，
+// Sync 返回后渲染线程不再访问场景，主线程可以安全地修改场景。
+class FramePipeline {
+ public:
+  using RenderFunc = std::function<void(FrameBuffer *)>;
+
+  static constexpr int kMaxLatency = 3;
+
+  FramePipeline() = default;
+  ~FramePipeline();
+
+  FramePipeline(FramePipeline const &) = delete;
+  void operator=(FramePipeline const &) = delete;
+
+  // 设置所有帧缓冲的大小和行顺序，使用前必须调用。
+  // 与 set_latency 一样不能在 Acquire 和 Release 之间调用
+  void Resize(int width, int height, YOrigin y_origin);
+
+  int latency() const { return latency_; }
+  // 改变在途帧数，范围为 [1, kMaxLatency]，会先等待渲染线程空闲并丢弃尚未呈现的帧
+  void set_latency(int latency);
+
+  // 在渲染线程中绘制一帧的函数
+  void set_render_func(RenderFunc func) { render_func_ = std::move(func); }
+
+  // 等待已提交的帧全部绘制完成
+  void Sync();
+  // 提交一帧，绘制到空闲的帧缓冲中
+  void Submit();
+  // 取出最早完成且已到呈现时机的帧，没有时返回 nullptr，呈现后需调用 Release
+  FrameBuffer *Acquire();
+  void Release(FrameBuffer *fb);
+
+  // 串行使用时直接绘制的帧缓冲
+  FrameBuffer &buffer(int i) { return buffers_[i]; }
+
+  FramePipelineStats const &stats() const { return stats_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // 丢弃尚未呈现的帧，所有帧缓冲重新变为空闲，需在 Sync 之后调用
+  void ResetBuffers();
+  void StartThread();
+  void StopThread();
+  void RenderLoop();
+  // 在调用线程中绘制一帧，返回耗时（毫秒）
+  float Render(FrameBuffer *fb);
+
+  int latency_{1};
+  std::array<FrameBuffer, kMaxLatency> buffers_{};
+  RenderFunc render_func_{};
+
+  // 以下只在主线程中访问
+  std::vector<FrameBuffer *> free_{};
+  std::deque<FrameBuffer *> ready_{};
+  // 已提交但尚未确认完成的帧数
+  int rendering_{};
+  Clock::time_point last_submit_{};
+  Clock::time_point acquire_time_{};
+  FramePipelineStats stats_{};
+
+  // 主线程交给渲染线程的帧和渲染线程完成的帧
+  struct Done {
+    FrameBuffer *fb;
+    float render_ms;
+  };
+  SpscQueue<FrameBuffer *, kMaxLatency + 1> todo_{};
+  SpscQueue<Done, kMaxLatency + 1> done_{};
+  std::atomic<bool> quit_{};
+  std::thread thread_{};
+};
+
+}  // namespace sren
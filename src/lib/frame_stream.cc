@@ -0,0 +1,322 @@
+#include "frame_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "math.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SREN_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sren {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Ms(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+char const kY4mFrame[] = "FRAME\n";
+constexpr std::size_t kY4mFrameBytes = sizeof(kY4mFrame) - 1;
+
+// 内存映射每次向后扩展的帧数，扩展时需要重新映射并增大文件
+constexpr std::size_t kMapFrames = 16;
+
+int ChromaSize(int n) { return (n + 1) / 2; }
+
+}  // namespace
+
+FrameStream::~FrameStream() { Close(); }
+
+void FrameStream::set_buffers(int n) { nbuffers_ = Clamp(1, kMaxBuffers, n); }
+
+bool FrameStream::Open(std::string const &path, int width, int height,
+                       StreamFormat format) {
+  Close();
+  if (path == "-") {
+    return Open(stdout, width, height, format);
+  }
+  // 共享的可写映射要求文件以读写方式打开
+  auto const file = std::fopen(path.c_str(), mmap_ ? "w+b" : "wb");
+  if (!file) {
+    return false;
+  }
+  file_ = file;
+  owns_file_ = true;
+#if defined(SREN_HAS_MMAP)
+  // 管道和设备文件不能映射，只映射普通文件
+  struct stat st {};
+  if (mmap_ && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode)) {
+    map_fd_ = fileno(file);
+  }
+#endif
+  return Start(width, height, format);
+}
+
+bool FrameStream::Open(std::FILE *file, int width, int height,
+                       StreamFormat format) {
+  Close();
+  file_ = file;
+  owns_file_ = false;
+  return Start(width, height, format);
+}
+
+bool FrameStream::Start(int width, int height, StreamFormat format) {
+  failed_ = false;
+  width_ = width;
+  height_ = height;
+  format_ = format;
+  frame_bytes_ = std::size_t(width) * height * 4;
+  if (format == StreamFormat::kY4m) {
+    frame_bytes_ = kY4mFrameBytes + std::size_t(width) * height +
+                   2 * std::size_t(ChromaSize(width)) * ChromaSize(height);
+    staging_.resize(frame_bytes_);
+    // 文件头总是通过 fwrite 写出，之后的帧从其后开始映射
+    std::fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width,
+                 height, fps_);
+  }
+  offset_ = 0;
+  if (std::fflush(file_) != 0 || width <= 0 || height <= 0) {
+    failed_ = true;
+    Close();
+    return false;
+  }
+  if (map_fd_ >= 0) {
+    offset_ = std::uint64_t(std::ftell(file_));
+  }
+
+  slots_.resize(nbuffers_);
+  for (int i = 0; i < nbuffers_; i++) {
+    slots_[i].resize(std::size_t(width) * height * 4);
+    free_.Push(i);
+  }
+  frames_ = 0;
+  copy_total_ = 0.0;
+  stall_total_ = 0.0;
+  write_total_ = 0.0;
+  thread_ = std::thread([this] { WriteLoop(); });
+  return true;
+}
+
+bool FrameStream::Close() {
+  if (thread_.joinable()) {
+    WaitUntil([&] { return ready_.Push(-1); });
+    thread_.join();
+  }
+  // 写线程已退出，取回所有缓冲
+  int slot = 0;
+  while (free_.Pop(&slot)) {
+  }
+  if (!file_) {
+    return false;
+  }
+#if defined(SREN_HAS_MMAP)
+  if (map_fd_ >= 0) {
+    Unmap();
+    // 去掉最后一次映射时多扩展的部分
+    if (ftruncate(map_fd_, off_t(offset_)) != 0) {
+      failed_ = true;
+    }
+    map_fd_ = -1;
+  }
+#endif
+  if (owns_file_) {
+    failed_ = std::fclose(file_) != 0 || failed_;
+  } else if (std::fflush(file_) != 0) {
+    failed_ = true;
+  }
+  file_ = nullptr;
+  staging_ = {};
+  return !failed_;
+}
+
+bool FrameStream::Write(FrameBuffer *fb) {
+  if (!is_open() || failed_ || fb->width() != width_ ||
+      fb->height() != height_) {
+    return false;
+  }
+  auto const start = Clock::now();
+  int slot = 0;
+  WaitUntil([&] { return free_.Pop(&slot); });
+  auto const acquired = Clock::now();
+  fb->Resolve();
+  auto dst = slots_[slot].data();
+  std::size_t const row_bytes = std::size_t(width_) * 4;
+  for (int y = height_ - 1; y >= 0; y--) {
+    std::memcpy(dst, fb->color_row(y), row_bytes);
+    dst += row_bytes;
+  }
+  bool const pushed = ready_.Push(slot);
+  (void)pushed;
+  frames_++;
+  stall_total_ += Ms(acquired - start);
+  copy_total_ += Ms(Clock::now() - acquired);
+  return true;
+}
+
+FrameStreamStats FrameStream::stats() const {
+  FrameStreamStats stats{};
+  stats.frames = frames_;
+  stats.bytes = frames_ * frame_bytes_;
+  if (frames_ > 0) {
+    stats.copy_ms = float(copy_total_ / frames_);
+    stats.stall_ms = float(stall_total_ / frames_);
+    // 写线程的耗时在其退出之后才能读取
+    if (!is_open()) {
+      stats.write_ms = float(write_total_ / frames_);
+    }
+  }
+  return stats;
+}
+
+void FrameStream::WriteLoop() {
+  for (;;) {
+    int slot = -1;
+    WaitUntil([&] { return ready_.Pop(&slot); });
+    if (slot < 0) {
+      return;
+    }
+    auto const start = Clock::now();
+    // 失败后继续归还缓冲，渲染线程不会阻塞，之后的 Write 返回 false
+    if (!failed_ && !WriteFrame(slot)) {
+      failed_ = true;
+    }
+    write_total_ += Ms(Clock::now() - start);
+    free_.Push(slot);
+  }
+}
+
+bool FrameStream::WriteFrame(int slot) {
+  auto const rgba = slots_[slot].data();
+  if (map_fd_ >= 0) {
+    auto const dst = Map(frame_bytes_);
+    if (!dst) {
+      return false;
+    }
+    Encode(rgba, dst);
+    offset_ += frame_bytes_;
+    return true;
+  }
+  // RGBA 帧与缓冲中的内容相同，直接写出
+  auto src = rgba;
+  if (format_ != StreamFormat::kRgba) {
+    Encode(rgba, staging_.data());
+    src = staging_.data();
+  }
+  return std::fwrite(src, 1, frame_bytes_, file_) == frame_bytes_;
+}
+
+void FrameStream::Encode(std::uint8_t const *rgba, std::uint8_t *dst) const {
+  if (format_ == StreamFormat::kRgba) {
+    std::memcpy(dst, rgba, frame_bytes_);
+    return;
+  }
+  std::memcpy(dst, kY4mFrame, kY4mFrameBytes);
+  streams::RgbaToI420(rgba, width_, height_, dst + kY4mFrameBytes);
+}
+
+#if defined(SREN_HAS_MMAP)
+
+std::uint8_t *FrameStream::Map(std::size_t bytes) {
+  if (offset_ + bytes > map_begin_ + map_size_) {
+    Unmap();
+    // 映射的起点须按页对齐
+    auto const page = std::uint64_t(sysconf(_SC_PAGESIZE));
+    map_begin_ = offset_ / page * page;
+    map_size_ = std::size_t(offset_ - map_begin_) + bytes * kMapFrames;
+    if (ftruncate(map_fd_, off_t(map_begin_ + map_size_)) != 0) {
+      return nullptr;
+    }
+    auto const addr = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, map_fd_, off_t(map_begin_));
+    if (addr == MAP_FAILED) {
+      map_size_ = 0;
+      return nullptr;
+    }
+    map_ = static_cast<std::uint8_t *>(addr);
+  }
+  return map_ + (offset_ - map_begin_);
+}
+
+void FrameStream::Unmap() {
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+  map_ = nullptr;
+  map_begin_ = 0;
+  map_size_ = 0;
+}
+
+#else
+
+std::uint8_t *FrameStream::Map(std::size_t) { return nullptr; }
+
+void FrameStream::Unmap() {}
+
+#endif
+
+namespace streams {
+
+StreamFormat FormatFromPath(std::string const &path) {
+  std::string const ext = ".rgba";
+  return path.size() >= ext.size() &&
+                 path.compare(path.size() - ext.size(), ext.size(), ext) == 0
+             ? StreamFormat::kRgba
+             : StreamFormat::kY4m;
+}
+
+void RgbaToI420(std::uint8_t const *rgba, int width, int height,
+                std::uint8_t *dst) {
+  int const cw = ChromaSize(width);
+  int const ch = ChromaSize(height);
+  auto const u_plane = dst + width * height;
+  auto const v_plane = u_plane + cw * ch;
+  // 每次处理两行，像素只读一遍，同时求出亮度和色度
+  for (int cy = 0; cy < ch; cy++) {
+    int const y0 = cy * 2;
+    int const y1 = std::min(y0 + 1, height - 1);
+    std::uint8_t const *const src[] = {rgba + std::size_t(y0) * width * 4,
+                                       rgba + std::size_t(y1) * width * 4};
+    // 奇数高度的最后一行的亮度写两遍，不会越界
+    std::uint8_t *const luma[] = {dst + std::size_t(y0) * width,
+                                  dst + std::size_t(y1) * width};
+    auto const u_row = u_plane + cy * cw;
+    auto const v_row = v_plane + cy * cw;
+    for (int cx = 0; cx < cw; cx++) {
+      int const x0 = cx * 2;
+      int const x1 = std::min(x0 + 1, width - 1);
+      // 四个像素的和，相当于放大 4 倍的平均值
+      int r = 0;
+      int g = 0;
+      int b = 0;
+      for (int k = 0; k < 2; k++) {
+        for (int x : {x0, x1}) {
+          auto const p = src[k] + x * 4;
+          // JPEG 使用的全范围 BT.601，系数放大 256 倍后取整
+          luma[k][x] =
+              std::uint8_t((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+          r += p[0];
+          g += p[1];
+          b += p[2];
+        }
+      }
+      // 放大 256 * 4 倍后加上 128 的偏移，舍入时少加 1 使纯红和纯蓝的
+      // 结果恰好为 255，因此结果总在 [0, 255] 内
+      u_row[cx] =
+          std::uint8_t((-43 * r - 85 * g + 128 * b + (128 << 10) + 511) >> 10);
+      v_row[cx] =
+          std::uint8_t((128 * r - 107 * g - 21 * b + (128 << 10) + 511) >> 10);
+    }
+  }
+}
+
+}  // namespace streams
+
+}  // namespace sren
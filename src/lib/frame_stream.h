@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_buffer.h"
+#include "spsc_queue.h"
+
+namespace sren {
+
+// 连续写出的帧的格式
+enum class StreamFormat {
+  // 每帧为 width * height 个 RGBA 像素，第一行为图像顶部，没有文件头。
+  // 可直接交给 ffmpeg -f rawvideo -pix_fmt rgba 读取
+  kRgba,
+  // YUV4MPEG2 格式，4:2:0 全范围 BT.601，文件头带有大小和帧率，丢弃 alpha
+  kY4m,
+};
+
+// 写出统计，平均值均为每帧的毫秒数
+struct FrameStreamStats {
+  std::uint64_t frames{};
+  std::uint64_t bytes{};
+  // 渲染线程把帧缓冲拷贝到环形缓冲中
+  float copy_ms{};
+  // 渲染线程等待空闲缓冲，即写出跟不上渲染时阻塞的时间
+  float stall_ms{};
+  // 写线程转换格式并写出，Close 之后才有效
+  float write_ms{};
+};
+
+// 将帧按顺序写入文件或管道的输出流。
+// Write 只把帧拷贝到预先分配的环形缓冲中，格式转换和写出在单独的写线程中进行，
+// 写出较慢时环形缓冲可以吸收短暂的抖动，全部占满时 Write 才会等待。
+// 输出为普通文件且开启 mmap 时，写线程通过内存映射直接写入文件。
+class FrameStream {
+ public:
+  static constexpr int kMaxBuffers = 8;
+
+  FrameStream() = default;
+  ~FrameStream();
+
+  FrameStream(FrameStream const &) = delete;
+  void operator=(FrameStream const &) = delete;
+
+  // 以下设置在 Open 之前调用才生效
+  // 环形缓冲的个数，范围为 [1, kMaxBuffers]
+  void set_buffers(int n);
+  // Y4M 文件头中的帧率
+  void set_fps(int fps) { fps_ = fps; }
+  // 普通文件通过内存映射写入，不支持时退回到 fwrite
+  void set_mmap(bool mmap) { mmap_ = mmap; }
+
+  // 创建并打开 path 写入 width * height 的帧，path 为 "-" 时写到标准输出
+  bool Open(std::string const &path, int width, int height,
+            StreamFormat format);
+  // 写到已打开的文件或管道，如 popen 返回的管道，Close 时不关闭 file
+  bool Open(std::FILE *file, int width, int height, StreamFormat format);
+  // 等待所有帧写出并关闭输出，之前的写出都成功时返回 true
+  bool Close();
+
+  // 追加一帧，大小须与 Open 时一致。会先调用 Resolve，
+  // 返回后可以立即修改 fb。未打开或写出已经失败时返回 false
+  bool Write(FrameBuffer *fb);
+
+  bool is_open() const { return thread_.joinable(); }
+  // 是否正在通过内存映射写入
+  bool mapped() const { return map_fd_ >= 0; }
+  // 每帧写出的字节数，包括 Y4M 每帧的 FRAME 标记
+  std::size_t frame_bytes() const { return frame_bytes_; }
+  FrameStreamStats stats() const;
+
+ private:
+  bool Start(int width, int height, StreamFormat format);
+  void WriteLoop();
+  // 将第 slot 个缓冲中的帧写出
+  bool WriteFrame(int slot);
+  // 将一帧按输出格式编码到 dst 中，共 frame_bytes 字节
+  void Encode(std::uint8_t const *rgba, std::uint8_t *dst) const;
+  // 保证文件中 [offset_, offset_ + bytes) 已被映射，返回其地址
+  std::uint8_t *Map(std::size_t bytes);
+  void Unmap();
+
+  int nbuffers_{3};
+  int fps_{60};
+  bool mmap_{};
+
+  std::FILE *file_{};
+  bool owns_file_{};
+  int width_{};
+  int height_{};
+  StreamFormat format_{StreamFormat::kRgba};
+  std::size_t frame_bytes_{};
+  // 通过内存映射写入时为文件的描述符，否则为 -1
+  int map_fd_{-1};
+
+  // 环形缓冲，每个存放一帧从上到下紧密排列的 RGBA 像素
+  std::vector<std::vector<std::uint8_t>> slots_{};
+  // 渲染线程交给写线程的缓冲和写线程归还的缓冲，-1 表示结束
+  SpscQueue<int, kMaxBuffers + 2> ready_{};
+  SpscQueue<int, kMaxBuffers + 2> free_{};
+  std::atomic<bool> failed_{};
+  std::thread thread_{};
+
+  // 以下只在渲染线程中访问
+  std::uint64_t frames_{};
+  double copy_total_{};
+  double stall_total_{};
+
+  // 以下只在写线程中访问，Close 之后可以读取
+  std::vector<std::uint8_t> staging_{};
+  std::uint64_t offset_{};
+  double write_total_{};
+  std::uint8_t *map_{};
+  std::uint64_t map_begin_{};
+  std::size_t map_size_{};
+};
+
+namespace streams {
+
+// 按扩展名选择格式，.rgba 为原始 RGBA，其他均为 Y4M
+StreamFormat FormatFromPath(std::string const &path);
+
+// 将从上到下紧密排列的 RGBA 像素转换为 4:2:0 的 Y、U、V 三个平面，
+// 依次写入 dst，色度取 2x2 像素的平均，奇数边长时最后一列或一行单独成块
+void RgbaToI420(std::uint8_t const *rgba, int width, int height,
+                std::uint8_t *dst);
+
+}  // namespace streams
+
+}  // namespace sren
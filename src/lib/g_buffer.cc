@@ -0,0 +1,51 @@
+#include "g_buffer.h"
+
+#include <algorithm>
+
+namespace sren {
+
+void GBuffer::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  samples_.resize(width * height);
+  Clear();
+}
+
+void GBuffer::Clear() {
+  for (auto &s : samples_) {
+    s.material = 0;
+  }
+  materials_.clear();
+}
+
+void GBuffer::Clear(Rect const &rect) {
+  auto const r = rect.Intersect({0, 0, width_, height_});
+  if (!r.empty()) {
+    for (int y = r.y0; y < r.y1; y++) {
+      auto const samples = row(y);
+      for (int x = r.x0; x < r.x1; x++) {
+        samples[x].material = 0;
+      }
+    }
+  }
+  materials_.clear();
+}
+
+std::uint32_t GBuffer::AddMaterial(Object const *obj) {
+  auto const id = MaterialId(obj);
+  if (id != 0) {
+    return id;
+  }
+  materials_.push_back(obj);
+  return std::uint32_t(materials_.size());
+}
+
+std::uint32_t GBuffer::MaterialId(Object const *obj) const {
+  auto const it = std::find(materials_.begin(), materials_.end(), obj);
+  if (it == materials_.end()) {
+    return 0;
+  }
+  return std::uint32_t(it - materials_.begin()) + 1;
+}
+
+}  // namespace sren
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rect.h"
+
+namespace sren {
+
+class Object;
+
+// G-buffer 中一个像素的几何属性
+struct GSample {
+  float normal[3];
+  float world_pos[3];
+  // 使用纹理着色时前两个为 uv，否则为顶点颜色 rgba
+  float attr[4];
+  // 着色所用材质的编号，0 表示该像素没有几何体
+  std::uint32_t material;
+};
+
+// 延迟着色的几何缓冲，按行存放每个像素的 GSample，深度仍保存在帧缓冲中。
+// 材质编号对应本帧登记的物体，着色时使用物体的材质和渲染方式。
+class GBuffer {
+ public:
+  GBuffer() = default;
+
+  // 按屏幕大小重新分配，并清空所有像素和材质
+  void Resize(int width, int height);
+  // 清空所有像素和材质，保留大小
+  void Clear();
+  // 只清空 rect 内的像素，并清空所有材质。着色只读取清空过的区域时，
+  // 区域外残留的旧材质编号不会被使用
+  void Clear(Rect const &rect);
+
+  // 登记物体并返回其材质编号，同一物体重复登记返回同一编号
+  std::uint32_t AddMaterial(Object const *obj);
+  // 物体的材质编号，未登记时返回 0
+  std::uint32_t MaterialId(Object const *obj) const;
+  Object const *material(std::uint32_t id) const { return materials_[id - 1]; }
+
+  GSample *row(int y) { return &samples_[y * width_]; }
+  GSample const *row(int y) const { return &samples_[y * width_]; }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+ private:
+  int width_{};
+  int height_{};
+  std::vector<GSample> samples_{};
+  std::vector<Object const *> materials_{};
+};
+
+}  // namespace sren
@@ -0,0 +1,91 @@
+#include "headless.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "camera.h"
+#include "image.h"
+#include "math.h"
+#include "object.h"
+
+namespace sren {
+
+Headless::Headless(int width, int height) : frame_buffer_(width, height) {
+  // 图片按从上到下的顺序保存，行顺序一致时可直接写出
+  frame_buffer_.set_y_origin(YOrigin::kTop);
+}
+
+std::string Headless::OutputPath(int frame) const {
+  auto const n = std::snprintf(nullptr, 0, output_.c_str(), frame);
+  std::vector<char> path(n + 1);
+  std::snprintf(path.data(), path.size(), output_.c_str(), frame);
+  return path.data();
+}
+
+bool Headless::Run(int frames) {
+  using Clock = std::chrono::steady_clock;
+  using Ms = std::chrono::duration<float, std::milli>;
+  frames_ = frames;
+  render_ms_ = 0.0f;
+  write_ms_ = 0.0f;
+  float render_total = 0.0f;
+  float write_total = 0.0f;
+  if (!stream_path_.empty() &&
+      !stream_.Open(stream_path_, frame_buffer_.width(),
+                    frame_buffer_.height(),
+                    streams::FormatFromPath(stream_path_))) {
+    std::fprintf(stderr, "failed to open %s\n", stream_path_.c_str());
+    return false;
+  }
+  for (frame_ = 0; frame_ < frames_; frame_++) {
+    auto const start = Clock::now();
+    if (main_loop_) {
+      main_loop_(this);
+    }
+    auto const rendered = Clock::now();
+    render_total += Ms(rendered - start).count();
+    if (!output_.empty()) {
+      auto const path = OutputPath(frame_);
+      if (!SaveImage(path, &frame_buffer_)) {
+        std::fprintf(stderr, "failed to save %s\n", path.c_str());
+        return false;
+      }
+    }
+    if (stream_.is_open() && !stream_.Write(&frame_buffer_)) {
+      std::fprintf(stderr, "failed to write %s\n", stream_path_.c_str());
+      stream_.Close();
+      return false;
+    }
+    write_total += Ms(Clock::now() - rendered).count();
+    render_ms_ = render_total / (frame_ + 1);
+    write_ms_ = write_total / (frame_ + 1);
+  }
+  if (stream_.is_open() && !stream_.Close()) {
+    std::fprintf(stderr, "failed to write %s\n", stream_path_.c_str());
+    return false;
+  }
+  return true;
+}
+
+namespace paths {
+
+void Orbit(float t, Vector3 const &target, float radius, float height,
+           Camera *camera) {
+  auto const angle = 2.0f * kPI * t;
+  Vector3 const pos{target.x() + radius * std::sin(angle), target.y() + height,
+                    target.z() + radius * std::cos(angle)};
+  camera->SetLookAt(pos, target);
+}
+
+void Spin(float t, Object *obj) {
+  auto &transform = obj->transform();
+  auto rotation = transform.rotation();
+  rotation.set_y(2.0f * kPI * t);
+  transform.set_rotation(rotation);
+}
+
+}  // namespace paths
+
+}  // namespace sren
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "frame_buffer.h"
+#include "frame_stream.h"
+#include "vector.h"
+
+namespace sren {
+
+class Camera;
+class Object;
+
+// 不依赖窗口和 OpenGL 的离屏渲染驱动，逐帧运行主循环并将结果保存为图片序列
+// 或连续写入一个视频流，用于批量渲染、录制和在没有显示设备的机器上计时
+class Headless {
+ public:
+  using LoopFunc = std::function<void(Headless *)>;
+
+  Headless(int width, int height);
+
+  // 渲染 frames 帧，任一帧保存或写出失败时停止并返回 false
+  bool Run(int frames);
+
+  // 主循环更新场景并绘制到 frame_buffer 中
+  void set_main_loop(LoopFunc func) { main_loop_ = std::move(func); }
+  // 输出路径的 printf 格式，参数为帧号，如 "out/frame_%04d.png"。
+  // 扩展名决定图片格式，为空时不保存
+  void set_output(std::string pattern) { output_ = std::move(pattern); }
+  // 所有帧依次写入的流文件，.rgba 扩展名为原始 RGBA，其他为 Y4M，
+  // "-" 为以 Y4M 格式写到标准输出。可与 set_output 同时使用，为空时不写
+  void set_stream(std::string path) { stream_path_ = std::move(path); }
+  // 流的缓冲个数和 mmap 等设置在 Run 之前修改
+  FrameStream &stream() { return stream_; }
+  FrameBuffer &frame_buffer() { return frame_buffer_; }
+
+  // 当前帧号和总帧数
+  int frame() const { return frame_; }
+  int frames() const { return frames_; }
+  // 当前帧在整个序列中的进度，范围为 [0, 1)
+  float progress() const { return frames_ > 0 ? float(frame_) / frames_ : 0.0f; }
+
+  // 每帧主循环和保存图片的平均耗时（毫秒），写入流时保存的耗时只包括
+  // 拷贝到流的缓冲中和等待空闲缓冲的时间
+  float render_ms() const { return render_ms_; }
+  float write_ms() const { return write_ms_; }
+
+ private:
+  // 按输出格式生成第 frame 帧的路径
+  std::string OutputPath(int frame) const;
+
+  FrameBuffer frame_buffer_;
+  LoopFunc main_loop_{};
+  std::string output_{};
+  std::string stream_path_{};
+  FrameStream stream_{};
+  int frame_{};
+  int frames_{};
+  float render_ms_{};
+  float write_ms_{};
+};
+
+// 离屏渲染常用的脚本化运动路径，t 为 [0, 1) 内的进度，一个周期转一圈
+namespace paths {
+
+// 相机在 target 上方 height 处绕 y 轴转一圈，始终看向 target
+void Orbit(float t, Vector3 const &target, float radius, float height,
+           Camera *camera);
+// 物体绕自身 y 轴转一圈，保留 x 和 z 方向的旋转
+void Spin(float t, Object *obj);
+
+}  // namespace paths
+
+}  // namespace sren
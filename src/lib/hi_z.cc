@@ -0,0 +1,118 @@
+#include "hi_z.h"
+
+#include <algorithm>
+
+namespace sren {
+
+HiZ::HiZ(HiZ const &rhs)
+    : format_(rhs.format_),
+      width_(rhs.width_),
+      height_(rhs.height_),
+      tiles_x_(rhs.tiles_x_),
+      tiles_y_(rhs.tiles_y_),
+      min_(rhs.min_),
+      dirty_(rhs.dirty_) {
+  AddStats(rhs.stats());
+}
+
+HiZ &HiZ::operator=(HiZ const &rhs) {
+  format_ = rhs.format_;
+  width_ = rhs.width_;
+  height_ = rhs.height_;
+  tiles_x_ = rhs.tiles_x_;
+  tiles_y_ = rhs.tiles_y_;
+  min_ = rhs.min_;
+  dirty_ = rhs.dirty_;
+  ResetStats();
+  AddStats(rhs.stats());
+  return *this;
+}
+
+void HiZ::Resize(int width, int height, float z, DepthFormat format) {
+  format_ = format;
+  width_ = width;
+  height_ = height;
+  tiles_x_ = (width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height + kTileSize - 1) / kTileSize;
+  min_.resize(tiles_x_ * tiles_y_);
+  dirty_.resize(tiles_x_ * tiles_y_);
+  Clear(z);
+}
+
+void HiZ::Clear(float z) {
+  std::fill(min_.begin(), min_.end(), depths::ToKey(format_, z));
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  ResetStats();
+}
+
+void HiZ::MarkDirty(int y, int x0, int x1) {
+  auto const row = &dirty_[(y / kTileSize) * tiles_x_];
+  for (int tx = x0 / kTileSize; tx <= x1 / kTileSize; tx++) {
+    row[tx] = 1;
+  }
+}
+
+std::uint32_t HiZ::TileMin(int tx, int ty, void const *z_buffer) {
+  int const i = tx + ty * tiles_x_;
+  if (dirty_[i]) {
+    int const x0 = tx * kTileSize;
+    int const y0 = ty * kTileSize;
+    int const x1 = std::min(x0 + kTileSize, width_);
+    int const y1 = std::min(y0 + kTileSize, height_);
+    min_[i] = depths::Dispatch(format_, [&](auto traits) {
+      using Traits = decltype(traits);
+      auto const depth = static_cast<typename Traits::Type const *>(z_buffer);
+      auto m = depth[x0 + y0 * width_];
+      for (int y = y0; y < y1; y++) {
+        auto const row = depth + y * width_;
+        for (int x = x0; x < x1; x++) {
+          m = std::min(m, row[x]);
+        }
+      }
+      return Traits::Key(m);
+    });
+    dirty_[i] = 0;
+  }
+  return min_[i];
+}
+
+bool HiZ::Occluded(Rect const &rect, float z, void const *z_buffer) {
+  auto const r = rect.Intersect({0, 0, width_, height_});
+  if (r.empty()) {
+    return true;
+  }
+  auto const key = depths::ToKey(format_, z);
+  for (int ty = r.y0 / kTileSize; ty <= (r.y1 - 1) / kTileSize; ty++) {
+    for (int tx = r.x0 / kTileSize; tx <= (r.x1 - 1) / kTileSize; tx++) {
+      if (TileMin(tx, ty, z_buffer) < key) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void HiZ::AddStats(HiZStats const &stats) {
+  triangles_.fetch_add(stats.triangles, std::memory_order_relaxed);
+  blocks_.fetch_add(stats.blocks, std::memory_order_relaxed);
+  spans_.fetch_add(stats.spans, std::memory_order_relaxed);
+  fragments_.fetch_add(stats.fragments, std::memory_order_relaxed);
+}
+
+HiZStats HiZ::stats() const {
+  HiZStats ret{};
+  ret.triangles = triangles_.load(std::memory_order_relaxed);
+  ret.blocks = blocks_.load(std::memory_order_relaxed);
+  ret.spans = spans_.load(std::memory_order_relaxed);
+  ret.fragments = fragments_.load(std::memory_order_relaxed);
+  return ret;
+}
+
+void HiZ::ResetStats() {
+  triangles_.store(0, std::memory_order_relaxed);
+  blocks_.store(0, std::memory_order_relaxed);
+  spans_.store(0, std::memory_order_relaxed);
+  fragments_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace sren
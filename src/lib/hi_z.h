@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "depth.h"
+#include "rect.h"
+
+namespace sren {
+
+// 分层深度缓冲跳过的工作量
+struct HiZStats {
+  std::uint64_t triangles{};  // 整个被遮挡的三角形
+  std::uint64_t blocks{};     // 被遮挡的光栅化块
+  std::uint64_t spans{};      // 被遮挡的扫描线段
+  std::uint64_t fragments{};  // 以上区域中未着色的像素数
+};
+
+// 分层深度缓冲，为每个小块保存块内深度的下界。
+// 深度越大越近，写入只会让深度变大，所以旧的下界始终是保守的，
+// 写入时只标记块已变化，查询时再重新计算。
+// 下界按深度格式编码后的 Key 保存，与深度测试在同一精度下比较。
+class HiZ {
+ public:
+  static constexpr int kTileSize = 8;
+
+  HiZ() = default;
+  HiZ(HiZ const &rhs);
+  HiZ &operator=(HiZ const &rhs);
+
+  // 按屏幕大小重新划分块，并将所有下界设为 z，深度缓冲为 format 格式
+  void Resize(int width, int height, float z,
+              DepthFormat format = DepthFormat::kFloat32);
+  void Clear(float z);
+  // 标记 y 行 [x0, x1] 所在块的深度已变化
+  void MarkDirty(int y, int x0, int x1);
+  // rect 内所有像素的深度都不小于 z 时，深度为 z 的片元不可能通过测试，
+  // z_buffer 为按行紧密排列的深度缓冲
+  bool Occluded(Rect const &rect, float z, void const *z_buffer);
+
+  // 自上次清空以来跳过的工作量，可在多个线程中同时累加
+  void AddStats(HiZStats const &stats);
+  HiZStats stats() const;
+  void ResetStats();
+
+ private:
+  std::uint32_t TileMin(int tx, int ty, void const *z_buffer);
+
+  DepthFormat format_{DepthFormat::kFloat32};
+  int width_{};
+  int height_{};
+  int tiles_x_{};
+  int tiles_y_{};
+  std::vector<std::uint32_t> min_{};
+  std::vector<std::uint8_t> dirty_{};
+  std::atomic<std::uint64_t> triangles_{};
+  std::atomic<std::uint64_t> blocks_{};
+  std::atomic<std::uint64_t> spans_{};
+  std::atomic<std::uint64_t> fragments_{};
+};
+
+}  // namespace sren
@@ -1,11 +1,16 @@
 #define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "image.h"
 
 #include <cassert>
+#include <cstdio>
+#include <vector>
 
 #include "color.h"
 #include "data2d.h"
+#include "frame_buffer.h"
 #include "stb_image.h"
+#include "stb_image_write.h"
 
 namespace sren {
 
@@ -23,4 +28,48 @@ bool LoadImage(std::string const &path, Data2D *data2d) {
   return true;
 }
 
+namespace {
+
+bool EndsWith(std::string const &s, std::string const &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool SavePpm(std::string const &path, FrameBuffer const &fb) {
+  auto const file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  // 磁盘已满等原因写入不完整时返回 false，此时仍然关闭文件
+  bool ok =
+      std::fprintf(file, "P6\n%d %d\n255\n", fb.width(), fb.height()) > 0;
+  std::vector<std::uint8_t> line(fb.width() * 3);
+  for (int y = fb.height() - 1; ok && y >= 0; y--) {
+    auto const row = reinterpret_cast<std::uint8_t const *>(fb.color_row(y));
+    for (int x = 0; x < fb.width(); x++) {
+      line[x * 3] = row[x * 4];
+      line[x * 3 + 1] = row[x * 4 + 1];
+      line[x * 3 + 2] = row[x * 4 + 2];
+    }
+    ok = std::fwrite(line.data(), 1, line.size(), file) == line.size();
+  }
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace
+
+bool SaveImage(std::string const &path, FrameBuffer *fb) {
+  fb->Resolve();
+  if (EndsWith(path, ".ppm")) {
+    return SavePpm(path, *fb);
+  }
+  if (!EndsWith(path, ".png")) {
+    return false;
+  }
+  // 行在内存中从下到上排列时由 stb 翻转写出，两种顺序都不需要额外拷贝
+  stbi_flip_vertically_on_write(fb->y_origin() == YOrigin::kBottom);
+  return stbi_write_png(path.c_str(), fb->width(), fb->height(), 4, fb->data(),
+                        fb->stride() * 4) != 0;
+}
+
 }  // namespace sren
@@ -6,6 +6,12 @@
 
 namespace sren {
 
+class FrameBuffer;
+
 bool LoadImage(std::string const &path, Data2D *data);
 
+// 按扩展名将帧缓冲保存为 .png 或 .ppm 图片，第一行为图像顶部。
+// 保存前会先补齐延迟清除的块，PPM 只保存 RGB 三个通道
+bool SaveImage(std::string const &path, FrameBuffer *fb);
+
 }  // namespace sren
@@ -4,10 +4,24 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace sren {
 
+namespace {
+
+struct FaceDataIndexHash {
+  std::size_t operator()(FaceDataIndex const &i) const {
+    auto h = std::size_t(i.vertex) * 73856093u;
+    h ^= std::size_t(i.uv) * 19349663u;
+    h ^= std::size_t(i.normal) * 83492791u;
+    return h;
+  }
+};
+
+}  // namespace
+
 int Model::nverts() const { return vertexs_.size(); }
 int Model::nfaces() const { return face_indexs_.size() / 3; }
 
@@ -35,6 +49,21 @@ std::array<int, 3> Model::normal_indexs(int iface) const {
   };
 }
 
+void Model::UniqueFaceIndexs(std::vector<FaceDataIndex> *unique,
+                             std::vector<int> *corners) const {
+  std::unordered_map<FaceDataIndex, int, FaceDataIndexHash> found{};
+  found.reserve(face_indexs_.size());
+  unique->clear();
+  corners->resize(face_indexs_.size());
+  for (std::size_t i = 0; i < face_indexs_.size(); i++) {
+    auto const r = found.emplace(face_indexs_[i], int(unique->size()));
+    if (r.second) {
+      unique->push_back(face_indexs_[i]);
+    }
+    (*corners)[i] = r.first->second;
+  }
+}
+
 FaceDataIndex const &Model::face_index(int iface, int nthvert) const {
   return face_indexs_.at(iface * 3 + nthvert);
 }
@@ -16,6 +16,11 @@ struct FaceDataIndex {
   FaceDataIndex() = default;
   FaceDataIndex(int v, int u, int n) : vertex(v), uv(u), normal(n) {}
 
+  friend bool operator==(FaceDataIndex const &lhs, FaceDataIndex const &rhs) {
+    return lhs.vertex == rhs.vertex && lhs.uv == rhs.uv &&
+           lhs.normal == rhs.normal;
+  }
+
   int vertex{};
   int uv{};
   int normal{};
@@ -36,6 +41,10 @@ class Model {
   std::array<int, 3> vertex_indexs(int iface) const;
   std::array<int, 3> uv_indexs(int iface) const;
   std::array<int, 3> normal_indexs(int iface) const;
+  // 合并 face_indexs 中相同的下标组合。unique 为不重复的组合，按第一次出现的
+  // 顺序排列，corners[i] 为 face_indexs()[i] 在 unique 中的下标
+  void UniqueFaceIndexs(std::vector<FaceDataIndex> *unique,
+                        std::vector<int> *corners) const;
 
   std::vector<Vector3> &vertexs() { return vertexs_; }
   std::vector<Vector3> const &vertexs() const { return vertexs_; }
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <string>
 #include <vector>
 
+#include "clip.h"
 #include "color.h"
 #include "material.h"
 #include "model.h"
@@ -12,6 +14,7 @@
 #include "render_style.h"
 #include "transform.h"
 #include "vector.h"
+#include "vertex_stream.h"
 
 namespace sren {
 
@@ -20,6 +23,21 @@ enum class ObjectState {
   kDisable = 1,
 };
 
+// 顶点阶段的结果是按哪些版本计算的，版本为 0 表示还没有计算过
+struct VertexVersions {
+  // 世界空间中的顶点和法线对应的物体变换
+  std::uint64_t world{};
+  // 裁剪空间和屏幕空间中的顶点、多边形的状态以及裁剪生成的多边形
+  // 对应的物体变换、相机和视口
+  std::uint64_t transform{};
+  std::uint64_t camera{};
+  ViewportTransform viewport{};
+  // 整个物体是否在视锥内
+  bool visible{};
+  // 这个物体计算时的裁剪和剔除统计，沿用结果时计入当前帧
+  ClipStats stats{};
+};
+
 class Object {
  public:
   Object() = default;
@@ -33,35 +51,86 @@ class Object {
   std::string const &name() const { return name_; }
   bool is_alpha() const { return is_alpha_; }
 
-  void ResetWorldVertexs() {
-    vectors::CopyFrom3To4(model_.vertexs(), &world_vertexs_);
+  // 模型空间中的顶点和法线，w 为 1，在 set_model 时复制一次
+  VertexStream const &model_vertexs() const { return model_vertexs_; }
+  VertexStream const &model_normals() const { return model_normals_; }
+
+  // 顶点和法线按分量分开存放，便于 SIMD 批量变换
+  VertexStream &world_vertexs() { return world_vertexs_; }
+  VertexStream const &world_vertexs() const { return world_vertexs_; }
+  VertexStream &trans_vertexs() { return trans_vertexs_; }
+  VertexStream const &trans_vertexs() const { return trans_vertexs_; }
+  VertexStream &trans_normals() { return trans_normals_; }
+  VertexStream const &trans_normals() const { return trans_normals_; }
+  std::vector<Polygon> &polygons() { return polygons_; };
+  std::vector<Polygon> const &polygons() const { return polygons_; };
+
+  // 模型中不重复的顶点、纹理坐标、法线下标组合，在 set_model 时生成
+  std::vector<FaceDataIndex> const &unique_indexs() const {
+    return unique_indexs_;
   }
-  void ResetTransVertexs() {
-    vectors::CopyFrom3To4(model_.vertexs(), &trans_vertexs_);
+  // 每个面三个顶点在模型顶点中的下标，按面依次存放，在 set_model 时生成
+  std::vector<int> const &vertex_indexs() const { return vertex_indexs_; }
+  // 各个面在屏幕上的有向面积，用于批量背面剔除
+  std::vector<float> &face_areas() { return face_areas_; }
+  // 剔除和裁剪后完整保留的面在 polygons 中的下标，按顺序排列，
+  // 光栅化只处理这些面和裁剪生成的面
+  std::vector<int> &visible_polygons() { return visible_polygons_; }
+  std::vector<int> const &visible_polygons() const {
+    return visible_polygons_;
   }
-  void ResetTransNormals() {
-    vectors::CopyFrom3To4(model_.normals(), &trans_normals_);
+  // 按 unique_indexs 组装好的变换后的顶点，每帧变换后重新组装，
+  // 多个面共用的顶点只组装一次，多边形按下标读取
+  std::vector<Vertex> &assembled_vertexs() { return assembled_vertexs_; }
+  std::vector<Vertex> const &assembled_vertexs() const {
+    return assembled_vertexs_;
   }
 
-  std::vector<Vector4> &world_vertexs() { return world_vertexs_; }
-  std::vector<Vector4> const &world_vertexs() const { return world_vertexs_; }
-  std::vector<Vector4> &trans_vertexs() { return trans_vertexs_; }
-  std::vector<Vector4> const &trans_vertexs() const { return trans_vertexs_; }
-  std::vector<Vector4> &trans_normals() { return trans_normals_; }
-  std::vector<Vector4> const &trans_normals() const { return trans_normals_; }
-  std::vector<Polygon> &polygons() { return polygons_; };
-  std::vector<Polygon> const &polygons() const { return polygons_; };
+  // 裁剪空间中的顶点及其裁剪标记
+  VertexStream &clip_vertexs() { return clip_vertexs_; }
+  VertexStream const &clip_vertexs() const { return clip_vertexs_; }
+  std::vector<unsigned> &clip_codes() { return clip_codes_; }
+  std::vector<unsigned> const &clip_codes() const { return clip_codes_; }
+  // 裁剪后生成的多边形及其顶点，每帧重新生成
+  std::vector<Polygon> &clipped_polygons() { return clipped_polygons_; }
+  std::vector<Polygon> const &clipped_polygons() const {
+    return clipped_polygons_;
+  }
+  std::vector<std::array<Vertex, 3>> &clipped_vertexs() {
+    return clipped_vertexs_;
+  }
+  std::vector<std::array<Vertex, 3>> const &clipped_vertexs() const {
+    return clipped_vertexs_;
+  }
+
+  // 顶点阶段的结果对应的版本，与当前的版本相同时不需要重新计算
+  VertexVersions &vertex_versions() { return vertex_versions_; }
+  VertexVersions const &vertex_versions() const { return vertex_versions_; }
+
+  // 模型空间中的包围盒
+  Vector3 const &bounds_min() const { return bounds_min_; }
+  Vector3 const &bounds_max() const { return bounds_max_; }
 
   void set_model(Model model) {
     model_ = std::move(model);
+    std::vector<int> corners{};
+    model_.UniqueFaceIndexs(&unique_indexs_, &corners);
+    assembled_vertexs_.clear();
+    visible_polygons_.clear();
     polygons_.clear();
+    vertex_indexs_.clear();
     for (int i = 0; i < model_.nfaces(); i++) {
-      polygons_.emplace_back(this, std::array<FaceDataIndex, 3>{
-                                       model_.face_index(i, 0),
-                                       model_.face_index(i, 1),
-                                       model_.face_index(i, 2),
-                                   });
+      polygons_.emplace_back(this, std::array<int, 3>{corners[i * 3],
+                                                      corners[i * 3 + 1],
+                                                      corners[i * 3 + 2]});
     }
+    for (auto const &index : model_.face_indexs()) {
+      vertex_indexs_.push_back(index.vertex);
+    }
+    model_vertexs_.Assign(model_.vertexs(), 1.0f);
+    model_normals_.Assign(model_.normals(), 1.0f);
+    vertex_versions_ = {};
+    UpdateBounds();
   }
 
   Model const &model() const { return model_; }
@@ -76,6 +145,18 @@ class Object {
   unsigned int render_style() const { return render_style_; }
 
  private:
+  void UpdateBounds() {
+    auto const &vs = model_.vertexs();
+    bounds_min_ = vs.empty() ? Vector3{} : vs[0];
+    bounds_max_ = bounds_min_;
+    for (auto const &v : vs) {
+      for (int i = 0; i < 3; i++) {
+        bounds_min_[i] = std::min(bounds_min_[i], v[i]);
+        bounds_max_[i] = std::max(bounds_max_[i], v[i]);
+      }
+    }
+  }
+
   int id_{};
   std::string name_{};
   bool is_alpha_{};
@@ -87,14 +168,40 @@ class Object {
   Material material_{};
   // 物体的模型信息
   Model model_{};
+  // 按分量分开存放的模型顶点和法线
+  VertexStream model_vertexs_{};
+  VertexStream model_normals_{};
   // 世界坐标下物体的位置
-  std::vector<Vector4> world_vertexs_{};
+  VertexStream world_vertexs_{};
   // 变换后物体的顶点
-  std::vector<Vector4> trans_vertexs_{};
+  VertexStream trans_vertexs_{};
   // 变换后物体顶点的法线
-  std::vector<Vector4> trans_normals_{};
+  VertexStream trans_normals_{};
   // 物体的面
   std::vector<Polygon> polygons_{};
+  // 不重复的下标组合
+  std::vector<FaceDataIndex> unique_indexs_{};
+  // 组装好的变换后的顶点
+  std::vector<Vertex> assembled_vertexs_{};
+  // 索引缓冲
+  std::vector<int> vertex_indexs_{};
+  // 各个面的有向面积
+  std::vector<float> face_areas_{};
+  // 完整保留的面
+  std::vector<int> visible_polygons_{};
+  // 裁剪空间中的顶点
+  VertexStream clip_vertexs_{};
+  // 顶点的裁剪标记
+  std::vector<unsigned> clip_codes_{};
+  // 裁剪后生成的面
+  std::vector<Polygon> clipped_polygons_{};
+  // 裁剪后生成的面的顶点
+  std::vector<std::array<Vertex, 3>> clipped_vertexs_{};
+  // 以上变换结果对应的版本
+  VertexVersions vertex_versions_{};
+  // 模型空间中的包围盒
+  Vector3 bounds_min_{};
+  Vector3 bounds_max_{};
   // 渲染风格
   unsigned int render_style_{kRenderTexture};
 };
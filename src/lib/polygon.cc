@@ -6,14 +6,18 @@
 
 namespace sren {
 
-Vertex Polygon::vertex(int i) const {
-  return {
-      object_->trans_vertexs()[face_indexs_[i].vertex],
-      object_->world_vertexs()[face_indexs_[i].vertex],
-      object_->model().colors()[face_indexs_[i].vertex],
-      object_->model().uvs()[face_indexs_[i].uv],
-      object_->trans_normals()[face_indexs_[i].normal],
-  };
+Vertex const &Polygon::vertex(int i) const {
+  if (clipped_ >= 0) {
+    return object_->clipped_vertexs()[clipped_][i];
+  }
+  return object_->assembled_vertexs()[indexs_[i]];
+}
+
+Vertex Polygon::clip_vertex(int i) const {
+  auto v = object_->assembled_vertexs()[indexs_[i]];
+  v.pos() =
+      object_->clip_vertexs()[object_->unique_indexs()[indexs_[i]].vertex];
+  return v;
 }
 
 Material const &Polygon::material() const { return object_->material(); }
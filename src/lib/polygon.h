@@ -20,12 +20,24 @@ enum class PolygonState {
 class Polygon {
  public:
   Polygon() = default;
-  Polygon(Object *object, std::array<FaceDataIndex, 3> face_indexs)
-      : object_(object), face_indexs_(face_indexs) {}
+  // 模型中的面，顶点为 object->assembled_vertexs() 中的第 indexs[i] 个
+  Polygon(Object *object, std::array<int, 3> indexs)
+      : object_(object), indexs_(indexs) {}
+  // 裁剪后生成的多边形，顶点为 object->clipped_vertexs()[clipped]
+  Polygon(Object *object, int clipped)
+      : object_(object), clipped_(clipped) {}
 
   PolygonState state() const { return state_; };
   void set_state(PolygonState state) { state_ = state; };
-  Vertex vertex(int i) const;
+  // 变换后组装好的第 i 个顶点
+  Vertex const &vertex(int i) const;
+  // 变换后第 i 个顶点的位置
+  Vector4 const &pos(int i) const { return vertex(i).pos(); }
+  // 裁剪空间中的第 i 个顶点
+  Vertex clip_vertex(int i) const;
+  // 第 i 个顶点在 object->assembled_vertexs() 中的下标
+  int index(int i) const { return indexs_[i]; }
+  Object const *object() const { return object_; }
   Material const &material() const;
   unsigned int render_style() const;
   bool is_alpha() const;
@@ -39,7 +51,8 @@ class Polygon {
   }
 
   Object *object_{};
-  std::array<FaceDataIndex, 3> face_indexs_{};
+  std::array<int, 3> indexs_{};
+  int clipped_{-1};
   PolygonState state_{};
 };
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+
+namespace sren {
+
+// 屏幕上的矩形区域，范围为 [x0, x1) x [y0, y1)
+struct Rect {
+  Rect() = default;
+  Rect(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+  int width() const { return x1 - x0; }
+  int height() const { return y1 - y0; }
+  bool empty() const { return x0 >= x1 || y0 >= y1; }
+
+  bool Contains(int x, int y) const {
+    return x >= x0 && x < x1 && y >= y0 && y < y1;
+  }
+
+  // 求两个矩形的交集
+  Rect Intersect(Rect const &rhs) const {
+    return {std::max(x0, rhs.x0), std::max(y0, rhs.y0), std::min(x1, rhs.x1),
+            std::min(y1, rhs.y1)};
+  }
+
+  // 包含两个矩形的最小矩形，空矩形不影响结果
+  Rect Union(Rect const &rhs) const {
+    if (empty()) {
+      return rhs;
+    }
+    if (rhs.empty()) {
+      return *this;
+    }
+    return {std::min(x0, rhs.x0), std::min(y0, rhs.y0), std::max(x1, rhs.x1),
+            std::max(y1, rhs.y1)};
+  }
+
+  friend bool operator==(Rect const &lhs, Rect const &rhs) {
+    return lhs.x0 == rhs.x0 && lhs.y0 == rhs.y0 && lhs.x1 == rhs.x1 &&
+           lhs.y1 == rhs.y1;
+  }
+
+  friend bool operator!=(Rect const &lhs, Rect const &rhs) {
+    return !(lhs == rhs);
+  }
+
+  int x0{};
+  int y0{};
+  int x1{};
+  int y1{};
+};
+
+}  // namespace sren
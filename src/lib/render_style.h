@@ -8,4 +8,30 @@ enum RenderStyle {
   kRenderTexture = 0x4,
 };
 
+namespace render_styles {
+
+// 不透明物体是否用纹理着色。同时使用纹理和颜色时先写纹理着色再写颜色着色，
+// 颜色着色总会覆盖纹理着色，因此只需颜色着色
+inline bool OpaqueTexture(unsigned style) {
+  return (style & kRenderTexture) && !(style & kRenderColor);
+}
+
+}  // namespace render_styles
+
+// 三角形的光栅化方式
+enum class Rasterizer {
+  // 将三角形切分为梯形，逐扫描线插值
+  kTrapezoid,
+  // 用 28.4 定点数边函数分块遍历包围盒，按左上规则填充，属性按平面方程递增
+  kHalfSpace,
+};
+
+// 不透明物体的着色方式
+enum class Shading {
+  // 光栅化时立即对通过深度测试的像素着色
+  kForward,
+  // 光栅化时只将几何属性写入 G-buffer，之后对每个可见像素只着色一次
+  kDeferred,
+};
+
 }  // namespace sren
@@ -1,6 +1,10 @@
 #include "scene.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "camera.h"
+#include "clip.h"
 #include "draw.h"
 #include "matrix.h"
 #include "polygon.h"
@@ -9,73 +13,516 @@ namespace sren {
 
 namespace {
 
-auto const kNdcCameraVector = Vector3(0, 0, 1);
+// 屏幕上的有向面积小于 0，即法线朝向相机的面可见。
+// 运算顺序与 simd::SignedAreas 相同，裁剪生成的面与批量剔除的结果一致
+bool FrontFacing(Vector4 const &p0, Vector4 const &p1, Vector4 const &p2) {
+  float const x1 = p1.x() - p0.x();
+  float const y1 = p1.y() - p0.y();
+  float const x2 = p2.x() - p0.x();
+  float const y2 = p2.y() - p0.y();
+  return x1 * y2 - y1 * x2 < 0;
+}
 
-void BackFaceCuting(Polygon *poly) {
-  if (poly->normal() * kNdcCameraVector < 0) {
-    poly->set_state(PolygonState::kActive);
-  } else {
-    poly->set_state(PolygonState::kBackface);
+// 透视除法后将规范化设备坐标映射到视口，z 换算为深度 near / w：
+// 近平面处为 1，越远越接近 0，在屏幕空间中线性变化，可以直接插值，
+// 也可以按定点数格式保存。投影矩阵使透视除法后 z' = b + a / w，
+// 因此 near / w = (z' - b) / a * near
+ViewportTransform MakeViewportTransform(Rect const &viewport,
+                                        Camera const &camera) {
+  auto const &proj = camera.projection_matrix();
+  auto const a = proj[3][2];
+  auto const b = proj[2][2];
+  float const half_w = viewport.width() * 0.5f;
+  float const half_h = viewport.height() * 0.5f;
+  ViewportTransform t{};
+  t.scale = {half_w, half_h, camera.near_clip() / a};
+  t.offset = {half_w + viewport.x0, half_h + viewport.y0,
+              -b / a * camera.near_clip()};
+  return t;
+}
+
+// 矩阵的每个元素是否完全相同。增量渲染时微小的移动也需要重绘，不能近似比较
+bool SameMatrix(Matrix4x4 const &lhs, Matrix4x4 const &rhs) {
+  return std::memcmp(lhs.data(), rhs.data(), sizeof(float) * 16) == 0;
+}
+
+// 延迟着色时每个任务处理的行数
+constexpr int kDeferredRows = 16;
+
+// 对 G-buffer 中一行 [x0, x1) 范围内的像素着色。只写入几何阶段写过深度的像素，
+// 这些像素所在的块已经清除，多个线程同时着色时不会再触发清除
+void ShadeGBufferRow(GBuffer const &gbuffer, int y, int x0, int x1,
+                     Lights const &lights, Vector3 const &camera_pos,
+                     FrameBuffer *fb) {
+  auto const samples = gbuffer.row(y);
+  auto const color = fb->color_row(y);
+  for (int x = x0; x < x1; x++) {
+    auto const &s = samples[x];
+    if (s.material == 0) {
+      continue;
+    }
+    auto const obj = gbuffer.material(s.material);
+    Vertex vert{};
+    vert.normal() = {s.normal[0], s.normal[1], s.normal[2], 0.0f};
+    vert.world_pos() = {s.world_pos[0], s.world_pos[1], s.world_pos[2], 1.0f};
+    Color c{};
+    // 与几何阶段选择着色器的规则相同，见 draw::SelectFill
+    if (render_styles::OpaqueTexture(obj->render_style())) {
+      vert.uv() = {s.attr[0], s.attr[1]};
+      c = lights.Illuminate(vert, obj->material(), camera_pos);
+    } else {
+      vert.color() = {s.attr[0], s.attr[1], s.attr[2], s.attr[3]};
+      c = lights.Illuminate(vert, vert.color(), camera_pos);
+    }
+    c.SetFix();
+    color[x] = FrameBuffer::PackColor(c);
   }
 }
 
-void ApplyToAll(Matrix4x4 const &m, std::vector<Vector4> *vertexs) {
-  auto &vs = *vertexs;
-  for (int i = 0; i < vs.size(); i++) {
-    vs[i] = vs[i] * m;
+}  // namespace
+
+bool Scene::ObjectSnapshot::Same(ObjectSnapshot const &rhs) const {
+  return SameMatrix(model, rhs.model) && state == rhs.state &&
+         render_style == rhs.render_style && polygons == rhs.polygons &&
+         npolygons == rhs.npolygons;
+}
+
+bool Scene::SceneSnapshot::Same(SceneSnapshot const &rhs) const {
+  return SameMatrix(camera, rhs.camera) &&
+         camera_pos.x() == rhs.camera_pos.x() &&
+         camera_pos.y() == rhs.camera_pos.y() &&
+         camera_pos.z() == rhs.camera_pos.z() && foreground == rhs.foreground &&
+         background == rhs.background && rasterizer == rhs.rasterizer &&
+         shading == rhs.shading && viewport == rhs.viewport &&
+         nobjects == rhs.nobjects && nalpha_objects == rhs.nalpha_objects;
+}
+
+ThreadPool *Scene::pool() {
+  if (!pool_) {
+    pool_ = std::make_unique<ThreadPool>(nthreads_);
   }
+  return pool_.get();
 }
 
-void Homogenize(FrameBuffer const &fb, Vector4 *v) {
-  float const rhw = 1.0f / v->w();
-  v->set_x((v->x() * rhw + 1.0f) * fb.width() * 0.5f);
-  v->set_y((v->y() * rhw + 1.0f) * fb.height() * 0.5f);
-  v->set_z(v->z() * rhw);
-  v->set_w(1.0f);
+void Scene::set_nthreads(int nthreads) {
+  nthreads = std::max(1, nthreads);
+  if (nthreads != nthreads_) {
+    nthreads_ = nthreads;
+    pool_.reset();
+  }
 }
 
-void FixZ(Matrix4x4 const &proj, Vector4 *v) {
-  auto const a = proj[3][2];
-  auto const b = proj[2][2];
-  v->set_z((v->z() - b) / a);
+void Scene::ClipPolygon(Object *obj, Polygon const &poly, unsigned planes,
+                        ClipStats *stats) {
+  std::array<Vertex, 3> const in{poly.clip_vertex(0), poly.clip_vertex(1),
+                                 poly.clip_vertex(2)};
+  std::array<Vertex, clips::kMaxVertexs> out{};
+  int const n = clips::ClipTriangle(in, planes, &out);
+  stats->polygons_clipped++;
+  for (int i = 0; i < n; i++) {
+    out[i].pos() = view_transform_.Apply(out[i].pos());
+  }
+  // 裁剪结果是凸多边形，按扇形拆成三角形
+  for (int i = 1; i + 1 < n; i++) {
+    obj->clipped_vertexs().push_back({out[0], out[i], out[i + 1]});
+    obj->clipped_polygons().emplace_back(
+        obj, int(obj->clipped_vertexs().size()) - 1);
+    auto &clipped = obj->clipped_polygons().back();
+    if (!obj->is_alpha() &&
+        !FrontFacing(out[0].pos(), out[i].pos(), out[i + 1].pos())) {
+      clipped.set_state(PolygonState::kBackface);
+      stats->polygons_backface++;
+    }
+    stats->polygons_emitted++;
+  }
 }
 
-}  // namespace
+bool Scene::TransformObject(Object *obj, ClipStats *stats) {
+  auto &versions = obj->vertex_versions();
+  auto const version = obj->transform().version();
+  // 物体、相机和视口都没有改变时沿用上次的结果，静止的物体没有任何顶点处理
+  if (versions.transform == version &&
+      versions.camera == view_camera_->version() &&
+      versions.viewport == view_transform_) {
+    *stats += versions.stats;
+    stats->objects_reused++;
+    return versions.visible;
+  }
+  versions.stats = {};
+  versions.visible =
+      ProcessVertexs(obj, versions.world != version, &versions.stats);
+  versions.transform = version;
+  versions.camera = view_camera_->version();
+  versions.viewport = view_transform_;
+  if (versions.visible) {
+    versions.world = version;
+  }
+  *stats += versions.stats;
+  return versions.visible;
+}
+
+std::vector<Object *> Scene::ActiveObjects() const {
+  std::vector<Object *> objs{};
+  for (auto const *objects : {&objects_, &alpha_objects_}) {
+    for (auto &obj : *objects) {
+      if (obj->state() == ObjectState::kActive) {
+        objs.push_back(obj.get());
+      }
+    }
+  }
+  return objs;
+}
 
-void Scene::RenderOneObject(Object *obj, FrameBuffer *fb) {
+void Scene::TransformObjects(std::vector<Object *> const &objs) {
+  // 各物体的顶点处理互不影响，分给线程池并行执行，统计按物体分开记录后再累加
+  std::vector<ClipStats> stats(objs.size());
+  pool()->ParallelFor(0, int(objs.size()), [&](int i) {
+    TransformObject(objs[i], &stats[i]);
+  });
+  for (auto const &s : stats) {
+    clip_stats_ += s;
+  }
+}
+
+bool Scene::ProcessVertexs(Object *obj, bool world, ClipStats *stats) {
+  obj->clipped_polygons().clear();
+  obj->clipped_vertexs().clear();
+  auto &visible = obj->visible_polygons();
+  visible.clear();
+  auto const &transform = obj->transform();
+  auto const mvp = transform.model_matrix() * view_projection_;
+  // 整个物体在视锥外时跳过所有顶点的变换
+  if (clips::BoxOutside(obj->bounds_min(), obj->bounds_max(), mvp)) {
+    for (auto &poly : obj->polygons()) {
+      poly.set_state(PolygonState::kClipped);
+    }
+    stats->objects_culled++;
+    return false;
+  }
+  // 世界空间中的顶点和法线与相机无关，多个视图之间共享。
+  // 裁剪空间的坐标总是由模型顶点直接乘 mvp 得到，与是否共享无关
+  if (world) {
+    obj->model_normals().TransformTo(transform.rotate_matrix(),
+                                     &obj->trans_normals(), simd_isa_);
+  }
+  auto &codes = obj->clip_codes();
+  vertexs::Project(obj->model_vertexs(), transform.model_matrix(), mvp,
+                   view_transform_, world ? &obj->world_vertexs() : nullptr,
+                   &obj->clip_vertexs(), &obj->trans_vertexs(), &codes,
+                   simd_isa_);
+  // 之后剔除、裁剪和光栅化都直接读取组装好的顶点
+  auto const &indexs = obj->unique_indexs();
+  vertexs::Assemble(indexs, obj->trans_vertexs(), obj->world_vertexs(),
+                    obj->trans_normals(), obj->model(),
+                    &obj->assembled_vertexs());
+  // 按索引缓冲一次求出所有面在屏幕上的有向面积，半透明物体不做背面剔除。
+  // 需要裁剪的面的顶点可能还在裁剪空间中，它们的面积不会被使用
+  auto &polygons = obj->polygons();
+  int const npolygons = int(polygons.size());
+  auto &areas = obj->face_areas();
+  bool const cull = !obj->is_alpha();
+  if (cull) {
+    auto const &screen = obj->trans_vertexs();
+    areas.resize(npolygons);
+    simd::SignedAreas(screen.component(0), screen.component(1),
+                      obj->vertex_indexs().data(), npolygons, areas.data(),
+                      simd_isa_);
+  }
+  for (int i = 0; i < npolygons; i++) {
+    auto &poly = polygons[i];
+    auto const c0 = codes[indexs[poly.index(0)].vertex];
+    auto const c1 = codes[indexs[poly.index(1)].vertex];
+    auto const c2 = codes[indexs[poly.index(2)].vertex];
+    // 三个顶点都在同一平面外侧
+    if (c0 & c1 & c2 & clips::kFrustumCodes) {
+      poly.set_state(PolygonState::kClipped);
+      stats->polygons_culled++;
+      continue;
+    }
+    auto const planes = (c0 | c1 | c2) & clips::kMustClipCodes;
+    if (planes) {
+      poly.set_state(PolygonState::kClipped);
+      ClipPolygon(obj, poly, planes, stats);
+      continue;
+    }
+    if (cull && !(areas[i] < 0)) {
+      poly.set_state(PolygonState::kBackface);
+      stats->polygons_backface++;
+      continue;
+    }
+    poly.set_state(PolygonState::kActive);
+    visible.push_back(i);
+  }
+  return true;
+}
+
+void Scene::RenderOneObject(Object *obj, GBuffer *gbuffer, FrameBuffer *fb) {
   if (obj->state() != ObjectState::kActive) {
     return;
   }
-  obj->ResetWorldVertexs();
-  obj->ResetTransNormals();
-  obj->ResetTransVertexs();
-  auto const &transform = obj->transform();
-  ApplyToAll(transform.rotate_matrix(), &obj->trans_normals());
-  ApplyToAll(transform.model_matrix(), &obj->trans_vertexs());
-  ApplyToAll(transform.model_matrix(), &obj->world_vertexs());
-  ApplyToAll(camera_.transform_matrix(), &obj->trans_vertexs());
-  for (auto &trans_v : obj->trans_vertexs()) {
-    Homogenize(*fb, &trans_v);
-    FixZ(camera_.projection_matrix(), &trans_v);
+  auto const &clip = fb->scissor();
+  auto const fill = draw::SelectFill(*obj, *this, gbuffer != nullptr);
+  ForEachActivePolygon(obj, [&](Polygon const &poly) {
+    fill(poly, *this, clip, gbuffer, fb);
+    if (!gbuffer) {
+      draw::Wireframe(poly, *this, clip, fb);
+    }
+  });
+}
+
+void Scene::BinOneObject(Object *obj, FrameBuffer const &fb) {
+  if (obj->state() != ObjectState::kActive) {
+    return;
+  }
+  auto const &scissor = fb.scissor();
+  ForEachActivePolygon(obj, [&](Polygon const &poly) {
+    bins_.Add(&poly, tiles::PolygonBounds(poly).Intersect(scissor));
+  });
+}
+
+void Scene::RenderTiled(Objects const &objects, GBuffer *gbuffer,
+                        FrameBuffer *fb) {
+  // 每个线程只写入自己的块，帧缓冲按相同的块延迟清除，不会出现两个线程清除同一块
+  static_assert(TileBins::kTileSize == FrameBuffer::kClearTileSize,
+                "bins must match frame buffer clear tiles");
+  if (bins_.width() != fb->width() || bins_.height() != fb->height()) {
+    bins_.Resize(fb->width(), fb->height());
+  } else {
+    bins_.Clear();
+  }
+  for (auto &obj : objects) {
+    BinOneObject(obj.get(), *fb);
   }
-  for (auto &poly : obj->polygons()) {
-    if (!obj->is_alpha()) {
-      BackFaceCuting(&poly);
+  pool()->ParallelFor(0, bins_.ntiles(), [&](int i) {
+    auto const rect = bins_.tile_rect(i).Intersect(fb->scissor());
+    if (rect.empty()) {
+      return;
     }
-    if (poly.state() == PolygonState::kActive) {
-      draw::Triangle(poly, *this, fb);
+    // 同一物体的多边形在块内是连续的，物体变化时才重新选择填充函数
+    Object const *obj = nullptr;
+    draw::FillFunc fill = nullptr;
+    for (auto poly : bins_.bin(i)) {
+      if (poly->object() != obj) {
+        obj = poly->object();
+        fill = draw::SelectFill(*obj, *this, gbuffer != nullptr);
+      }
+      fill(*poly, *this, rect, gbuffer, fb);
+      if (!gbuffer) {
+        draw::Wireframe(*poly, *this, rect, fb);
+      }
     }
+  });
+}
+
+void Scene::RenderObjects(Objects const &objects, GBuffer *gbuffer,
+                          FrameBuffer *fb) {
+  if (tiled_) {
+    RenderTiled(objects, gbuffer, fb);
+    return;
+  }
+  for (auto &obj : objects) {
+    RenderOneObject(obj.get(), gbuffer, fb);
   }
 }
 
-void Scene::Render(FrameBuffer *fb) {
-  fb->Clear();
+void Scene::RenderDeferred(FrameBuffer *fb) {
+  // 几何阶段和着色都只处理裁剪矩形内的像素，只需清空这一部分。
+  // 增量渲染的每个重绘区域和多视图的每个视图不必各扫过一次整个 G-buffer
+  if (gbuffer_.width() != fb->width() || gbuffer_.height() != fb->height()) {
+    gbuffer_.Resize(fb->width(), fb->height());
+  } else {
+    gbuffer_.Clear(fb->scissor());
+  }
+  for (auto &obj : objects_) {
+    if (obj->state() == ObjectState::kActive) {
+      gbuffer_.AddMaterial(obj.get());
+    }
+  }
+  RenderObjects(objects_, &gbuffer_, fb);
+  // 按行并行着色，每个可见像素只计算一次光照
+  auto const &clip = fb->scissor();
+  int const nbands =
+      clip.empty() ? 0 : (clip.height() + kDeferredRows - 1) / kDeferredRows;
+  pool()->ParallelFor(0, nbands, [&](int band) {
+    int const y0 = clip.y0 + band * kDeferredRows;
+    int const y1 = std::min(y0 + kDeferredRows, clip.y1);
+    for (int y = y0; y < y1; y++) {
+      ShadeGBufferRow(gbuffer_, y, clip.x0, clip.x1, lights_,
+                      view_camera_->pos(), fb);
+    }
+  });
+  // 线框不参与深度测试，在着色之后画才不会被覆盖
   for (auto &obj : objects_) {
-    RenderOneObject(obj.get(), fb);
+    if (obj->state() != ObjectState::kActive ||
+        !(obj->render_style() & kRenderWireframe)) {
+      continue;
+    }
+    ForEachActivePolygon(obj.get(), [&](Polygon const &poly) {
+      draw::Wireframe(poly, *this, clip, fb);
+    });
   }
-  for (auto &obj : alpha_objects_) {
-    RenderOneObject(obj.get(), fb);
+}
+
+Rect Scene::ObjectBounds(Object *obj) {
+  Rect bounds{};
+  ForEachActivePolygon(obj, [&](Polygon const &poly) {
+    bounds = bounds.Union(tiles::PolygonBounds(poly));
+  });
+  return bounds.Intersect(view_rect_);
+}
+
+void Scene::BeginView(Camera const &camera, Rect const &viewport,
+                      FrameBuffer const &fb) {
+  view_camera_ = &camera;
+  view_rect_ = viewport.empty() ? fb.bounds() : viewport;
+  view_transform_ = MakeViewportTransform(view_rect_, camera);
+  // 变换物体时多个线程同时读取，先求出来，不使用相机中延迟计算的缓存
+  view_projection_ = camera.transform_matrix();
+}
+
+void Scene::EndView() {
+  view_camera_ = &camera_;
+  view_rect_ = {};
+  view_transform_ = {};
+}
+
+void Scene::RenderPasses(FrameBuffer *fb) {
+  // 半透明物体需要与已有颜色混合，总是在不透明物体之后立即着色。
+  // G-buffer 每个像素只有一个样本，多重采样时总是前向着色
+  if (shading_ == Shading::kDeferred && fb->samples() == 1) {
+    RenderDeferred(fb);
+  } else {
+    RenderObjects(objects_, nullptr, fb);
+  }
+  RenderObjects(alpha_objects_, nullptr, fb);
+}
+
+void Scene::RenderIncremental(FrameBuffer *fb) {
+  SceneSnapshot const snapshot{
+      camera_.transform_matrix(), camera_.pos(), foreground_, background_,
+      rasterizer_,                shading_,      view_rect_,  nobjects(),
+      nalpha_objects()};
+  bool const full = invalidated_ || !snapshot.Same(snapshot_);
+  invalidated_ = false;
+  snapshot_ = snapshot;
+  object_snapshots_.resize(objects_.size() + alpha_objects_.size());
+  damage_.BeginFrame(full);
+  // 只重新变换改变的物体，其余物体保留上一帧变换的结果。
+  // 改变的物体在旧位置和新位置覆盖的区域都需要重绘
+  std::vector<int> changed{};
+  std::vector<Object *> objs{};
+  std::vector<ObjectSnapshot> currents{};
+  std::vector<Object *> active{};
+  int i = 0;
+  for (auto const *objects : {&objects_, &alpha_objects_}) {
+    for (auto &obj : *objects) {
+      ObjectSnapshot current{obj->transform().model_matrix(),
+                             obj->state(),
+                             obj->render_style(),
+                             obj->polygons().data(),
+                             int(obj->polygons().size()),
+                             {}};
+      if (full || !current.Same(object_snapshots_[i])) {
+        changed.push_back(i);
+        objs.push_back(obj.get());
+        currents.push_back(current);
+        if (obj->state() == ObjectState::kActive) {
+          active.push_back(obj.get());
+        }
+      }
+      i++;
+    }
+  }
+  TransformObjects(active);
+  for (int k = 0; k < int(changed.size()); k++) {
+    auto &last = object_snapshots_[changed[k]];
+    auto &current = currents[k];
+    if (objs[k]->state() == ObjectState::kActive) {
+      current.bounds = ObjectBounds(objs[k]);
+    }
+    damage_.Add(last.bounds);
+    damage_.Add(current.bounds);
+    last = current;
+  }
+
+  std::vector<Rect> rects{};
+  if (!damage_.Collect(*fb, &rects)) {
+    // 整帧改变，或帧缓冲中不是之前渲染过的内容
+    fb->Clear(background_);
+    RenderPasses(fb);
+    redrawn_.assign(1, fb->bounds());
+  } else {
+    // 帧缓冲中保留着上次渲染的结果，只清除并重绘之后改变的区域
+    fb->hi_z().ResetStats();
+    redrawn_.clear();
+    auto const scissor = fb->scissor();
+    for (auto const &rect : rects) {
+      auto const r = rect.Intersect(scissor);
+      if (r.empty()) {
+        continue;
+      }
+      fb->ClearRect(r);
+      fb->set_scissor(r);
+      RenderPasses(fb);
+      redrawn_.push_back(r);
+    }
+    fb->set_scissor(scissor);
+  }
+  damage_.MarkRendered(*fb);
+  fb->set_damage(damage_.frame(), damage_.full()
+                                      ? std::vector<Rect>{fb->bounds()}
+                                      : damage_.rects());
+}
+
+void Scene::Render(FrameBuffer *fb) {
+  clip_stats_ = {};
+  BeginView(camera_, viewport_, *fb);
+  // 视口之外的像素不写入
+  auto const scissor = fb->scissor();
+  if (!viewport_.empty()) {
+    fb->set_scissor(scissor.Intersect(viewport_));
+  }
+  if (incremental_) {
+    RenderIncremental(fb);
+  } else {
+    // 之后切换到增量渲染时不能沿用这一帧的状态
+    invalidated_ = true;
+    fb->Clear(background_);
+    TransformObjects(ActiveObjects());
+    RenderPasses(fb);
+    redrawn_.assign(1, fb->bounds());
+  }
+  fb->set_scissor(scissor);
+  EndView();
+}
+
+void Scene::RenderViews(FrameBuffer *fb, std::vector<View> const &views) {
+  clip_stats_ = {};
+  invalidated_ = true;
+  fb->Clear(background_);
+  auto const scissor = fb->scissor();
+  // 每个物体变换到世界空间后，之后的视图只做相机变换
+  std::vector<Rect> drawn{};
+  for (auto const &view : views) {
+    BeginView(view.camera, view.viewport, *fb);
+    auto const clip = scissor.Intersect(view_rect_);
+    if (clip.empty()) {
+      continue;
+    }
+    // 与之前的视图重叠时先清除，后面的视图覆盖前面的视图
+    if (std::any_of(drawn.begin(), drawn.end(), [&](Rect const &r) {
+          return !r.Intersect(clip).empty();
+        })) {
+      fb->ClearRect(clip);
+    }
+    drawn.push_back(clip);
+    TransformObjects(ActiveObjects());
+    fb->set_scissor(clip);
+    RenderPasses(fb);
   }
+  fb->set_scissor(scissor);
+  EndView();
+  redrawn_.assign(1, fb->bounds());
 }
 
 }  // namespace sren
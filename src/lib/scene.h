@@ -4,13 +4,31 @@
 #include <vector>
 
 #include "camera.h"
+#include "clip.h"
 #include "color.h"
+#include "damage.h"
 #include "frame_buffer.h"
+#include "g_buffer.h"
 #include "light.h"
+#include "matrix.h"
 #include "object.h"
+#include "rect.h"
+#include "render_style.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "tiles.h"
+#include "vertex_stream.h"
 
 namespace sren {
 
+// 用一个相机渲染到帧缓冲中一个矩形区域的视图
+struct View {
+  Camera camera{};
+  // 规范化设备坐标映射到的帧缓冲区域，为空时为整个帧缓冲。
+  // 相机的宽高比应与视口一致
+  Rect viewport{};
+};
+
 class Scene {
  public:
   Scene() = default;
@@ -18,10 +36,22 @@ class Scene {
   Scene(Scene const &) = delete;
   void operator=(Scene const &) = delete;
 
+  // 清除帧缓冲后用场景的相机渲染到视口中
   void Render(FrameBuffer *fb);
+  // 清除帧缓冲后依次渲染多个视图，每个视图只写入自己的视口，
+  // 视口重叠时后面的视图覆盖前面的。忽略场景的相机和视口，不做增量渲染。
+  // 各物体在世界空间中的顶点和法线只计算一次，每个视图只做相机变换，
+  // 视图内的光栅化与单个视图相同，分块时多线程进行
+  void RenderViews(FrameBuffer *fb, std::vector<View> const &views);
 
   Camera &camera() { return camera_; }
   Camera const &camera() const { return camera_; }
+  // 正在渲染的视图的相机，光照按它的位置计算，不在渲染时为场景的相机
+  Camera const &view_camera() const { return *view_camera_; }
+  // 规范化设备坐标映射到的帧缓冲区域，为空时为整个帧缓冲。
+  // 光栅化只写入视口与帧缓冲裁剪矩形相交的部分
+  Rect const &viewport() const { return viewport_; }
+  void set_viewport(Rect const &viewport) { viewport_ = viewport; }
   Color &foreground() { return foreground_; }
   Color const &foreground() const { return foreground_; }
   Color &background() { return background_; }
@@ -48,16 +78,149 @@ class Scene {
   Lights &lights() { return lights_; }
   Lights const &lights() const { return lights_; }
 
+  // 三角形的光栅化方式，帧缓冲多重采样时总是使用半空间光栅化
+  Rasterizer rasterizer() const { return rasterizer_; }
+  void set_rasterizer(Rasterizer r) { rasterizer_ = r; }
+
+  // 不透明物体的着色方式，帧缓冲多重采样时总是前向着色
+  Shading shading() const { return shading_; }
+  void set_shading(Shading shading) { shading_ = shading; }
+
+  // 扫描线着色使用的指令集，默认为 CPU 支持的最高指令集
+  simd::Isa simd_isa() const { return simd_isa_; }
+  void set_simd_isa(simd::Isa isa) { simd_isa_ = isa; }
+
+  // 是否使用分层深度缓冲提前剔除被遮挡的三角形、块和扫描线段，
+  // 跳过的工作量记录在帧缓冲的 hi_z().stats() 中
+  bool hi_z() const { return hi_z_; }
+  void set_hi_z(bool hi_z) { hi_z_ = hi_z; }
+
+  // 上一帧视锥剔除和裁剪的统计，增量渲染时只统计重新变换的物体
+  ClipStats const &clip_stats() const { return clip_stats_; }
+
+  // 是否增量渲染：只重绘上一帧之后改变的物体新旧位置覆盖的区域，没有改变时不绘制。
+  // 比较物体的变换、状态、渲染方式以及相机和场景设置来发现改变，
+  // 光照、材质、模型数据的改变或直接修改帧缓冲后需调用 Invalidate
+  bool incremental() const { return incremental_; }
+  void set_incremental(bool incremental) { incremental_ = incremental; }
+  // 下一帧整帧重绘
+  void Invalidate() { invalidated_ = true; }
+  // 上一帧重绘的区域，没有重绘时为空
+  std::vector<Rect> const &redrawn() const { return redrawn_; }
+
+  // 是否将屏幕分块后多线程光栅化
+  bool tiled() const { return tiled_; }
+  void set_tiled(bool tiled) { tiled_ = tiled; }
+  // 并行变换物体和分块渲染时使用的线程数
+  int nthreads() const { return nthreads_; }
+  void set_nthreads(int nthreads);
+
  private:
-  void RenderOneObject(Object *obj, FrameBuffer *fb);
+  using Objects = std::vector<std::unique_ptr<Object>>;
+
+  // 增量渲染时上一帧物体的状态，以及变换后在屏幕上覆盖的范围
+  struct ObjectSnapshot {
+    // 除 bounds 外的状态是否完全相同
+    bool Same(ObjectSnapshot const &rhs) const;
+
+    Matrix4x4 model{};
+    ObjectState state{};
+    unsigned render_style{};
+    Polygon const *polygons{};
+    int npolygons{};
+    Rect bounds{};
+  };
+  // 增量渲染时上一帧影响所有物体的设置
+  struct SceneSnapshot {
+    bool Same(SceneSnapshot const &rhs) const;
+
+    Matrix4x4 camera{};
+    Vector3 camera_pos{};
+    Color foreground{};
+    Color background{};
+    Rasterizer rasterizer{};
+    Shading shading{};
+    Rect viewport{};
+    int nobjects{};
+    int nalpha_objects{};
+  };
+
+  ThreadPool *pool();
+  // 开始渲染视口为 viewport 的视图，viewport 为空时为整个帧缓冲
+  void BeginView(Camera const &camera, Rect const &viewport,
+                 FrameBuffer const &fb);
+  void EndView();
+  // 按当前视图变换物体的顶点并剔除、裁剪多边形，整个物体在视锥外时返回 false。
+  // 物体的变换、相机和视口的版本与上次相同时直接沿用上次的结果，
+  // 只有物体的变换改变时才重新计算世界空间中的顶点和法线。
+  // 只修改 obj 和 stats，不同的物体可以在多个线程中同时变换
+  bool TransformObject(Object *obj, ClipStats *stats);
+  // 实际的顶点处理，world 为 false 时沿用之前变换到世界空间的顶点和法线
+  bool ProcessVertexs(Object *obj, bool world, ClipStats *stats);
+  // 用 planes 中的平面裁剪多边形，生成的多边形加入 obj->clipped_polygons()
+  void ClipPolygon(Object *obj, Polygon const &poly, unsigned planes,
+                   ClipStats *stats);
+  // 用线程池并行变换 objs 中的物体，统计计入 clip_stats_
+  void TransformObjects(std::vector<Object *> const &objs);
+  // 启用的物体，不透明物体在前
+  std::vector<Object *> ActiveObjects() const;
+  // 依次处理物体中可见的多边形，包括裁剪生成的多边形。
+  // 完整保留的面只遍历剔除后的下标列表
+  template <class Func>
+  static void ForEachActivePolygon(Object *obj, Func &&func) {
+    auto const &polygons = obj->polygons();
+    for (int i : obj->visible_polygons()) {
+      func(polygons[i]);
+    }
+    for (auto const &poly : obj->clipped_polygons()) {
+      if (poly.state() == PolygonState::kActive) {
+        func(poly);
+      }
+    }
+  }
+  void RenderOneObject(Object *obj, GBuffer *gbuffer, FrameBuffer *fb);
+  void BinOneObject(Object *obj, FrameBuffer const &fb);
+  void RenderTiled(Objects const &objects, GBuffer *gbuffer, FrameBuffer *fb);
+  // 依次光栅化 objects 中的物体，gbuffer 不为空时不透明物体只写入几何属性
+  void RenderObjects(Objects const &objects, GBuffer *gbuffer,
+                     FrameBuffer *fb);
+  void RenderDeferred(FrameBuffer *fb);
+  // 光栅化所有已变换的物体，只写入裁剪矩形内的像素
+  void RenderPasses(FrameBuffer *fb);
+  void RenderIncremental(FrameBuffer *fb);
+  // 变换后物体在当前视口中覆盖的范围
+  Rect ObjectBounds(Object *obj);
 
   int id_{100};
   Camera camera_{};
+  Rect viewport_{};
+  // 当前视图的相机和视口
+  Camera const *view_camera_{&camera_};
+  Rect view_rect_{};
+  ViewportTransform view_transform_{};
+  // 当前视图相机的观察矩阵乘投影矩阵
+  Matrix4x4 view_projection_{};
   Color foreground_{colors::White()};
   Color background_{colors::Black()};
-  std::vector<std::unique_ptr<Object>> objects_{};
-  std::vector<std::unique_ptr<Object>> alpha_objects_{};
+  Objects objects_{};
+  Objects alpha_objects_{};
   Lights lights_{};
+  Rasterizer rasterizer_{Rasterizer::kTrapezoid};
+  Shading shading_{Shading::kForward};
+  simd::Isa simd_isa_{simd::DetectIsa()};
+  bool hi_z_{true};
+  bool tiled_{};
+  int nthreads_{1};
+  std::unique_ptr<ThreadPool> pool_{};
+  ClipStats clip_stats_{};
+  TileBins bins_{};
+  GBuffer gbuffer_{};
+  bool incremental_{};
+  bool invalidated_{};
+  DamageTracker damage_{};
+  SceneSnapshot snapshot_{};
+  std::vector<ObjectSnapshot> object_snapshots_{};
+  std::vector<Rect> redrawn_{};
 };
 
 }  // namespace sren
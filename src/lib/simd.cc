@@ -0,0 +1,454 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#if defined(_MSC_VER) && defined(SREN_SIMD_X86)
+#include <intrin.h>
+#endif
+
+namespace sren {
+
+namespace simd {
+
+namespace {
+
+Isa Detect() {
+#if defined(SREN_SIMD_X86)
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return Isa::kSse2;
+  }
+#elif defined(_MSC_VER)
+  int info[4]{};
+  __cpuid(info, 0);
+  int const nids = info[0];
+  __cpuid(info, 1);
+  bool const sse2 = info[3] & (1 << 26);
+  bool const osxsave = info[2] & (1 << 27);
+  bool const avx = info[2] & (1 << 28);
+  if (nids >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5)) {
+      return Isa::kAvx2;
+    }
+  }
+  if (sse2) {
+    return Isa::kSse2;
+  }
+#endif
+#endif
+  return Isa::kScalar;
+}
+
+void Fill32Scalar(std::uint32_t *dst, std::size_t n, std::uint32_t value) {
+  std::fill(dst, dst + n, value);
+}
+
+void Average4x32Scalar(std::uint32_t const *src, std::uint32_t *dst,
+                       std::size_t n) {
+  for (std::size_t i = 0; i < n; i++, src += 4) {
+    std::uint32_t avg = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      std::uint32_t sum = 2;
+      for (int k = 0; k < 4; k++) {
+        sum += (src[k] >> shift) & 0xFF;
+      }
+      avg |= (sum >> 2) << shift;
+    }
+    dst[i] = avg;
+  }
+}
+
+// 结果的分量 j 为 sum(v[i] * m[i][j])，按 i 的顺序累加，与 SIMD 版本的结果一致
+void Transform4x4Scalar(float const *m, float const *const *src,
+                        float *const *dst, std::size_t begin, std::size_t n) {
+  for (std::size_t k = begin; k < n; k++) {
+    float const v[] = {src[0][k], src[1][k], src[2][k], src[3][k]};
+    for (int j = 0; j < 4; j++) {
+      float r = v[0] * m[j];
+      for (int i = 1; i < 4; i++) {
+        r += v[i] * m[i * 4 + j];
+      }
+      dst[j][k] = r;
+    }
+  }
+}
+
+void ProjectScalar(float const *const *src, float *const *dst,
+                   std::size_t begin, std::size_t n, float const *scale,
+                   float const *offset) {
+  for (std::size_t k = begin; k < n; k++) {
+    float const rhw = 1.0f / src[3][k];
+    for (int c = 0; c < 3; c++) {
+      dst[c][k] = src[c][k] * rhw * scale[c] + offset[c];
+    }
+    dst[3][k] = 1.0f;
+  }
+}
+
+void SignedAreasScalar(float const *x, float const *y, int const *indexs,
+                       std::size_t begin, std::size_t n, float *areas) {
+  for (std::size_t f = begin; f < n; f++) {
+    auto const i = indexs + f * 3;
+    float const x1 = x[i[1]] - x[i[0]];
+    float const y1 = y[i[1]] - y[i[0]];
+    float const x2 = x[i[2]] - x[i[0]];
+    float const y2 = y[i[2]] - y[i[0]];
+    areas[f] = x1 * y2 - y1 * x2;
+  }
+}
+
+#if defined(SREN_SIMD_X86)
+
+// 先逐个写到 align 字节对齐处，返回剩余的个数
+std::size_t FillHead(std::uint32_t **dst, std::size_t n, std::uint32_t value,
+                     std::size_t align) {
+  while (n > 0 && reinterpret_cast<std::uintptr_t>(*dst) % align != 0) {
+    *(*dst)++ = value;
+    n--;
+  }
+  return n;
+}
+
+SREN_TARGET("sse2")
+void Fill32Sse2(std::uint32_t *dst, std::size_t n, std::uint32_t value) {
+  n = FillHead(&dst, n, value, 16);
+  auto const v = _mm_set1_epi32(int(value));
+  for (; n >= 4; n -= 4, dst += 4) {
+    _mm_store_si128(reinterpret_cast<__m128i *>(dst), v);
+  }
+  Fill32Scalar(dst, n, value);
+}
+
+SREN_TARGET("avx2")
+void Fill32Avx2(std::uint32_t *dst, std::size_t n, std::uint32_t value) {
+  n = FillHead(&dst, n, value, 32);
+  auto const v = _mm256_set1_epi32(int(value));
+  for (; n >= 8; n -= 8, dst += 8) {
+    _mm256_store_si256(reinterpret_cast<__m256i *>(dst), v);
+  }
+  Fill32Scalar(dst, n, value);
+}
+
+// 两组各 4 个颜色的 16 位逐通道和，结果的低 64 位对应 a，高 64 位对应 b
+SREN_TARGET("sse2")
+inline __m128i Sum4x2Sse2(__m128i a, __m128i b) {
+  auto const zero = _mm_setzero_si128();
+  // 前两个颜色与后两个颜色相加，每组剩下两个颜色的和
+  auto const sa =
+      _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero));
+  auto const sb =
+      _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero));
+  return _mm_add_epi16(_mm_unpacklo_epi64(sa, sb), _mm_unpackhi_epi64(sa, sb));
+}
+
+SREN_TARGET("sse2")
+void Average4x32Sse2(std::uint32_t const *src, std::uint32_t *dst,
+                     std::size_t n) {
+  auto const round = _mm_set1_epi16(2);
+  for (; n >= 4; n -= 4, src += 16, dst += 4) {
+    auto const p = reinterpret_cast<__m128i const *>(src);
+    auto lo = Sum4x2Sse2(_mm_loadu_si128(p), _mm_loadu_si128(p + 1));
+    auto hi = Sum4x2Sse2(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                     _mm_packus_epi16(lo, hi));
+  }
+  Average4x32Scalar(src, dst, n);
+}
+
+// 与 Sum4x2Sse2 相同，两个 128 位通道各自独立计算
+SREN_TARGET("avx2")
+inline __m256i Sum4x2Avx2(__m256i a, __m256i b) {
+  auto const zero = _mm256_setzero_si256();
+  auto const sa = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero),
+                                   _mm256_unpackhi_epi8(a, zero));
+  auto const sb = _mm256_add_epi16(_mm256_unpacklo_epi8(b, zero),
+                                   _mm256_unpackhi_epi8(b, zero));
+  return _mm256_add_epi16(_mm256_unpacklo_epi64(sa, sb),
+                          _mm256_unpackhi_epi64(sa, sb));
+}
+
+SREN_TARGET("avx2")
+void Average4x32Avx2(std::uint32_t const *src, std::uint32_t *dst,
+                     std::size_t n) {
+  auto const round = _mm256_set1_epi16(2);
+  // 打包后的顺序为 0 2 4 6 1 3 5 7，按此恢复原来的顺序
+  auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  for (; n >= 8; n -= 8, src += 32, dst += 8) {
+    auto const p = reinterpret_cast<__m256i const *>(src);
+    auto lo = Sum4x2Avx2(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1));
+    auto hi = Sum4x2Avx2(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 2);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 2);
+    auto const packed = _mm256_packus_epi16(lo, hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst),
+                        _mm256_permutevar8x32_epi32(packed, order));
+  }
+  Average4x32Sse2(src, dst, n);
+}
+
+SREN_TARGET("sse2")
+void Transform4x4Sse2(float const *m, float const *const *src,
+                      float *const *dst, std::size_t n) {
+  __m128 mm[16];
+  for (int i = 0; i < 16; i++) {
+    mm[i] = _mm_set1_ps(m[i]);
+  }
+  std::size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    // 先读出全部分量再写，src 与 dst 相同时也正确
+    __m128 const v[] = {_mm_loadu_ps(src[0] + k), _mm_loadu_ps(src[1] + k),
+                        _mm_loadu_ps(src[2] + k), _mm_loadu_ps(src[3] + k)};
+    for (int j = 0; j < 4; j++) {
+      auto r = _mm_mul_ps(v[0], mm[j]);
+      r = _mm_add_ps(r, _mm_mul_ps(v[1], mm[4 + j]));
+      r = _mm_add_ps(r, _mm_mul_ps(v[2], mm[8 + j]));
+      r = _mm_add_ps(r, _mm_mul_ps(v[3], mm[12 + j]));
+      _mm_storeu_ps(dst[j] + k, r);
+    }
+  }
+  Transform4x4Scalar(m, src, dst, k, n);
+}
+
+// 不使用 FMA，乘加分开舍入，与标量和 SSE2 版本的结果逐位相同
+SREN_TARGET("avx2")
+void Transform4x4Avx2(float const *m, float const *const *src,
+                      float *const *dst, std::size_t n) {
+  __m256 mm[16];
+  for (int i = 0; i < 16; i++) {
+    mm[i] = _mm256_set1_ps(m[i]);
+  }
+  std::size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    __m256 const v[] = {
+        _mm256_loadu_ps(src[0] + k), _mm256_loadu_ps(src[1] + k),
+        _mm256_loadu_ps(src[2] + k), _mm256_loadu_ps(src[3] + k)};
+    for (int j = 0; j < 4; j++) {
+      auto r = _mm256_mul_ps(v[0], mm[j]);
+      r = _mm256_add_ps(r, _mm256_mul_ps(v[1], mm[4 + j]));
+      r = _mm256_add_ps(r, _mm256_mul_ps(v[2], mm[8 + j]));
+      r = _mm256_add_ps(r, _mm256_mul_ps(v[3], mm[12 + j]));
+      _mm256_storeu_ps(dst[j] + k, r);
+    }
+  }
+  Transform4x4Scalar(m, src, dst, k, n);
+}
+
+SREN_TARGET("sse2")
+void ProjectSse2(float const *const *src, float *const *dst, std::size_t n,
+                 float const *scale, float const *offset) {
+  auto const one = _mm_set1_ps(1.0f);
+  __m128 const s[] = {_mm_set1_ps(scale[0]), _mm_set1_ps(scale[1]),
+                      _mm_set1_ps(scale[2])};
+  __m128 const o[] = {_mm_set1_ps(offset[0]), _mm_set1_ps(offset[1]),
+                      _mm_set1_ps(offset[2])};
+  std::size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    auto const rhw = _mm_div_ps(one, _mm_loadu_ps(src[3] + k));
+    for (int c = 0; c < 3; c++) {
+      auto const v =
+          _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(src[c] + k), rhw), s[c]);
+      _mm_storeu_ps(dst[c] + k, _mm_add_ps(v, o[c]));
+    }
+    _mm_storeu_ps(dst[3] + k, one);
+  }
+  ProjectScalar(src, dst, k, n, scale, offset);
+}
+
+SREN_TARGET("avx2")
+void ProjectAvx2(float const *const *src, float *const *dst, std::size_t n,
+                 float const *scale, float const *offset) {
+  auto const one = _mm256_set1_ps(1.0f);
+  __m256 const s[] = {_mm256_set1_ps(scale[0]), _mm256_set1_ps(scale[1]),
+                      _mm256_set1_ps(scale[2])};
+  __m256 const o[] = {_mm256_set1_ps(offset[0]), _mm256_set1_ps(offset[1]),
+                      _mm256_set1_ps(offset[2])};
+  std::size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    auto const rhw = _mm256_div_ps(one, _mm256_loadu_ps(src[3] + k));
+    for (int c = 0; c < 3; c++) {
+      auto const v = _mm256_mul_ps(
+          _mm256_mul_ps(_mm256_loadu_ps(src[c] + k), rhw), s[c]);
+      _mm256_storeu_ps(dst[c] + k, _mm256_add_ps(v, o[c]));
+    }
+    _mm256_storeu_ps(dst[3] + k, one);
+  }
+  ProjectScalar(src, dst, k, n, scale, offset);
+}
+
+SREN_TARGET("sse2")
+void SignedAreasSse2(float const *x, float const *y, int const *indexs,
+                     std::size_t n, float *areas) {
+  std::size_t f = 0;
+  for (; f + 4 <= n; f += 4) {
+    auto const i = indexs + f * 3;
+    __m128 px[3];
+    __m128 py[3];
+    for (int k = 0; k < 3; k++) {
+      px[k] = _mm_setr_ps(x[i[k]], x[i[k + 3]], x[i[k + 6]], x[i[k + 9]]);
+      py[k] = _mm_setr_ps(y[i[k]], y[i[k + 3]], y[i[k + 6]], y[i[k + 9]]);
+    }
+    auto const x1 = _mm_sub_ps(px[1], px[0]);
+    auto const y1 = _mm_sub_ps(py[1], py[0]);
+    auto const x2 = _mm_sub_ps(px[2], px[0]);
+    auto const y2 = _mm_sub_ps(py[2], py[0]);
+    _mm_storeu_ps(areas + f,
+                  _mm_sub_ps(_mm_mul_ps(x1, y2), _mm_mul_ps(y1, x2)));
+  }
+  SignedAreasScalar(x, y, indexs, f, n, areas);
+}
+
+SREN_TARGET("avx2")
+void SignedAreasAvx2(float const *x, float const *y, int const *indexs,
+                     std::size_t n, float *areas) {
+  std::size_t f = 0;
+  for (; f + 8 <= n; f += 8) {
+    auto const i = indexs + f * 3;
+    __m256 px[3];
+    __m256 py[3];
+    for (int k = 0; k < 3; k++) {
+      px[k] = _mm256_setr_ps(x[i[k]], x[i[k + 3]], x[i[k + 6]], x[i[k + 9]],
+                             x[i[k + 12]], x[i[k + 15]], x[i[k + 18]],
+                             x[i[k + 21]]);
+      py[k] = _mm256_setr_ps(y[i[k]], y[i[k + 3]], y[i[k + 6]], y[i[k + 9]],
+                             y[i[k + 12]], y[i[k + 15]], y[i[k + 18]],
+                             y[i[k + 21]]);
+    }
+    auto const x1 = _mm256_sub_ps(px[1], px[0]);
+    auto const y1 = _mm256_sub_ps(py[1], py[0]);
+    auto const x2 = _mm256_sub_ps(px[2], px[0]);
+    auto const y2 = _mm256_sub_ps(py[2], py[0]);
+    _mm256_storeu_ps(areas + f, _mm256_sub_ps(_mm256_mul_ps(x1, y2),
+                                              _mm256_mul_ps(y1, x2)));
+  }
+  SignedAreasScalar(x, y, indexs, f, n, areas);
+}
+
+#endif
+
+}  // namespace
+
+Isa DetectIsa() {
+  static Isa const isa = Detect();
+  return isa;
+}
+
+char const *IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return "scalar";
+    case Isa::kSse2:
+      return "sse2";
+    case Isa::kAvx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+void *AlignedAlloc(std::size_t size) {
+#if defined(_MSC_VER)
+  return _aligned_malloc(size, kCacheLine);
+#else
+  void *p = nullptr;
+  if (posix_memalign(&p, kCacheLine, size) != 0) {
+    return nullptr;
+  }
+  return p;
+#endif
+}
+
+void AlignedFree(void *p) {
+#if defined(_MSC_VER)
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void Fill32(std::uint32_t *dst, std::size_t n, std::uint32_t value) {
+#if defined(SREN_SIMD_X86)
+  switch (DetectIsa()) {
+    case Isa::kAvx2:
+      return Fill32Avx2(dst, n, value);
+    case Isa::kSse2:
+      return Fill32Sse2(dst, n, value);
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  Fill32Scalar(dst, n, value);
+}
+
+void Average4x32(std::uint32_t const *src, std::uint32_t *dst, std::size_t n,
+                 Isa isa) {
+#if defined(SREN_SIMD_X86)
+  switch (std::min(isa, DetectIsa())) {
+    case Isa::kAvx2:
+      return Average4x32Avx2(src, dst, n);
+    case Isa::kSse2:
+      return Average4x32Sse2(src, dst, n);
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  Average4x32Scalar(src, dst, n);
+}
+
+void Transform4x4(float const *m, float const *const *src, float *const *dst,
+                  std::size_t n, Isa isa) {
+#if defined(SREN_SIMD_X86)
+  switch (std::min(isa, DetectIsa())) {
+    case Isa::kAvx2:
+      return Transform4x4Avx2(m, src, dst, n);
+    case Isa::kSse2:
+      return Transform4x4Sse2(m, src, dst, n);
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  Transform4x4Scalar(m, src, dst, 0, n);
+}
+
+void Project(float const *const *src, float *const *dst, std::size_t n,
+             float const *scale, float const *offset, Isa isa) {
+#if defined(SREN_SIMD_X86)
+  switch (std::min(isa, DetectIsa())) {
+    case Isa::kAvx2:
+      return ProjectAvx2(src, dst, n, scale, offset);
+    case Isa::kSse2:
+      return ProjectSse2(src, dst, n, scale, offset);
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  ProjectScalar(src, dst, 0, n, scale, offset);
+}
+
+void SignedAreas(float const *x, float const *y, int const *indexs,
+                 std::size_t n, float *areas, Isa isa) {
+#if defined(SREN_SIMD_X86)
+  switch (std::min(isa, DetectIsa())) {
+    case Isa::kAvx2:
+      return SignedAreasAvx2(x, y, indexs, n, areas);
+    case Isa::kSse2:
+      return SignedAreasSse2(x, y, indexs, n, areas);
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  SignedAreasScalar(x, y, indexs, 0, n, areas);
+}
+
+}  // namespace simd
+
+}  // namespace sren
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define SREN_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// 为单个函数开启指定指令集，调用前需先用 DetectIsa 确认 CPU 支持
+#if defined(__GNUC__) || defined(__clang__)
+#define SREN_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SREN_TARGET(isa)
+#endif
+
+namespace sren {
+
+namespace simd {
+
+// 指令集等级，数值越大支持的指令越多
+enum class Isa {
+  kScalar = 0,
+  kSse2 = 1,
+  kAvx2 = 2,
+};
+
+// 运行时检测当前 CPU 支持的最高指令集，结果会被缓存
+Isa DetectIsa();
+
+char const *IsaName(Isa isa);
+
+// 缓存行大小，帧缓冲等大块内存按此对齐
+constexpr std::size_t kCacheLine = 64;
+
+// 按缓存行对齐分配和释放内存
+void *AlignedAlloc(std::size_t size);
+void AlignedFree(void *p);
+
+// 按缓存行对齐的分配器，用于 std::vector
+template <class T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <class U>
+  AlignedAllocator(AlignedAllocator<U> const &) {}
+
+  T *allocate(std::size_t n) {
+    auto const p = AlignedAlloc(n * sizeof(T));
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(p);
+  }
+  void deallocate(T *p, std::size_t) { AlignedFree(p); }
+
+  template <class U>
+  friend bool operator==(AlignedAllocator const &, AlignedAllocator<U> const &) {
+    return true;
+  }
+  template <class U>
+  friend bool operator!=(AlignedAllocator const &, AlignedAllocator<U> const &) {
+    return false;
+  }
+};
+
+// 将 dst 开始的 n 个 32 位值设为 value，按当前 CPU 支持的最高指令集整块写入
+void Fill32(std::uint32_t *dst, std::size_t n, std::uint32_t value);
+
+// dst[i] 为 src[4i] 到 src[4i + 3] 四个打包颜色逐字节的平均值，四舍五入。
+// 用于多重采样的颜色解析，isa 为 CPU 不支持的指令集时退回到支持的最高指令集
+void Average4x32(std::uint32_t const *src, std::uint32_t *dst, std::size_t n,
+                 Isa isa = DetectIsa());
+
+// 对 n 个按分量分开存放的四维向量右乘按行存放的 4x4 矩阵 m，
+// src 和 dst 依次为 x、y、z、w 四个分量的数组，两者可以相同。
+// SSE2 每次处理 4 个向量，AVX2 每次处理 8 个，余下的逐个计算
+void Transform4x4(float const *m, float const *const *src, float *const *dst,
+                  std::size_t n, Isa isa = DetectIsa());
+
+// 对 n 个按分量分开存放的裁剪空间坐标做透视除法后缩放和平移：
+// dst 的分量 c 为 src[c] / src[3] * scale[c] + offset[c]，c 为 0 到 2，dst[3] 为 1。
+// 先求 1 / w 再相乘，不使用 FMA，各指令集的结果逐位相同
+void Project(float const *const *src, float *const *dst, std::size_t n,
+             float const *scale, float const *offset, Isa isa = DetectIsa());
+
+// 求 n 个三角形在屏幕上的有向面积的两倍，indexs 中每 3 个为一个三角形的顶点在
+// x、y 中的下标。面积为 (p1 - p0) 与 (p2 - p0) 叉积的 z 分量，按相同的顺序计算，
+// 各指令集的结果逐位相同。坐标按下标逐个读入后一起计算，不使用 AVX2 的 gather
+// 指令，它在一些 CPU 上比逐个读入更慢
+void SignedAreas(float const *x, float const *y, int const *indexs,
+                 std::size_t n, float *areas, Isa isa = DetectIsa());
+
+}  // namespace simd
+
+}  // namespace sren
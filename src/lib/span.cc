@@ -0,0 +1,460 @@
+#include "span.h"
+
+#include <algorithm>
+
+#include "frame_buffer.h"
+
+namespace sren {
+
+namespace spans {
+
+namespace {
+
+bool IsPerspective(int k) { return k >= SpanSetup::kU && k <= SpanSetup::kA; }
+
+template <DepthFormat F>
+unsigned DepthTestScalar(SpanSetup const &s, void const *depth, int i, int n) {
+  using Traits = DepthTraits<F>;
+  auto const d = static_cast<typename Traits::Type const *>(depth);
+  unsigned mask = 0;
+  for (int j = 0; j < n; j++) {
+    float const z = s.start[SpanSetup::kZ] + s.step[SpanSetup::kZ] * (i + j);
+    if (d[j] < Traits::Encode(z)) {
+      mask |= 1u << j;
+    }
+  }
+  return mask;
+}
+
+void InterpScalar(SpanSetup const &s, unsigned attrs, int i, int n,
+                  Lanes *out) {
+  for (int j = 0; j < n; j++) {
+    float const x = float(i + j);
+    float const z = s.start[SpanSetup::kZ] + s.step[SpanSetup::kZ] * x;
+    float const rz = 1.0f / z;
+    for (int k = 0; k < SpanSetup::kCount; k++) {
+      if (!(attrs & AttrBit(k))) {
+        continue;
+      }
+      float const v = s.start[k] + s.step[k] * x;
+      out->values[k][j] = IsPerspective(k) ? v * rz : v;
+    }
+  }
+}
+
+template <DepthFormat F>
+void StoreDepthScalar(SpanSetup const &s, void *depth, int i, int n,
+                      unsigned mask) {
+  using Traits = DepthTraits<F>;
+  auto const d = static_cast<typename Traits::Type *>(depth);
+  for (int j = 0; j < n; j++) {
+    if (mask & (1u << j)) {
+      d[j] = Traits::Encode(s.start[SpanSetup::kZ] +
+                            s.step[SpanSetup::kZ] * (i + j));
+    }
+  }
+}
+
+void StoreColorScalar(std::uint32_t const *src, std::uint32_t *color, int n,
+                      unsigned mask) {
+  for (int j = 0; j < n; j++) {
+    if (mask & (1u << j)) {
+      color[j] = src[j];
+    }
+  }
+}
+
+void BlendColorScalar(std::uint32_t const *src, std::uint32_t *color, int n,
+                      unsigned mask) {
+  for (int j = 0; j < n; j++) {
+    if (mask & (1u << j)) {
+      color[j] = FrameBuffer::BlendPacked(src[j], color[j]);
+    }
+  }
+}
+
+template <DepthFormat F>
+constexpr Kernel ScalarKernel() {
+  return {
+      simd::Isa::kScalar,  kMaxLanes,    F,
+      DepthTestScalar<F>,  InterpScalar, StoreDepthScalar<F>,
+      StoreColorScalar,    BlendColorScalar,
+  };
+}
+
+// 按 DepthFormat 的顺序排列
+Kernel const kScalarKernels[kDepthFormatCount]{
+    ScalarKernel<DepthFormat::kFloat32>(),
+    ScalarKernel<DepthFormat::kUnorm24>(),
+    ScalarKernel<DepthFormat::kUnorm16>(),
+};
+
+#if defined(SREN_SIMD_X86)
+
+SREN_TARGET("sse2")
+__m128 Lane4(SpanSetup const &s, int k, int i) {
+  auto const idx = _mm_add_ps(_mm_set1_ps(float(i)), _mm_set_ps(3, 2, 1, 0));
+  return _mm_add_ps(_mm_set1_ps(s.start[k]),
+                    _mm_mul_ps(_mm_set1_ps(s.step[k]), idx));
+}
+
+// 将 4 位掩码展开为每个通道全 1 或全 0 的向量
+SREN_TARGET("sse2")
+__m128i ExpandMask4(unsigned mask) {
+  auto const bits = _mm_set_epi32(8, 4, 2, 1);
+  auto const m = _mm_and_si128(_mm_set1_epi32(int(mask)), bits);
+  return _mm_cmpeq_epi32(m, bits);
+}
+
+// 4 个像素的深度按 F 格式编码，与 DepthTraits<F>::Encode 的结果一致。
+// 浮点格式直接按位保存，定点数格式为 32 位整数
+template <DepthFormat F>
+SREN_TARGET("sse2")
+__m128i EncodeDepth4(__m128 z) {
+  if (F == DepthFormat::kFloat32) {
+    return _mm_castps_si128(z);
+  }
+  float const max = F == DepthFormat::kUnorm16
+                        ? float(DepthTraits<DepthFormat::kUnorm16>::kMax)
+                        : float(DepthTraits<DepthFormat::kUnorm24>::kMax);
+  z = _mm_min_ps(_mm_max_ps(z, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  return _mm_cvtps_epi32(_mm_mul_ps(z, _mm_set1_ps(max)));
+}
+
+// 读取 4 个像素的深度，定点数格式展开为 32 位整数
+template <DepthFormat F>
+SREN_TARGET("sse2")
+__m128i LoadDepth4(void const *depth) {
+  if (F == DepthFormat::kUnorm16) {
+    return _mm_unpacklo_epi16(
+        _mm_loadl_epi64(static_cast<__m128i const *>(depth)),
+        _mm_setzero_si128());
+  }
+  return _mm_loadu_si128(static_cast<__m128i const *>(depth));
+}
+
+template <DepthFormat F>
+SREN_TARGET("sse2")
+void StoreDepth4(void *depth, __m128i d) {
+  if (F == DepthFormat::kUnorm16) {
+    // SSE2 只有有符号饱和的打包，先平移到有符号范围，打包后再移回
+    auto const biased = _mm_sub_epi32(d, _mm_set1_epi32(0x8000));
+    auto const packed = _mm_packs_epi32(biased, biased);
+    _mm_storel_epi64(static_cast<__m128i *>(depth),
+                     _mm_add_epi16(packed, _mm_set1_epi16(-0x8000)));
+    return;
+  }
+  _mm_storeu_si128(static_cast<__m128i *>(depth), d);
+}
+
+template <DepthFormat F>
+SREN_TARGET("sse2")
+unsigned DepthTestSse2(SpanSetup const &s, void const *depth, int i, int n) {
+  if (n != 4) {
+    return DepthTestScalar<F>(s, depth, i, n);
+  }
+  auto const z = Lane4(s, SpanSetup::kZ, i);
+  if (F == DepthFormat::kFloat32) {
+    auto const pass =
+        _mm_cmplt_ps(_mm_loadu_ps(static_cast<float const *>(depth)), z);
+    return unsigned(_mm_movemask_ps(pass));
+  }
+  // 定点数不超过 24 位，按有符号整数比较也不会溢出
+  auto const pass = _mm_cmpgt_epi32(EncodeDepth4<F>(z), LoadDepth4<F>(depth));
+  return unsigned(_mm_movemask_ps(_mm_castsi128_ps(pass)));
+}
+
+SREN_TARGET("sse2")
+void InterpSse2(SpanSetup const &s, unsigned attrs, int i, int n,
+                Lanes *out) {
+  if (n != 4) {
+    return InterpScalar(s, attrs, i, n, out);
+  }
+  auto const rz = _mm_div_ps(_mm_set1_ps(1.0f), Lane4(s, SpanSetup::kZ, i));
+  for (int k = 0; k < SpanSetup::kCount; k++) {
+    if (!(attrs & AttrBit(k))) {
+      continue;
+    }
+    auto v = Lane4(s, k, i);
+    if (IsPerspective(k)) {
+      v = _mm_mul_ps(v, rz);
+    }
+    _mm_store_ps(out->values[k], v);
+  }
+}
+
+template <DepthFormat F>
+SREN_TARGET("sse2")
+void StoreDepthSse2(SpanSetup const &s, void *depth, int i, int n,
+                    unsigned mask) {
+  if (n != 4) {
+    return StoreDepthScalar<F>(s, depth, i, n, mask);
+  }
+  auto const m = ExpandMask4(mask);
+  auto const z = EncodeDepth4<F>(Lane4(s, SpanSetup::kZ, i));
+  auto const old = LoadDepth4<F>(depth);
+  StoreDepth4<F>(depth,
+                 _mm_or_si128(_mm_and_si128(m, z), _mm_andnot_si128(m, old)));
+}
+
+SREN_TARGET("sse2")
+void StoreColorSse2(std::uint32_t const *src, std::uint32_t *color, int n,
+                    unsigned mask) {
+  if (n != 4) {
+    return StoreColorScalar(src, color, n, mask);
+  }
+  auto const m = ExpandMask4(mask);
+  auto const p = reinterpret_cast<__m128i *>(color);
+  auto const c = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src));
+  auto const old = _mm_loadu_si128(p);
+  _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(m, c),
+                                   _mm_andnot_si128(m, old)));
+}
+
+// 一半像素展开为 16 位通道后的混合结果 (s * a + d * (255 - a)) / 255，
+// a 为每个通道对应像素的 alpha
+SREN_TARGET("sse2")
+__m128i Blend16Sse2(__m128i s, __m128i d, __m128i a) {
+  auto const ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  auto t = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, ia));
+  t = _mm_add_epi16(t, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+SREN_TARGET("sse2")
+void BlendColorSse2(std::uint32_t const *src, std::uint32_t *color, int n,
+                    unsigned mask) {
+  if (n != 4) {
+    return BlendColorScalar(src, color, n, mask);
+  }
+  auto const p = reinterpret_cast<__m128i *>(color);
+  auto const c = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src));
+  auto const old = _mm_loadu_si128(p);
+  // 每个像素的 alpha 复制到该像素的 4 个 16 位通道
+  auto a = _mm_srli_epi32(c, 24);
+  a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+  auto const zero = _mm_setzero_si128();
+  auto const lo = Blend16Sse2(_mm_unpacklo_epi8(c, zero),
+                              _mm_unpacklo_epi8(old, zero),
+                              _mm_unpacklo_epi32(a, a));
+  auto const hi = Blend16Sse2(_mm_unpackhi_epi8(c, zero),
+                              _mm_unpackhi_epi8(old, zero),
+                              _mm_unpackhi_epi32(a, a));
+  auto const m = ExpandMask4(mask);
+  _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(m, _mm_packus_epi16(lo, hi)),
+                                   _mm_andnot_si128(m, old)));
+}
+
+template <DepthFormat F>
+constexpr Kernel Sse2Kernel() {
+  return {
+      simd::Isa::kSse2,  4,          F,
+      DepthTestSse2<F>,  InterpSse2, StoreDepthSse2<F>,
+      StoreColorSse2,    BlendColorSse2,
+  };
+}
+
+Kernel const kSse2Kernels[kDepthFormatCount]{
+    Sse2Kernel<DepthFormat::kFloat32>(),
+    Sse2Kernel<DepthFormat::kUnorm24>(),
+    Sse2Kernel<DepthFormat::kUnorm16>(),
+};
+
+SREN_TARGET("avx2")
+__m256 Lane8(SpanSetup const &s, int k, int i) {
+  auto const idx = _mm256_add_ps(_mm256_set1_ps(float(i)),
+                                 _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0));
+  return _mm256_add_ps(_mm256_set1_ps(s.start[k]),
+                       _mm256_mul_ps(_mm256_set1_ps(s.step[k]), idx));
+}
+
+// 将 8 位掩码展开为每个通道全 1 或全 0 的向量
+SREN_TARGET("avx2")
+__m256i ExpandMask8(unsigned mask) {
+  auto const bits = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+  auto const m = _mm256_and_si256(_mm256_set1_epi32(int(mask)), bits);
+  return _mm256_cmpeq_epi32(m, bits);
+}
+
+template <DepthFormat F>
+SREN_TARGET("avx2")
+__m256i EncodeDepth8(__m256 z) {
+  if (F == DepthFormat::kFloat32) {
+    return _mm256_castps_si256(z);
+  }
+  float const max = F == DepthFormat::kUnorm16
+                        ? float(DepthTraits<DepthFormat::kUnorm16>::kMax)
+                        : float(DepthTraits<DepthFormat::kUnorm24>::kMax);
+  z = _mm256_min_ps(_mm256_max_ps(z, _mm256_setzero_ps()),
+                    _mm256_set1_ps(1.0f));
+  return _mm256_cvtps_epi32(_mm256_mul_ps(z, _mm256_set1_ps(max)));
+}
+
+template <DepthFormat F>
+SREN_TARGET("avx2")
+__m256i LoadDepth8(void const *depth) {
+  if (F == DepthFormat::kUnorm16) {
+    return _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(static_cast<__m128i const *>(depth)));
+  }
+  return _mm256_loadu_si256(static_cast<__m256i const *>(depth));
+}
+
+template <DepthFormat F>
+SREN_TARGET("avx2")
+unsigned DepthTestAvx2(SpanSetup const &s, void const *depth, int i, int n) {
+  if (n != 8) {
+    return DepthTestScalar<F>(s, depth, i, n);
+  }
+  auto const z = Lane8(s, SpanSetup::kZ, i);
+  if (F == DepthFormat::kFloat32) {
+    auto const pass = _mm256_cmp_ps(
+        _mm256_loadu_ps(static_cast<float const *>(depth)), z, _CMP_LT_OQ);
+    return unsigned(_mm256_movemask_ps(pass));
+  }
+  auto const pass =
+      _mm256_cmpgt_epi32(EncodeDepth8<F>(z), LoadDepth8<F>(depth));
+  return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(pass)));
+}
+
+SREN_TARGET("avx2")
+void InterpAvx2(SpanSetup const &s, unsigned attrs, int i, int n,
+                Lanes *out) {
+  if (n != 8) {
+    return InterpScalar(s, attrs, i, n, out);
+  }
+  auto const rz =
+      _mm256_div_ps(_mm256_set1_ps(1.0f), Lane8(s, SpanSetup::kZ, i));
+  for (int k = 0; k < SpanSetup::kCount; k++) {
+    if (!(attrs & AttrBit(k))) {
+      continue;
+    }
+    auto v = Lane8(s, k, i);
+    if (IsPerspective(k)) {
+      v = _mm256_mul_ps(v, rz);
+    }
+    _mm256_store_ps(out->values[k], v);
+  }
+}
+
+template <DepthFormat F>
+SREN_TARGET("avx2")
+void StoreDepthAvx2(SpanSetup const &s, void *depth, int i, int n,
+                    unsigned mask) {
+  if (n != 8) {
+    return StoreDepthScalar<F>(s, depth, i, n, mask);
+  }
+  auto const m = ExpandMask8(mask);
+  auto const z = EncodeDepth8<F>(Lane8(s, SpanSetup::kZ, i));
+  if (F != DepthFormat::kUnorm16) {
+    _mm256_maskstore_epi32(static_cast<int *>(depth), m, z);
+    return;
+  }
+  // 16 位没有按掩码的存储，与原有深度混合后整组写回。
+  // 打包在 128 位内进行，再把两半的低 64 位拼在一起
+  auto const d = _mm256_blendv_epi8(LoadDepth8<F>(depth), z, m);
+  auto const packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(d, d), 0x08);
+  _mm_storeu_si128(static_cast<__m128i *>(depth),
+                   _mm256_castsi256_si128(packed));
+}
+
+SREN_TARGET("avx2")
+void StoreColorAvx2(std::uint32_t const *src, std::uint32_t *color, int n,
+                    unsigned mask) {
+  if (n != 8) {
+    return StoreColorScalar(src, color, n, mask);
+  }
+  auto const c = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src));
+  _mm256_maskstore_epi32(reinterpret_cast<int *>(color), ExpandMask8(mask), c);
+}
+
+SREN_TARGET("avx2")
+__m256i Blend16Avx2(__m256i s, __m256i d, __m256i a) {
+  auto const ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+  auto t = _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, ia));
+  t = _mm256_add_epi16(t, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+SREN_TARGET("avx2")
+void BlendColorAvx2(std::uint32_t const *src, std::uint32_t *color, int n,
+                    unsigned mask) {
+  if (n != 8) {
+    return BlendColorScalar(src, color, n, mask);
+  }
+  auto const c = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src));
+  auto const old = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(color));
+  // 展开和打包都在 128 位内进行，两者顺序一致
+  auto a = _mm256_srli_epi32(c, 24);
+  a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+  auto const zero = _mm256_setzero_si256();
+  auto const lo = Blend16Avx2(_mm256_unpacklo_epi8(c, zero),
+                              _mm256_unpacklo_epi8(old, zero),
+                              _mm256_unpacklo_epi32(a, a));
+  auto const hi = Blend16Avx2(_mm256_unpackhi_epi8(c, zero),
+                              _mm256_unpackhi_epi8(old, zero),
+                              _mm256_unpackhi_epi32(a, a));
+  _mm256_maskstore_epi32(reinterpret_cast<int *>(color), ExpandMask8(mask),
+                         _mm256_packus_epi16(lo, hi));
+}
+
+template <DepthFormat F>
+constexpr Kernel Avx2Kernel() {
+  return {
+      simd::Isa::kAvx2,  8,          F,
+      DepthTestAvx2<F>,  InterpAvx2, StoreDepthAvx2<F>,
+      StoreColorAvx2,    BlendColorAvx2,
+  };
+}
+
+Kernel const kAvx2Kernels[kDepthFormatCount]{
+    Avx2Kernel<DepthFormat::kFloat32>(),
+    Avx2Kernel<DepthFormat::kUnorm24>(),
+    Avx2Kernel<DepthFormat::kUnorm16>(),
+};
+
+#endif
+
+}  // namespace
+
+SpanSetup MakeSetup(Vertex const &start, Vertex const &step) {
+  auto const fill = [](Vertex const &v, float *out) {
+    out[SpanSetup::kZ] = v.pos().z();
+    out[SpanSetup::kU] = v.uv().x();
+    out[SpanSetup::kV] = v.uv().y();
+    out[SpanSetup::kR] = v.color().r();
+    out[SpanSetup::kG] = v.color().g();
+    out[SpanSetup::kB] = v.color().b();
+    out[SpanSetup::kA] = v.color().a();
+    out[SpanSetup::kWorldX] = v.world_pos().x();
+    out[SpanSetup::kWorldY] = v.world_pos().y();
+    out[SpanSetup::kWorldZ] = v.world_pos().z();
+    out[SpanSetup::kNormalX] = v.normal().x();
+    out[SpanSetup::kNormalY] = v.normal().y();
+    out[SpanSetup::kNormalZ] = v.normal().z();
+  };
+  SpanSetup s{};
+  fill(start, s.start);
+  fill(step, s.step);
+  return s;
+}
+
+Kernel const &GetKernel(simd::Isa isa, DepthFormat format) {
+  isa = std::min(isa, simd::DetectIsa());
+  int const f = int(format);
+#if defined(SREN_SIMD_X86)
+  if (isa == simd::Isa::kAvx2) {
+    return kAvx2Kernels[f];
+  }
+  if (isa == simd::Isa::kSse2) {
+    return kSse2Kernels[f];
+  }
+#endif
+  return kScalarKernels[f];
+}
+
+Kernel const &BestKernel() { return GetKernel(simd::DetectIsa()); }
+
+}  // namespace spans
+
+}  // namespace sren
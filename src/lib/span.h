@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+#include "depth.h"
+#include "simd.h"
+#include "vertex.h"
+
+namespace sren {
+
+// 一段扫描线上像素属性的线性方程，按 SoA 布局存放
+struct SpanSetup {
+  enum Attr {
+    kZ,
+    kU,
+    kV,
+    kR,
+    kG,
+    kB,
+    kA,
+    kWorldX,
+    kWorldY,
+    kWorldZ,
+    kNormalX,
+    kNormalY,
+    kNormalZ,
+    kCount,
+  };
+
+  // 第 i 个像素处属性 k 的值为 start[k] + step[k] * i，kU 到 kA 已乘以 z
+  float start[kCount];
+  float step[kCount];
+};
+
+namespace spans {
+
+constexpr int kMaxLanes = 8;
+
+// 属性集合用掩码表示，第 k 位对应属性 k
+constexpr unsigned AttrBit(int k) { return 1u << k; }
+constexpr unsigned kUvAttrs = AttrBit(SpanSetup::kU) | AttrBit(SpanSetup::kV);
+constexpr unsigned kColorAttrs =
+    AttrBit(SpanSetup::kR) | AttrBit(SpanSetup::kG) | AttrBit(SpanSetup::kB) |
+    AttrBit(SpanSetup::kA);
+constexpr unsigned kWorldAttrs = AttrBit(SpanSetup::kWorldX) |
+                                 AttrBit(SpanSetup::kWorldY) |
+                                 AttrBit(SpanSetup::kWorldZ);
+constexpr unsigned kNormalAttrs = AttrBit(SpanSetup::kNormalX) |
+                                  AttrBit(SpanSetup::kNormalY) |
+                                  AttrBit(SpanSetup::kNormalZ);
+constexpr unsigned kAllAttrs = AttrBit(SpanSetup::kCount) - 1;
+
+// 一组像素的插值结果，kU 到 kA 已除以 z 完成透视修正
+struct Lanes {
+  alignas(32) float values[SpanSetup::kCount][kMaxLanes];
+};
+
+// 一次处理 lanes 个像素的扫描线内核，depth 和 color 指向这一组的第一个像素，
+// depth 按 depth_format 格式存放
+struct Kernel {
+  simd::Isa isa;
+  int lanes;
+  DepthFormat depth_format;
+  // 对从第 i 个像素开始的 n 个像素做深度测试，返回通过测试的像素掩码
+  unsigned (*depth_test)(SpanSetup const &s, void const *depth, int i, int n);
+  // 计算从第 i 个像素开始的 n 个像素中 attrs 包含的属性的插值
+  void (*interp)(SpanSetup const &s, unsigned attrs, int i, int n,
+                 Lanes *out);
+  // 按掩码写入从第 i 个像素开始的 n 个像素的深度
+  void (*store_depth)(SpanSetup const &s, void *depth, int i, int n,
+                      unsigned mask);
+  // 按掩码写入 n 个像素的颜色
+  void (*store_color)(std::uint32_t const *src, std::uint32_t *color, int n,
+                      unsigned mask);
+  // 按掩码将 n 个像素的颜色按各自的 alpha 与原有颜色混合
+  void (*blend_color)(std::uint32_t const *src, std::uint32_t *color, int n,
+                      unsigned mask);
+};
+
+// 由扫描线起点的插值结果和每个像素的增量生成属性方程，
+// start 和 step 中的颜色和 uv 需已乘以 z
+SpanSetup MakeSetup(Vertex const &start, Vertex const &step);
+
+// 指定指令集和深度格式的内核，CPU 不支持时退回到支持的最高指令集
+Kernel const &GetKernel(simd::Isa isa,
+                        DepthFormat format = DepthFormat::kFloat32);
+
+// 当前 CPU 上最快的内核
+Kernel const &BestKernel();
+
+}  // namespace spans
+
+}  // namespace sren
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+namespace sren {
+
+// 单生产者单消费者的无锁环形队列，最多同时存放 N - 1 个元素。
+// Push 只能在一个线程中调用，Pop 只能在另一个线程中调用，
+// Push 之前对元素的写入在 Pop 取出该元素之后可见。
+template <class T, int N>
+class SpscQueue {
+ public:
+  static_assert(N >= 2, "queue needs at least one usable slot");
+
+  // 队列已满时返回 false
+  bool Push(T const &value) {
+    int const tail = tail_.load(std::memory_order_relaxed);
+    int const next = (tail + 1) % N;
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    items_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // 队列为空时返回 false
+  bool Pop(T *value) {
+    int const head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = items_[head];
+    head_.store((head + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  // 生产者和消费者各自修改的位置放在不同的缓存行中
+  static constexpr std::size_t kPadding = 64;
+
+  std::array<T, N> items_{};
+  char pad0_[kPadding]{};
+  std::atomic<int> head_{};
+  char pad1_[kPadding]{};
+  std::atomic<int> tail_{};
+};
+
+// 等待 pred 成立，例如队列中有元素可取，先让出时间片，等待较久时短暂休眠
+template <class Pred>
+void WaitUntil(Pred &&pred) {
+  constexpr int kYields = 64;
+  for (int i = 0; !pred(); i++) {
+    if (i < kYields) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+}
+
+}  // namespace sren
@@ -0,0 +1,233 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sren {
+
+namespace {
+
+// 每个线程拆分并行循环时最多产生的块数
+constexpr int kSplitsPerThread = 8;
+
+// 池中的线程所属的线程池和队列
+struct Worker {
+  ThreadPool const *pool{};
+  int slot{};
+};
+
+thread_local Worker tWorker{};
+
+}  // namespace
+
+ThreadPool::ThreadPool(int nthreads) {
+  nthreads = std::max(1, nthreads);
+  for (int i = 0; i < nthreads; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (int i = 1; i < nthreads; i++) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  cv_.notify_all();
+  for (auto &w : workers_) {
+    w.join();
+  }
+}
+
+int ThreadPool::HardwareThreads() {
+  return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+int ThreadPool::Grain(int n) const {
+  return std::max(1, n / (nthreads() * kSplitsPerThread));
+}
+
+void ThreadPool::ParallelFor(int begin, int end, Func const &func) {
+  if (begin >= end) {
+    return;
+  }
+  if (workers_.empty() || end - begin == 1) {
+    for (int i = begin; i < end; i++) {
+      func(i);
+    }
+    return;
+  }
+  Batch batch{};
+  batch.func = &func;
+  batch.grain = Grain(end - begin);
+  batch.remaining = end - begin;
+  Push(CurrentSlot(), {&batch, begin, end});
+  Wait(batch.remaining);
+}
+
+void ThreadPool::Run(TaskGraph *graph) {
+  auto &nodes = graph->nodes_;
+  if (nodes.empty()) {
+    return;
+  }
+  graph->remaining_ = int(nodes.size());
+  for (int i = 0; i < int(nodes.size()); i++) {
+    auto &node = *nodes[i];
+    node.pending = node.ndeps;
+    node.batch.func = &node.func;
+    node.batch.grain = Grain(node.end - node.begin);
+    node.batch.graph = graph;
+    node.batch.node = i;
+  }
+  int const slot = CurrentSlot();
+  for (int i = 0; i < int(nodes.size()); i++) {
+    if (nodes[i]->ndeps == 0) {
+      Start(slot, graph, i);
+    }
+  }
+  Wait(graph->remaining_);
+}
+
+int ThreadPool::CurrentSlot() const {
+  return tWorker.pool == this ? tWorker.slot : 0;
+}
+
+void ThreadPool::Push(int slot, Job const &job) {
+  auto &queue = *queues_[slot];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(job);
+    queued_++;
+  }
+  // 没有线程在等待时不需要加锁通知。queued_ 与 sleeping_ 都是顺序一致的，
+  // 准备等待的线程要么看到新任务，要么在这里被看到
+  if (sleeping_ > 0) {
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    cv_.notify_one();
+  }
+}
+
+bool ThreadPool::Pop(int slot, Job *job) {
+  int const n = nthreads();
+  for (int k = 0; k < n; k++) {
+    auto &queue = *queues_[(slot + k) % n];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+      continue;
+    }
+    if (k == 0) {
+      *job = queue.jobs.back();
+      queue.jobs.pop_back();
+    } else {
+      *job = queue.jobs.front();
+      queue.jobs.pop_front();
+    }
+    queued_--;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::Execute(int slot, Job const &job) {
+  auto const batch = job.batch;
+  int const begin = job.begin;
+  int end = job.end;
+  // 后一半放回自己的队列，留给空闲的线程窃取
+  while (end - begin > batch->grain) {
+    int const mid = begin + (end - begin) / 2;
+    Push(slot, {batch, mid, end});
+    end = mid;
+  }
+  auto const &func = *batch->func;
+  for (int i = begin; i < end; i++) {
+    func(i);
+  }
+  Finish(slot, batch, end - begin);
+}
+
+void ThreadPool::Finish(int slot, Batch *batch, int count) {
+  // 减到 0 之后等待的线程可能已经返回并销毁 batch，需要先读出所属的任务图
+  auto const graph = batch->graph;
+  int const node = batch->node;
+  if (batch->remaining.fetch_sub(count) != count) {
+    return;
+  }
+  // 任务图的 remaining_ 减到 0 之后同样不能再访问任务图
+  if (graph) {
+    for (int next : graph->nodes_[node]->successors) {
+      if (--graph->nodes_[next]->pending == 0) {
+        Start(slot, graph, next);
+      }
+    }
+    graph->remaining_--;
+  }
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  cv_.notify_all();
+}
+
+void ThreadPool::Start(int slot, TaskGraph *graph, int node) {
+  auto &n = *graph->nodes_[node];
+  n.batch.remaining = n.end - n.begin;
+  if (n.end > n.begin) {
+    Push(slot, {&n.batch, n.begin, n.end});
+  } else {
+    n.batch.remaining = 1;
+    Finish(slot, &n.batch, 1);
+  }
+}
+
+void ThreadPool::Wait(std::atomic<int> const &remaining) {
+  int const slot = CurrentSlot();
+  Job job{};
+  while (remaining > 0) {
+    if (Pop(slot, &job)) {
+      Execute(slot, job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_++;
+    cv_.wait(lock, [&] { return remaining == 0 || queued_ > 0; });
+    sleeping_--;
+  }
+}
+
+void ThreadPool::WorkerLoop(int slot) {
+  tWorker = {this, slot};
+  Job job{};
+  while (true) {
+    if (Pop(slot, &job)) {
+      Execute(slot, job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_++;
+    cv_.wait(lock, [&] { return quit_ || queued_ > 0; });
+    sleeping_--;
+    if (quit_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+int TaskGraph::Add(std::function<void()> func) {
+  return AddParallelFor(0, 1, [func](int) { func(); });
+}
+
+int TaskGraph::AddParallelFor(int begin, int end, ThreadPool::Func func) {
+  auto node = std::make_unique<Node>();
+  node->func = std::move(func);
+  node->begin = begin;
+  node->end = std::max(begin, end);
+  nodes_.push_back(std::move(node));
+  return int(nodes_.size()) - 1;
+}
+
+void TaskGraph::Precede(int before, int after) {
+  assert(before < after && "dependencies must point to later tasks");
+  nodes_[before]->successors.push_back(after);
+  nodes_[after]->ndeps++;
+}
+
+}  // namespace sren
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sren {
+
+class TaskGraph;
+
+// 固定线程数的工作窃取线程池，调用线程也会参与执行任务。
+// 每个线程有自己的任务队列，从队尾取出自己放入的任务，
+// 自己的队列为空时从其他线程的队首窃取。并行循环按二分拆成任务，
+// 最先被窃取的是最大的一块，各次迭代耗时不均时也能自动平衡
+class ThreadPool {
+ public:
+  using Func = std::function<void(int)>;
+
+  // nthreads 为参与计算的线程总数（包括调用线程），小于 1 时按 1 处理
+  explicit ThreadPool(int nthreads);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const &) = delete;
+  void operator=(ThreadPool const &) = delete;
+
+  // 对 [begin, end) 中的每个 i 并行执行 func(i)，返回时所有任务均已完成。
+  // func 中可以再次调用 ParallelFor 或 Run，等待时当前线程会执行其他任务
+  void ParallelFor(int begin, int end, Func const &func);
+  // 按依赖关系执行任务图中的所有任务，返回时全部完成
+  void Run(TaskGraph *graph);
+
+  int nthreads() const { return int(queues_.size()); }
+
+  // 硬件支持的并发线程数
+  static int HardwareThreads();
+
+ private:
+  friend class TaskGraph;
+
+  // 共用同一个函数的一组迭代，remaining 为还没有执行完的迭代数
+  struct Batch {
+    Func const *func{};
+    // 拆分到不超过 grain 次迭代后不再拆分
+    int grain{1};
+    std::atomic<int> remaining{};
+    // 属于任务图时，完成后开始依赖它的任务
+    TaskGraph *graph{};
+    int node{};
+  };
+  // 对 [begin, end) 执行 batch 的函数
+  struct Job {
+    Batch *batch{};
+    int begin{};
+    int end{};
+  };
+  struct Queue {
+    std::mutex mutex{};
+    std::deque<Job> jobs{};
+  };
+
+  // 当前线程的队列，不是池中的线程时为 0 号队列
+  int CurrentSlot() const;
+  void Push(int slot, Job const &job);
+  // 先从自己的队尾取，再从其他队列的队首窃取
+  bool Pop(int slot, Job *job);
+  void Execute(int slot, Job const &job);
+  // batch 又完成了 count 次迭代
+  void Finish(int slot, Batch *batch, int count);
+  // 开始任务图中的一个任务
+  void Start(int slot, TaskGraph *graph, int node);
+  // 执行任务直到 remaining 为 0
+  void Wait(std::atomic<int> const &remaining);
+  void WorkerLoop(int slot);
+  int Grain(int n) const;
+
+  std::vector<std::unique_ptr<Queue>> queues_{};
+  std::vector<std::thread> workers_{};
+  // 以下用于空闲线程等待新任务，以及等待的线程等待任务完成
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::atomic<int> queued_{};
+  std::atomic<int> sleeping_{};
+  bool quit_{};
+};
+
+// 任务图：先添加任务及其依赖，再交给 ThreadPool::Run 执行，可以重复执行
+class TaskGraph {
+ public:
+  TaskGraph() = default;
+  TaskGraph(TaskGraph const &) = delete;
+  void operator=(TaskGraph const &) = delete;
+
+  // 添加执行一次 func 的任务，返回任务的编号
+  int Add(std::function<void()> func);
+  // 添加对 [begin, end) 中每个 i 执行 func(i) 的任务，各次迭代并行执行
+  int AddParallelFor(int begin, int end, ThreadPool::Func func);
+  // 任务 after 在任务 before 完成后才开始，before 必须先于 after 添加，
+  // 因此任务图中不会有环
+  void Precede(int before, int after);
+
+  int size() const { return int(nodes_.size()); }
+
+ private:
+  friend class ThreadPool;
+
+  struct Node {
+    ThreadPool::Func func{};
+    int begin{};
+    int end{};
+    std::vector<int> successors{};
+    int ndeps{};
+    // 执行时还没有完成的前置任务数
+    std::atomic<int> pending{};
+    ThreadPool::Batch batch{};
+  };
+
+  std::vector<std::unique_ptr<Node>> nodes_{};
+  // 执行时还没有完成的任务数
+  std::atomic<int> remaining_{};
+};
+
+}  // namespace sren
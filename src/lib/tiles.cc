@@ -0,0 +1,75 @@
+#include "tiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "math.h"
+
+namespace sren {
+
+void TileBins::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  tiles_x_ = (width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height + kTileSize - 1) / kTileSize;
+  bins_.resize(ntiles());
+  Clear();
+}
+
+void TileBins::Clear() {
+  for (auto &b : bins_) {
+    b.clear();
+  }
+}
+
+void TileBins::Add(Polygon const *poly, Rect const &bounds) {
+  auto const r = bounds.Intersect({0, 0, width_, height_});
+  if (r.empty()) {
+    return;
+  }
+  int const tx0 = r.x0 / kTileSize;
+  int const ty0 = r.y0 / kTileSize;
+  int const tx1 = (r.x1 - 1) / kTileSize;
+  int const ty1 = (r.y1 - 1) / kTileSize;
+  for (int ty = ty0; ty <= ty1; ty++) {
+    for (int tx = tx0; tx <= tx1; tx++) {
+      bins_[tx + ty * tiles_x_].push_back(poly);
+    }
+  }
+}
+
+Rect TileBins::tile_rect(int i) const {
+  int const x0 = (i % tiles_x_) * kTileSize;
+  int const y0 = (i / tiles_x_) * kTileSize;
+  return {x0, y0, std::min(x0 + kTileSize, width_),
+          std::min(y0 + kTileSize, height_)};
+}
+
+namespace tiles {
+
+namespace {
+
+constexpr float kMaxCoord = float(1 << 24);
+
+}  // namespace
+
+Rect PolygonBounds(Polygon const &poly) {
+  auto const &p0 = poly.pos(0);
+  auto const &p1 = poly.pos(1);
+  auto const &p2 = poly.pos(2);
+  auto const minx = std::min({p0.x(), p1.x(), p2.x()});
+  auto const miny = std::min({p0.y(), p1.y(), p2.y()});
+  auto const maxx = std::max({p0.x(), p1.x(), p2.x()});
+  auto const maxy = std::max({p0.y(), p1.y(), p2.y()});
+  // 防止超大坐标转换为 int 时溢出
+  auto const to_int = [](float f) {
+    return int(std::floor(Clamp(-kMaxCoord, kMaxCoord, f)));
+  };
+  // 光栅化时坐标向零取整，因此向外多扩一个像素保证覆盖
+  return {to_int(minx) - 1, to_int(miny) - 1, to_int(maxx) + 2,
+          to_int(maxy) + 2};
+}
+
+}  // namespace tiles
+
+}  // namespace sren
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "polygon.h"
+#include "rect.h"
+
+namespace sren {
+
+// 将屏幕划分为固定大小的块，并记录每个块被哪些多边形覆盖。
+// 块之间互不重叠，因此不同块可以在不同线程中无锁地光栅化。
+class TileBins {
+ public:
+  static constexpr int kTileSize = 64;
+
+  TileBins() = default;
+
+  // 按屏幕大小重新划分块，并清空所有记录
+  void Resize(int width, int height);
+  // 清空所有块的记录，保留划分方式
+  void Clear();
+  // 将多边形加入所有与 bounds 相交的块，同一块内保持加入顺序
+  void Add(Polygon const *poly, Rect const &bounds);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int ntiles() const { return tiles_x_ * tiles_y_; }
+  int tiles_x() const { return tiles_x_; }
+  int tiles_y() const { return tiles_y_; }
+  Rect tile_rect(int i) const;
+  std::vector<Polygon const *> const &bin(int i) const { return bins_[i]; }
+
+ private:
+  int width_{};
+  int height_{};
+  int tiles_x_{};
+  int tiles_y_{};
+  std::vector<std::vector<Polygon const *>> bins_{};
+};
+
+namespace tiles {
+
+// 计算多边形在屏幕上覆盖的像素范围
+Rect PolygonBounds(Polygon const &poly);
+
+}  // namespace tiles
+
+}  // namespace sren
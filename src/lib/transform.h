@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "cache.h"
 #include "matrix.h"
 #include "vector.h"
@@ -14,6 +16,7 @@ class Transform {
     world_pos_ = pos;
     world_matrix_cache_.mark_dirty();
     model_matrix_cache_.mark_dirty();
+    version_ = caches::NextVersion();
   }
 
   Vector3 const &world_pos() const { return world_pos_; }
@@ -22,10 +25,14 @@ class Transform {
     rotation_ = rotation;
     rotate_matrix_cache_.mark_dirty();
     model_matrix_cache_.mark_dirty();
+    version_ = caches::NextVersion();
   }
 
   Vector3 const &rotation() const { return rotation_; }
 
+  // 每次修改位置或旋转后改变，版本相同时各矩阵也相同
+  std::uint64_t version() const { return version_; }
+
   Matrix4x4 const &rotate_matrix() const {
     if (rotate_matrix_cache_.is_dirty()) {
       rotate_matrix_cache_.set_data(matrixs::RotateTransform(rotation_));
@@ -52,6 +59,7 @@ class Transform {
   Vector3 world_pos_{0.0f, 0.0f, 0.0f};
   // 物体在局部坐标系下的旋转角度
   Vector3 rotation_{0.0f, 0.0f, 0.0f};
+  std::uint64_t version_{caches::NextVersion()};
 
   mutable Cache<Matrix4x4> rotate_matrix_cache_{};
   mutable Cache<Matrix4x4> world_matrix_cache_{};
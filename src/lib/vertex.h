@@ -101,4 +101,14 @@ class Vertex {
   Vector4 normal_{};
 };
 
+namespace vertexs {
+
+// 透视修正插值前，将需要修正的属性乘以 z（即 1/w）
+inline void PreInterpFix(Vertex *v) {
+  v->color() *= v->pos().z();
+  v->uv() *= v->pos().z();
+}
+
+}  // namespace vertexs
+
 }  // namespace sren
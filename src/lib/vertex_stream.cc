@@ -0,0 +1,131 @@
+#include "vertex_stream.h"
+
+#include <algorithm>
+
+#include "clip.h"
+
+namespace sren {
+
+void VertexStream::Resize(int n) {
+  size_ = n;
+  auto const padded = (n + kLanes - 1) / kLanes * kLanes;
+  for (auto &c : data_) {
+    c.resize(padded);
+    std::fill(c.begin() + n, c.end(), 0.0f);
+  }
+}
+
+void VertexStream::Assign(std::vector<Vector3> const &vs, float w) {
+  Resize(int(vs.size()));
+  for (int i = 0; i < size_; i++) {
+    data_[0][i] = vs[i].x();
+    data_[1][i] = vs[i].y();
+    data_[2][i] = vs[i].z();
+  }
+  std::fill(data_[3].begin(), data_[3].begin() + size_, w);
+}
+
+void VertexStream::Transform(Matrix4x4 const &m, simd::Isa isa) {
+  TransformTo(m, this, isa);
+}
+
+void VertexStream::TransformTo(Matrix4x4 const &m, VertexStream *out,
+                               simd::Isa isa) const {
+  if (out != this) {
+    out->Resize(size_);
+  }
+  float const *const src[] = {component(0), component(1), component(2),
+                              component(3)};
+  float *const dst[] = {out->component(0), out->component(1),
+                        out->component(2), out->component(3)};
+  // 补齐部分也一起计算，SIMD 不需要处理剩余的顶点
+  simd::Transform4x4(m.data(), src, dst, data_[0].size(), isa);
+}
+
+namespace vertexs {
+
+namespace {
+
+// 每次处理的顶点数，一块中的模型顶点和三组结果都留在 L1 缓存中
+constexpr int kChunk = 128;
+
+struct Components {
+  float const *src[4];
+  float *dst[4];
+};
+
+// 两个顶点流从第 begin 个顶点开始的分量
+Components Offset(VertexStream const &src, VertexStream *dst, int begin) {
+  Components c{};
+  for (int i = 0; i < 4; i++) {
+    c.src[i] = src.component(i) + begin;
+    c.dst[i] = dst->component(i) + begin;
+  }
+  return c;
+}
+
+}  // namespace
+
+void Project(VertexStream const &model, Matrix4x4 const &model_matrix,
+             Matrix4x4 const &mvp, ViewportTransform const &viewport,
+             VertexStream *world, VertexStream *clip, VertexStream *screen,
+             std::vector<unsigned> *codes, simd::Isa isa) {
+  int const n = model.size();
+  for (auto stream : {world, clip, screen}) {
+    if (stream) {
+      stream->Resize(n);
+    }
+  }
+  codes->resize(n);
+  // 最后一块的补齐部分也一起计算，SIMD 不需要处理剩余的顶点，结果不会被使用
+  for (int begin = 0; begin < n; begin += kChunk) {
+    int const end = std::min(begin + kChunk, n);
+    auto const lanes =
+        std::size_t((end - begin + VertexStream::kLanes - 1) /
+                     VertexStream::kLanes * VertexStream::kLanes);
+    if (world) {
+      auto const c = Offset(model, world, begin);
+      simd::Transform4x4(model_matrix.data(), c.src, c.dst, lanes, isa);
+    }
+    auto const c = Offset(model, clip, begin);
+    simd::Transform4x4(mvp.data(), c.src, c.dst, lanes, isa);
+    auto const p = Offset(*clip, screen, begin);
+    simd::Project(p.src, p.dst, lanes, viewport.scale.data(),
+                  viewport.offset.data(), isa);
+    auto const x = clip->component(0);
+    auto const y = clip->component(1);
+    auto const z = clip->component(2);
+    auto const w = clip->component(3);
+    auto const out = codes->data();
+    for (int i = begin; i < end; i++) {
+      out[i] = clips::Outcode(x[i], y[i], z[i], w[i]);
+    }
+    for (int i = begin; i < end; i++) {
+      if (out[i] & kClipNear) {
+        screen->Set(i, (*clip)[i]);
+      }
+    }
+  }
+}
+
+void Assemble(std::vector<FaceDataIndex> const &indexs,
+              VertexStream const &screen, VertexStream const &world,
+              VertexStream const &normals, Model const &model,
+              std::vector<Vertex> *out) {
+  out->resize(indexs.size());
+  auto const &colors = model.colors();
+  auto const &uvs = model.uvs();
+  for (std::size_t i = 0; i < indexs.size(); i++) {
+    auto const &index = indexs[i];
+    auto &v = (*out)[i];
+    v.pos() = screen[index.vertex];
+    v.world_pos() = world[index.vertex];
+    v.color() = colors[index.vertex];
+    v.uv() = uvs[index.uv];
+    v.normal() = normals[index.normal];
+  }
+}
+
+}  // namespace vertexs
+
+}  // namespace sren
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "matrix.h"
+#include "model.h"
+#include "simd.h"
+#include "vector.h"
+#include "vertex.h"
+
+namespace sren {
+
+// 按分量分开存放的四维顶点数组（SoA）。x、y、z、w 各自连续存放，
+// 按缓存行对齐并补齐到 kLanes 的整数倍，SIMD 每次可以整块处理多个顶点
+class VertexStream {
+ public:
+  // 补齐的倍数，即 AVX 一次处理的顶点数
+  static constexpr int kLanes = 8;
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // 改变顶点数，补齐部分的分量为 0
+  void Resize(int n);
+  // 复制三维顶点，w 取 w
+  void Assign(std::vector<Vector3> const &vs, float w);
+
+  Vector4 operator[](int i) const {
+    return {data_[0][i], data_[1][i], data_[2][i], data_[3][i]};
+  }
+  void Set(int i, Vector4 const &v) {
+    for (int c = 0; c < 4; c++) {
+      data_[c][i] = v[c];
+    }
+  }
+
+  // 第 c 个分量的数组，0 到 3 依次为 x、y、z、w
+  float *component(int c) { return data_[c].data(); }
+  float const *component(int c) const { return data_[c].data(); }
+
+  // 每个顶点右乘 m，即 v = v * m
+  void Transform(Matrix4x4 const &m, simd::Isa isa = simd::DetectIsa());
+  // 将变换结果写入 out，out 的大小会被设为与自身相同
+  void TransformTo(Matrix4x4 const &m, VertexStream *out,
+                   simd::Isa isa = simd::DetectIsa()) const;
+
+ private:
+  using Floats = std::vector<float, simd::AlignedAllocator<float>>;
+
+  int size_{};
+  std::array<Floats, 4> data_{};
+};
+
+// 透视除法后的视口变换，分量 c 为 v[c] / w * scale[c] + offset[c]，w 变为 1。
+// x、y 映射为视口中的像素坐标，z 映射为深度 near / w
+struct ViewportTransform {
+  std::array<float, 3> scale{};
+  std::array<float, 3> offset{};
+
+  // 运算顺序与 simd::Project 相同，裁剪生成的顶点与批量处理的顶点结果一致
+  Vector4 Apply(Vector4 const &clip) const {
+    float const rhw = 1.0f / clip.w();
+    Vector4 v{};
+    for (int c = 0; c < 3; c++) {
+      v[c] = clip[c] * rhw * scale[c] + offset[c];
+    }
+    v[3] = 1.0f;
+    return v;
+  }
+
+  bool operator==(ViewportTransform const &rhs) const {
+    return scale == rhs.scale && offset == rhs.offset;
+  }
+  bool operator!=(ViewportTransform const &rhs) const {
+    return !(*this == rhs);
+  }
+};
+
+namespace vertexs {
+
+// 单遍处理模型空间中 w 为 1 的顶点 model，每个顶点只读一次：
+// 用 mvp 求出裁剪空间坐标 clip 和裁剪标记 codes，透视除法并做视口变换后写入
+// screen，world 不为空时同时用 model_matrix 求出世界坐标。
+// 近平面之后的顶点不做透视除法，screen 中保留其裁剪空间坐标
+void Project(VertexStream const &model, Matrix4x4 const &model_matrix,
+             Matrix4x4 const &mvp, ViewportTransform const &viewport,
+             VertexStream *world, VertexStream *clip, VertexStream *screen,
+             std::vector<unsigned> *codes, simd::Isa isa = simd::DetectIsa());
+
+// 按 indexs 中的每组下标组装完整的顶点写入 out：位置取 screen，
+// 世界坐标和颜色按顶点下标，纹理坐标和法线按各自的下标读取
+void Assemble(std::vector<FaceDataIndex> const &indexs,
+              VertexStream const &screen, VertexStream const &world,
+              VertexStream const &normals, Model const &model,
+              std::vector<Vertex> *out);
+
+}  // namespace vertexs
+
+}  // namespace sren
@@ -5,7 +5,9 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <iostream>
 
 #include "frame_buffer.h"
@@ -85,11 +87,69 @@ Window::Window(std::string const& title, int width, int height)
   ImGui_ImplGlfw_InitForOpenGL(glfw_window_, true);
   ImGui_ImplOpenGL3_Init(glsl_version);
 
-  frame_buffer_.Resize(width_, height_);
+  // 光栅化时直接按纹理从上到下的顺序写入行，上传前无需翻转
+  pipeline_.Resize(width_, height_, YOrigin::kTop);
 }
 
 Window::~Window() { glfwTerminate(); }
 
+void Window::set_render_func(FramePipeline::RenderFunc func) {
+  pipeline_.Sync();
+  has_render_func_ = bool(func);
+  pipeline_.set_render_func(std::move(func));
+}
+
+void Window::Upload(FrameBuffer *fb) {
+  // 帧缓冲的行已是呈现顺序，只需补齐未写入的块后直接上传。
+  // 纹理只在大小变化时重新分配，之后每帧复用
+  fb->set_y_origin(YOrigin::kTop);
+  fb->Resolve();
+  glBindTexture(GL_TEXTURE_2D, image_texture_);
+#if defined(GL_UNPACK_ROW_LENGTH) && !defined(__EMSCRIPTEN__)
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, fb->stride());
+  bool const row_length = true;
+#else
+  bool const row_length = false;
+#endif
+  // 纹理中正是前一帧时只上传改变的区域
+  bool partial = fb->damage_frame() != 0 &&
+                 fb->damage_frame() == uploaded_frame_ + 1;
+  if (texture_width_ != fb->width() || texture_height_ != fb->height()) {
+    texture_width_ = fb->width();
+    texture_height_ = fb->height();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture_width_, texture_height_, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    partial = false;
+  }
+  uploaded_frame_ = fb->damage_frame();
+  if (!partial) {
+    UploadRect(*fb, fb->bounds(), row_length);
+    return;
+  }
+  for (auto const &r : fb->damage()) {
+    UploadRect(*fb, r, row_length);
+  }
+}
+
+void Window::UploadRect(FrameBuffer const &fb, Rect const &r,
+                        bool row_length) {
+  // 纹理的第一行是帧缓冲的最上一行，矩形的最上一行为 y1 - 1，
+  // 内存中之后的各行依次向下
+  void const *pixels = fb.color_row(r.y1 - 1) + r.x0;
+  // 行末按缓存行补齐，行距与宽度不同时按紧密排列读取会使图像错位
+  if (!row_length && fb.stride() != r.width()) {
+    int const w = r.width();
+    upload_buffer_.resize(std::size_t(w) * r.height());
+    for (int i = 0; i < r.height(); i++) {
+      auto const row = fb.color_row(r.y1 - 1 - i) + r.x0;
+      std::copy(row, row + w, upload_buffer_.data() + std::size_t(i) * w);
+    }
+    pixels = upload_buffer_.data();
+  }
+  glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, texture_height_ - r.y1, r.width(),
+                  r.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
 std::chrono::time_point<std::chrono::system_clock> Window::now() {
   return std::chrono::system_clock::now();
 }
@@ -121,19 +181,22 @@ void Window::Run() {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // 渲染线程完成已提交的帧后才运行主循环，主循环中可以安全地修改场景
+    pipeline_.Sync();
     if (main_loop_) {
       main_loop_(this);
     }
 
-    frame_buffer_.FlipVertically();
-
-    // Upload pixels into texture
-#if defined(GL_UNPACK_ROW_LENGTH) && !defined(__EMSCRIPTEN__)
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-#endif
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame_buffer_.width(),
-                 frame_buffer_.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                 frame_buffer_.data());
+    // 提交第 N + 1 帧后呈现第 N 帧，渲染线程绘制的同时主线程上传和交换缓冲
+    if (has_render_func_) {
+      pipeline_.Submit();
+      if (auto const fb = pipeline_.Acquire()) {
+        Upload(fb);
+        pipeline_.Release(fb);
+      }
+    } else {
+      Upload(&frame_buffer());
+    }
 
     {
       ImGui::SetNextWindowPos(ImVec2(0, 0));
@@ -142,7 +205,7 @@ void Window::Run() {
           ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBringToFrontOnFocus;
       ImGui::Begin("Render Result", nullptr, win_flags);
       ImGui::Image((void*)(intptr_t)image_texture_,
-                   ImVec2(frame_buffer_.width(), frame_buffer_.height()));
+                   ImVec2(texture_width_, texture_height_));
       ImGui::End();
     }
 
@@ -154,6 +217,7 @@ void Window::Run() {
     // 清理按键记录
     details::ClearKeyState();
   }
+  pipeline_.Sync();
 }
 
 }  // namespace sren
@@ -6,10 +6,13 @@
 #include <GLFW/glfw3.h>
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "frame_buffer.h"
+#include "frame_pipeline.h"
 
 namespace sren {
 
@@ -25,23 +28,44 @@ class Window {
   void Run();
   void Close();
 
+  // 主循环在主线程中运行，处理界面和输入
   void set_main_loop(LoopFunc func) { main_loop_ = std::move(func); }
-  FrameBuffer &frame_buffer() { return frame_buffer_; }
-  FrameBuffer const &frame_buffer() const { return frame_buffer_; }
+  // 设置后每帧由渲染函数绘制，可按 frame_latency 与呈现并行；
+  // 未设置时主循环直接绘制到 frame_buffer 中
+  void set_render_func(FramePipeline::RenderFunc func);
+  FrameBuffer &frame_buffer() { return pipeline_.buffer(0); }
+
+  // 同时在途的帧数，1 为串行，2 为双缓冲，3 为三缓冲
+  int frame_latency() const { return pipeline_.latency(); }
+  void set_frame_latency(int latency) { pipeline_.set_latency(latency); }
+  FramePipelineStats const &pipeline_stats() const { return pipeline_.stats(); }
   float delta_time() const { return delta_time_; }
   TimePoint last_update_time() { return last_update_time_; };
   TimePoint current_time() { return current_time_; };
 
  private:
   static std::chrono::time_point<std::chrono::system_clock> now();
+  // 将帧缓冲上传到显示用的纹理
+  void Upload(FrameBuffer *fb);
+  // 将帧缓冲中 r 范围内的像素上传到纹理的相同位置，
+  // row_length 为 false 时 OpenGL 按紧密排列读取，需要先复制到连续的缓冲中
+  void UploadRect(FrameBuffer const &fb, Rect const &r, bool row_length);
 
   int width_{};
   int height_{};
   GLFWwindow *glfw_window_{};
   LoopFunc main_loop_{};
-  FrameBuffer frame_buffer_{};
+  FramePipeline pipeline_{};
+  bool has_render_func_{};
   float delta_time_{};
   GLuint image_texture_{};
+  // 纹理当前分配的大小
+  int texture_width_{};
+  int texture_height_{};
+  // 纹理中最后一次上传的帧号，见 FrameBuffer::damage_frame
+  std::uint64_t uploaded_frame_{};
+  // 不支持 GL_UNPACK_ROW_LENGTH 时，按紧密排列复制待上传的像素
+  std::vector<std::uint32_t> upload_buffer_{};
   std::chrono::time_point<std::chrono::system_clock> current_time_{};
   std::chrono::time_point<std::chrono::system_clock> last_update_time_{};
 };
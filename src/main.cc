@@ -9,8 +9,11 @@
 #include "lib/camera.h"
 #include "lib/color.h"
 #include "lib/data2d.h"
+#include "lib/depth.h"
 #include "lib/draw.h"
 #include "lib/frame_buffer.h"
+#include "lib/frame_pipeline.h"
+#include "lib/hi_z.h"
 #include "lib/image.h"
 #include "lib/key.h"
 #include "lib/light.h"
@@ -22,6 +25,7 @@
 #include "lib/quaternion.h"
 #include "lib/render_style.h"
 #include "lib/scene.h"
+#include "lib/thread_pool.h"
 #include "lib/vector.h"
 #include "lib/window.h"
 
@@ -41,6 +45,22 @@ LightCoefficient const kCoefficient = {
 
 bool gRenderSolid = true;
 bool gRenderTranslucency = false;
+bool gRenderTiled = true;
+bool gHalfSpace = false;
+bool gHiZ = true;
+bool gDeferred = false;
+bool gLazyClear = true;
+int gDepthFormat = int(DepthFormat::kFloat32);
+bool gMsaa = false;
+bool gIncremental = false;
+bool gThumbnail = false;
+int64_t gRedrawnPixels = 0;
+uint64_t gClearedBytes = 0;
+int gFrameLatency = 2;
+FramePipelineStats gPipelineStats{};
+HiZStats gHiZStats{};
+ClipStats gClipStats{};
+int gRenderThreads = 1;
 
 struct ModelInfo {
   std::string name;
@@ -142,6 +162,47 @@ void RenderGUI() {
   ImGui::Checkbox("Render Solid", &gRenderSolid);
   ImGui::SameLine();
   ImGui::Checkbox("Render Translucency", &gRenderTranslucency);
+  ImGui::Checkbox("Tiled", &gRenderTiled);
+  ImGui::SameLine();
+  ImGui::Checkbox("Half-Space", &gHalfSpace);
+  ImGui::SameLine();
+  ImGui::SliderInt("Threads", &gRenderThreads, 1,
+                   ThreadPool::HardwareThreads());
+  ImGui::Checkbox("Deferred", &gDeferred);
+  ImGui::SameLine();
+  ImGui::Checkbox("Hi-Z", &gHiZ);
+  ImGui::SameLine();
+  ImGui::Text("skipped %llu tris, %llu blocks, %llu spans, %llu frags",
+              (unsigned long long)gHiZStats.triangles,
+              (unsigned long long)gHiZStats.blocks,
+              (unsigned long long)gHiZStats.spans,
+              (unsigned long long)gHiZStats.fragments);
+  ImGui::Checkbox("Lazy Clear", &gLazyClear);
+  ImGui::SameLine();
+  ImGui::Text("cleared %.1f KB before present", gClearedBytes / 1024.0);
+  ImGui::Checkbox("Incremental", &gIncremental);
+  ImGui::SameLine();
+  ImGui::Text("redrawn %lld pixels", (long long)gRedrawnPixels);
+  ImGui::SameLine();
+  ImGui::Checkbox("Side View", &gThumbnail);
+  ImGui::Text("Depth");
+  for (int i = 0; i < kDepthFormatCount; i++) {
+    ImGui::SameLine();
+    ImGui::RadioButton(depths::FormatName(DepthFormat(i)), &gDepthFormat, i);
+  }
+  ImGui::SameLine();
+  ImGui::Checkbox("MSAA 4x", &gMsaa);
+  ImGui::SliderInt("Frame Latency", &gFrameLatency, 1,
+                   FramePipeline::kMaxLatency);
+  ImGui::Text("render %.2f ms, present %.2f ms, frame %.2f ms, overlap x%.2f",
+              gPipelineStats.render_ms, gPipelineStats.present_ms,
+              gPipelineStats.frame_ms, gPipelineStats.overlap());
+  ImGui::Text(
+      "culled %d objects, %d polygons; clipped %d -> %d polygons; "
+      "backface %d polygons; reused %d objects",
+      gClipStats.objects_culled, gClipStats.polygons_culled,
+      gClipStats.polygons_clipped, gClipStats.polygons_emitted,
+      gClipStats.polygons_backface, gClipStats.objects_reused);
   ImGui::Text("Solid Model");
   for (int i = 0; i < kModelInfos.size(); i++) {
     ImGui::SameLine();
@@ -219,10 +280,42 @@ int main(void) {
   alpha_obj->transform().set_world_pos(kObjectPos1);
   alpha_obj->set_render_style(kRenderColor);
 
+  // 右上角的小视口从侧面观察场景，与主视图在同一帧缓冲中渲染
+  std::vector<View> views(2);
+  views[1].viewport = {kWidth * 3 / 4 - 8, kHeight * 3 / 4 - 8, kWidth - 8,
+                       kHeight - 8};
+  views[1].camera.SetLookAt({2, 0, 0}, kObjectPos);
+  views[1].camera.SetPerspective(Radian(90.0f), kAspect);
+
+  gRenderThreads = ThreadPool::HardwareThreads();
+  // 主循环运行时渲染线程空闲，可以修改场景和读取上一帧的统计
   window.set_main_loop([&](Window *window) {
+    gPipelineStats = window->pipeline_stats();
     RenderGUI();
     HandleKey(window, &scene);
-    scene.Render(&window->frame_buffer());
+    scene.set_tiled(gRenderTiled);
+    scene.set_rasterizer(gHalfSpace ? Rasterizer::kHalfSpace
+                                    : Rasterizer::kTrapezoid);
+    scene.set_nthreads(gRenderThreads);
+    scene.set_hi_z(gHiZ);
+    scene.set_shading(gDeferred ? Shading::kDeferred : Shading::kForward);
+    scene.set_incremental(gIncremental);
+    window->set_frame_latency(gFrameLatency);
+  });
+  window.set_render_func([&](FrameBuffer *fb) {
+    fb->set_lazy_clear(gLazyClear);
+    fb->set_depth_format(DepthFormat(gDepthFormat));
+    fb->set_samples(gMsaa ? FrameBuffer::kMaxSamples : 1);
+    if (gThumbnail) {
+      views[0].camera = scene.camera();
+      scene.RenderViews(fb, views);
+    } else {
+      scene.Render(fb);
+    }
+    gHiZStats = fb->hi_z().stats();
+    gClearedBytes = fb->ClearedBytes();
+    gClipStats = scene.clip_stats();
+    gRedrawnPixels = rects::Area(scene.redrawn());
   });
   window.Run();
   return 0;
@@ -0,0 +1,42 @@
+#include "lib/clip.h"
+
+#include "test.h"
+
+using namespace sren;
+
+TEST(ClipTest, Outcode_InsideAndOutside) {
+  ASSERT_EQ(0u, clips::Outcode({0, 0, 0.5f, 1}));
+  ASSERT_EQ(unsigned(kClipLeft), clips::Outcode({-2, 0, 0.5f, 1}));
+  ASSERT_EQ(unsigned(kClipTop | kClipGuardTop),
+            clips::Outcode({0, 5, 0.5f, 1}));
+  ASSERT_TRUE(clips::Outcode({0, 0, -0.1f, 1}) & kClipNear);
+  ASSERT_TRUE(clips::Outcode({0, 0, 2, 1}) & kClipFar);
+}
+
+TEST(ClipTest, ClipTriangle_NearPlane_SplitsIntoQuad) {
+  std::array<Vertex, 3> const in{Vertex({0, 0, 1, 2}), Vertex({1, 0, 1, 2}),
+                                 Vertex({0, 1, -1, 0.5f})};
+  std::array<Vertex, clips::kMaxVertexs> out{};
+  int const n = clips::ClipTriangle(in, kClipNear, &out);
+  ASSERT_EQ(4, n);
+  for (int i = 0; i < n; i++) {
+    ASSERT_GE(out[i].pos().z(), 0.0f);
+    ASSERT_GT(out[i].pos().w(), 0.0f);
+  }
+}
+
+TEST(ClipTest, ClipTriangle_AllOutside_Empty) {
+  std::array<Vertex, 3> const in{Vertex({0, 0, -1, 1}), Vertex({1, 0, -1, 1}),
+                                 Vertex({0, 1, -1, 1})};
+  std::array<Vertex, clips::kMaxVertexs> out{};
+  ASSERT_LT(clips::ClipTriangle(in, kClipNear, &out), 3);
+}
+
+TEST(ClipTest, BoxOutside_BehindCamera) {
+  Matrix4x4 identity{};
+  identity.SetIdentity();
+  ASSERT_FALSE(clips::BoxOutside({-0.5f, -0.5f, 0.1f}, {0.5f, 0.5f, 0.5f},
+                                 identity));
+  ASSERT_TRUE(clips::BoxOutside({-0.5f, -0.5f, -2}, {0.5f, 0.5f, -1},
+                                identity));
+}
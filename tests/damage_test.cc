@@ -0,0 +1,72 @@
+#include "lib/damage.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "test.h"
+
+using namespace sren;
+
+TEST(RectsTest, Add_MergesIntersectingRects) {
+  std::vector<Rect> rs{};
+  rects::Add({0, 0, 10, 10}, 8, &rs);
+  rects::Add({5, 5, 15, 15}, 8, &rs);
+  ASSERT_EQ((std::vector<Rect>{{0, 0, 15, 15}}), rs);
+  rects::Add({20, 20, 30, 30}, 8, &rs);
+  rects::Add({}, 8, &rs);
+  ASSERT_EQ(2u, rs.size());
+  ASSERT_EQ(15 * 15 + 10 * 10, rects::Area(rs));
+  // 合并后的矩形与另一个矩形相交时继续合并
+  rects::Add({14, 14, 21, 21}, 8, &rs);
+  ASSERT_EQ((std::vector<Rect>{{0, 0, 30, 30}}), rs);
+}
+
+TEST(RectsTest, Add_MergesCheapestPairOverMax) {
+  std::vector<Rect> rs{};
+  rects::Add({0, 0, 2, 2}, 2, &rs);
+  rects::Add({100, 100, 102, 102}, 2, &rs);
+  rects::Add({3, 0, 5, 2}, 2, &rs);
+  ASSERT_EQ(2u, rs.size());
+  ASSERT_NE(rs.end(), std::find(rs.begin(), rs.end(), Rect(0, 0, 5, 2)));
+  ASSERT_NE(rs.end(),
+            std::find(rs.begin(), rs.end(), Rect(100, 100, 102, 102)));
+}
+
+TEST(DamageTrackerTest, Collect_UnionsFramesSinceLastRender) {
+  FrameBuffer a(64, 64);
+  FrameBuffer b(64, 64);
+  DamageTracker tracker{};
+  std::vector<Rect> rs{};
+
+  tracker.BeginFrame(true);
+  ASSERT_FALSE(tracker.Collect(a, &rs));
+  tracker.MarkRendered(a);
+
+  tracker.BeginFrame(false);
+  tracker.Add({0, 0, 4, 4});
+  ASSERT_TRUE(tracker.Collect(a, &rs));
+  ASSERT_EQ((std::vector<Rect>{{0, 0, 4, 4}}), rs);
+  tracker.MarkRendered(a);
+  // 从未渲染过的帧缓冲需要整帧重绘
+  ASSERT_FALSE(tracker.Collect(b, &rs));
+  tracker.MarkRendered(b);
+
+  tracker.BeginFrame(false);
+  tracker.Add({10, 10, 12, 12});
+  tracker.BeginFrame(false);
+  tracker.Add({20, 20, 22, 22});
+  ASSERT_EQ((std::vector<Rect>{{20, 20, 22, 22}}), tracker.rects());
+  // a 停留在第 2 帧，需要重绘第 3、4 帧改变的区域
+  ASSERT_TRUE(tracker.Collect(a, &rs));
+  ASSERT_EQ((std::vector<Rect>{{10, 10, 12, 12}, {20, 20, 22, 22}}), rs);
+
+  // 被清除过的帧缓冲不再保留之前的内容
+  a.Clear();
+  ASSERT_FALSE(tracker.Collect(a, &rs));
+
+  // 上次渲染的帧已不在记录中
+  for (int i = 0; i < DamageTracker::kHistory; i++) {
+    tracker.BeginFrame(false);
+  }
+  ASSERT_FALSE(tracker.Collect(b, &rs));
+}
@@ -0,0 +1,169 @@
+#include "lib/edge_function.h"
+
+#include <array>
+
+#include "test.h"
+
+using namespace sren;
+
+namespace {
+
+std::array<Vertex, 3> MakeTriangle(Vector4 const &p0, Vector4 const &p1,
+                                   Vector4 const &p2) {
+  return {Vertex(p0), Vertex(p1), Vertex(p2)};
+}
+
+}  // namespace
+
+TEST(EdgeFunctionTest, SetupTriangle_InsideIsPositiveForBothWindings) {
+  auto const p0 = Vector4(0, 0, 1, 1);
+  auto const p1 = Vector4(16, 0, 1, 1);
+  auto const p2 = Vector4(0, 16, 1, 1);
+  for (auto const &verts :
+       {MakeTriangle(p0, p1, p2), MakeTriangle(p0, p2, p1)}) {
+    TriangleSetup setup{};
+    ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 100, 100}, &setup));
+    bool outside = false;
+    for (auto const &e : setup.edges) {
+      ASSERT_GT(e.AtPixel(4, 4), 0);
+      outside = outside || e.AtPixel(20, 20) < 0;
+    }
+    ASSERT_TRUE(outside);
+  }
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_BoundsAreClippedPixelCenters) {
+  auto const verts = MakeTriangle(Vector4(0.2f, 1.6f, 1, 1),
+                                  Vector4(9.4f, 1.6f, 1, 1),
+                                  Vector4(0.2f, 30.0f, 1, 1));
+  TriangleSetup setup{};
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 20, 20}, &setup));
+  ASSERT_EQ(setup.bounds, Rect(0, 2, 9, 20));
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_SharedEdgesCoverEachPixelOnce) {
+  // 以像素中心 (8.5, 8.5) 为中心的扇形，共享边上的像素中心都落在边上，
+  // 包含水平、竖直和斜边，相邻三角形的绕向也不相同
+  auto const center = Vector4(8.5f, 8.5f, 1, 1);
+  std::array<Vector4, 8> const ring = {
+      Vector4(0, 0, 1, 1),     Vector4(8.5f, 0, 1, 1),
+      Vector4(17, 0, 1, 1),    Vector4(17, 8.5f, 1, 1),
+      Vector4(17, 17, 1, 1),   Vector4(8.5f, 17, 1, 1),
+      Vector4(0, 17, 1, 1),    Vector4(0, 8.5f, 1, 1)};
+  std::array<std::array<int, 17>, 17> count{};
+  for (int i = 0; i < 8; i++) {
+    auto const &p1 = ring[i];
+    auto const &p2 = ring[(i + 1) % 8];
+    auto const verts = i % 2 == 0 ? MakeTriangle(center, p1, p2)
+                                  : MakeTriangle(center, p2, p1);
+    TriangleSetup setup{};
+    ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 17, 17}, &setup));
+    for (int y = setup.bounds.y0; y < setup.bounds.y1; y++) {
+      for (int x = setup.bounds.x0; x < setup.bounds.x1; x++) {
+        bool inside = true;
+        for (auto const &e : setup.edges) {
+          inside = inside && e.AtPixel(x, y) >= 0;
+        }
+        count[y][x] += inside ? 1 : 0;
+      }
+    }
+  }
+  for (int y = 0; y < 17; y++) {
+    for (int x = 0; x < 17; x++) {
+      ASSERT_EQ(count[y][x], 1) << x << ", " << y;
+    }
+  }
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_DegenerateTriangleIsRejected) {
+  auto const verts = MakeTriangle(Vector4(0, 0, 1, 1), Vector4(5, 5, 1, 1),
+                                  Vector4(10, 10, 1, 1));
+  TriangleSetup setup{};
+  ASSERT_FALSE(edges::SetupTriangle(verts, {0, 0, 100, 100}, &setup));
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_AttributePlanesMatchVertexes) {
+  std::array<Vertex, 3> verts{};
+  verts[0].pos() = Vector4(0.5f, 0.5f, 1, 1);
+  verts[1].pos() = Vector4(8.5f, 0.5f, 1, 1);
+  verts[2].pos() = Vector4(0.5f, 8.5f, 1, 1);
+  verts[0].normal() = Vector4(0, 0, 0, 0);
+  verts[1].normal() = Vector4(8, 0, 0, 0);
+  verts[2].normal() = Vector4(0, 4, 0, 0);
+  TriangleSetup setup{};
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 100, 100}, &setup));
+  ASSERT_TRUE(setup.At(0, 0).normal().AlmostEqual(verts[0].normal(), 1e-5f));
+  ASSERT_TRUE(setup.At(8, 0).normal().AlmostEqual(verts[1].normal(), 1e-5f));
+  ASSERT_TRUE(setup.At(0, 8).normal().AlmostEqual(verts[2].normal(), 1e-5f));
+  ASSERT_TRUE(setup.dx.normal().AlmostEqual(Vector4(1, 0, 0, 0), 1e-5f));
+  ASSERT_TRUE(setup.dy.normal().AlmostEqual(Vector4(0, 0.5f, 0, 0), 1e-5f));
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_AttributesDoNotDependOnClip) {
+  std::array<Vertex, 3> verts{};
+  verts[0].pos() = Vector4(0.3f, 0.7f, 0.1f, 1);
+  verts[1].pos() = Vector4(50.2f, 3.1f, 0.7f, 1);
+  verts[2].pos() = Vector4(7.9f, 41.3f, 0.3f, 1);
+  TriangleSetup whole{};
+  TriangleSetup tile{};
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 64, 64}, &whole));
+  ASSERT_TRUE(edges::SetupTriangle(verts, {16, 16, 32, 32}, &tile));
+  ASSERT_EQ(whole.At(20, 20).pos().z(), tile.At(20, 20).pos().z());
+}
+
+TEST(EdgeFunctionTest, ClassifyBlock_DetectsNoneFullAndPartial) {
+  auto const verts = MakeTriangle(Vector4(0, 0, 1, 1), Vector4(64, 0, 1, 1),
+                                  Vector4(0, 64, 1, 1));
+  TriangleSetup setup{};
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 100, 100}, &setup));
+  ASSERT_EQ(edges::ClassifyBlock(setup, {0, 0, 8, 8}), BlockCoverage::kFull);
+  ASSERT_EQ(edges::ClassifyBlock(setup, {28, 28, 36, 36}),
+            BlockCoverage::kPartial);
+  ASSERT_EQ(edges::ClassifyBlock(setup, {56, 56, 64, 64}),
+            BlockCoverage::kNone);
+}
+
+TEST(EdgeFunctionTest, SampleCoverage_SharedEdgesCoverEachSampleOnce) {
+  // 与像素中心的测试相同的扇形，按多重采样点计算的遍历范围也要包含所有被覆盖的采样点
+  auto const center = Vector4(8.5f, 8.5f, 1, 1);
+  std::array<Vector4, 4> const ring = {
+      Vector4(0, 0, 1, 1), Vector4(17, 0, 1, 1), Vector4(17, 17, 1, 1),
+      Vector4(0, 17, 1, 1)};
+  std::array<std::array<std::array<int, edges::kMsaaSamples>, 17>, 17>
+      count{};
+  for (int i = 0; i < 4; i++) {
+    auto const verts = MakeTriangle(center, ring[i], ring[(i + 1) % 4]);
+    TriangleSetup setup{};
+    ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 17, 17}, &setup,
+                                     edges::kMsaaSamples));
+    for (int y = setup.bounds.y0; y < setup.bounds.y1; y++) {
+      for (int x = setup.bounds.x0; x < setup.bounds.x1; x++) {
+        auto const mask = edges::SampleCoverage(setup, x, y);
+        for (int s = 0; s < edges::kMsaaSamples; s++) {
+          count[y][x][s] += (mask >> s) & 1;
+        }
+      }
+    }
+  }
+  for (int y = 0; y < 17; y++) {
+    for (int x = 0; x < 17; x++) {
+      for (int s = 0; s < edges::kMsaaSamples; s++) {
+        ASSERT_EQ(count[y][x][s], 1) << x << ", " << y << ", " << s;
+      }
+    }
+  }
+}
+
+TEST(EdgeFunctionTest, SetupTriangle_MultisampleBoundsIncludeEdgePixels) {
+  // 像素 (2, 0) 的中心在三角形外，但左侧的采样点在三角形内
+  auto const verts = MakeTriangle(Vector4(0, 0, 1, 1), Vector4(2.45f, 0, 1, 1),
+                                  Vector4(0, 8, 1, 1));
+  TriangleSetup setup{};
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 8, 8}, &setup));
+  ASSERT_EQ(setup.bounds.x1, 2);
+  ASSERT_TRUE(edges::SetupTriangle(verts, {0, 0, 8, 8}, &setup,
+                                   edges::kMsaaSamples));
+  ASSERT_EQ(setup.bounds.x1, 3);
+  ASSERT_NE(edges::SampleCoverage(setup, 2, 0), 0u);
+  ASSERT_NE(edges::SampleCoverage(setup, 2, 0), edges::kAllSamples);
+}
@@ -0,0 +1,238 @@
+#include "lib/frame_buffer.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "lib/draw.h"
+#include "test.h"
+
+using namespace sren;
+
+TEST(FrameBufferTest, SetScissor_ClampedToBounds) {
+  FrameBuffer fb(16, 8);
+  ASSERT_EQ(Rect(0, 0, 16, 8), fb.scissor());
+  fb.set_scissor({-4, 2, 10, 20});
+  ASSERT_EQ(Rect(0, 2, 10, 8), fb.scissor());
+  fb.Resize(32, 32);
+  ASSERT_EQ(Rect(0, 0, 32, 32), fb.scissor());
+}
+
+TEST(FrameBufferTest, Line_OnlyInsideScissor) {
+  FrameBuffer fb(16, 8);
+  fb.set_scissor({4, 0, 8, 8});
+  draw::Line({-100, 3, 0, 1}, {100, 3, 0, 1}, colors::White(), &fb);
+  for (int x = 0; x < fb.width(); x++) {
+    auto const expect = x >= 4 && x < 8 ? colors::White() : Color{};
+    ASSERT_EQ(expect, fb.Get(x, 3)) << "x = " << x;
+  }
+}
+
+TEST(FrameBufferTest, Set_LastRowInBoundOnly) {
+  FrameBuffer fb(4, 4);
+  fb.Set(1, 3, colors::White());
+  ASSERT_EQ(colors::White(), fb.Get(1, 3));
+  ASSERT_EQ(Color{}, fb.Get(1, 4));
+}
+
+TEST(FrameBufferTest, Resize_RowsAreCacheLineAligned) {
+  FrameBuffer fb(13, 5);
+  ASSERT_GE(fb.stride(), fb.width());
+  for (int y = 0; y < fb.height(); y++) {
+    auto const addr = reinterpret_cast<std::uintptr_t>(fb.color_row(y));
+    ASSERT_EQ(0u, addr % simd::kCacheLine) << "y = " << y;
+  }
+}
+
+TEST(FrameBufferTest, BlendPacked_MatchesColorBlend) {
+  for (int a = 0; a <= 255; a += 15) {
+    for (int c = 0; c <= 255; c += 51) {
+      auto const src = Color::RGBA(c, 255 - c, c / 2, a);
+      auto const dst = Color::RGBA(255 - c, c, 200, 255);
+      auto const expect = FrameBuffer::UnpackColor(FrameBuffer::PackColor(
+          src.Blend(dst).Fix()));
+      auto const actual = FrameBuffer::UnpackColor(FrameBuffer::BlendPacked(
+          FrameBuffer::PackColor(src), FrameBuffer::PackColor(dst)));
+      for (int i = 0; i < 4; i++) {
+        ASSERT_NEAR(expect[i], actual[i], 1.0f / 255 + 1e-5f)
+            << "a = " << a << ", c = " << c << ", i = " << i;
+      }
+    }
+  }
+}
+
+TEST(FrameBufferTest, FillRow_ClampedToBounds) {
+  FrameBuffer fb(16, 4);
+  fb.FillRow(2, -3, 5, colors::White());
+  for (int x = 0; x < 16; x++) {
+    auto const expect = x <= 5 ? colors::White() : Color{};
+    ASSERT_EQ(expect, fb.Get(x, 2)) << "x = " << x;
+  }
+  ASSERT_EQ(Color{}, fb.Get(0, 1));
+  fb.Clear();
+  ASSERT_EQ(Color{}, fb.Get(0, 2));
+}
+
+TEST(FrameBufferTest, Clear_LazyTilesClearedOnFirstTouch) {
+  FrameBuffer fb(130, 70);
+  auto const background = Color::RGB(0x20, 0x40, 0x60);
+  fb.Clear(background);
+  ASSERT_EQ(0u, fb.ClearedBytes());
+  ASSERT_EQ(background, fb.Get(100, 50));
+
+  fb.Set(70, 10, colors::White());
+  ASSERT_TRUE(fb.TileCleared(1, 0));
+  ASSERT_FALSE(fb.TileCleared(0, 0));
+  ASSERT_EQ(64u * 64 * 8, fb.ClearedBytes());
+  ASSERT_EQ(colors::White(), fb.Get(70, 10));
+  ASSERT_EQ(FrameBuffer::PackColor(background), fb.color_row(20)[100]);
+
+  fb.Resolve();
+  ASSERT_EQ(130u * 70 * 8, fb.ClearedBytes());
+  for (int y = 0; y < fb.height(); y++) {
+    for (int x = 0; x < fb.width(); x++) {
+      auto const expect = x == 70 && y == 10 ? colors::White() : background;
+      ASSERT_EQ(FrameBuffer::PackColor(expect), fb.color_row(y)[x])
+          << x << ", " << y;
+    }
+  }
+}
+
+TEST(FrameBufferTest, Clear_EagerClearsEverything) {
+  FrameBuffer fb(100, 40);
+  fb.set_lazy_clear(false);
+  fb.Clear(colors::White());
+  ASSERT_EQ(100u * 40 * 8, fb.ClearedBytes());
+  ASSERT_EQ(FrameBuffer::PackColor(colors::White()), fb.color_row(39)[99]);
+}
+
+TEST(FrameBufferTest, ClearRect_KeepsPixelsOutsideRect) {
+  FrameBuffer fb(100, 40);
+  auto const background = Color::RGB(0x20, 0x40, 0x60);
+  fb.Clear(background);
+  auto const id = fb.clear_id();
+  for (int y = 0; y < fb.height(); y++) {
+    fb.FillRow(y, 0, fb.width() - 1, colors::White());
+  }
+  for (int y = 8; y < 16; y++) {
+    for (int x = 8; x < 16; x++) {
+      fb.Set(x, y, 0.5f, colors::White());
+    }
+  }
+  fb.Set(30, 30, 0.5f, colors::White());
+  ASSERT_TRUE(fb.DepthOccluded({8, 8, 12, 12}, 0.1f));
+  fb.ClearRect({5, 5, 20, 20});
+  ASSERT_EQ(id, fb.clear_id());
+  ASSERT_EQ(background, fb.Get(10, 10));
+  ASSERT_EQ(colors::White(), fb.Get(20, 10));
+  ASSERT_EQ(colors::White(), fb.Get(30, 30));
+  // 清除区域内的深度恢复为最远，分层深度缓冲不再认为被遮挡
+  ASSERT_TRUE(fb.NeedRender(10, 10, 0.1f));
+  ASSERT_FALSE(fb.NeedRender(30, 30, 0.1f));
+  ASSERT_FALSE(fb.DepthOccluded({8, 8, 12, 12}, 0.1f));
+  fb.Clear(background);
+  ASSERT_NE(id, fb.clear_id());
+}
+
+TEST(FrameBufferTest, SetYOrigin_TopStoresRowsTopDown) {
+  FrameBuffer fb(8, 4);
+  fb.Set(1, 0, colors::White());
+  fb.set_y_origin(YOrigin::kTop);
+  ASSERT_EQ(colors::White(), fb.Get(1, 0));
+  auto const first_row = reinterpret_cast<std::uint32_t const *>(fb.data());
+  ASSERT_EQ(first_row + 3 * fb.stride(), fb.color_row(0));
+  ASSERT_EQ(FrameBuffer::PackColor(colors::White()), fb.color_row(0)[1]);
+  fb.Set(2, 3, colors::Red());
+  ASSERT_EQ(FrameBuffer::PackColor(colors::Red()), first_row[2]);
+}
+
+TEST(FrameBufferTest, SetDepthFormat_TestUsesFormatPrecision) {
+  FrameBuffer fb(8, 8);
+  float const z = 0.25f;
+  float const closer = z + 1e-6f;
+  for (auto format : {DepthFormat::kFloat32, DepthFormat::kUnorm24,
+                      DepthFormat::kUnorm16}) {
+    fb.set_depth_format(format);
+    ASSERT_EQ(format, fb.depth_format());
+    ASSERT_TRUE(fb.NeedRender(3, 3, z));
+    fb.Set(3, 3, z, colors::White());
+    ASSERT_FALSE(fb.NeedRender(3, 3, z));
+    // 16 位定点数无法区分相差 1e-6 的深度
+    ASSERT_EQ(format != DepthFormat::kUnorm16, fb.NeedRender(3, 3, closer))
+        << depths::FormatName(format);
+    fb.Clear();
+    ASSERT_TRUE(fb.NeedRender(3, 3, z));
+  }
+}
+
+TEST(FrameBufferTest, ClearedBytes_CountsDepthFormatSize) {
+  FrameBuffer fb(64, 64);
+  fb.set_lazy_clear(false);
+  fb.Clear();
+  ASSERT_EQ(64u * 64u * 8u, fb.ClearedBytes());
+  fb.set_depth_format(DepthFormat::kUnorm16);
+  fb.Clear();
+  ASSERT_EQ(64u * 64u * 6u, fb.ClearedBytes());
+}
+
+TEST(FrameBufferTest, WriteSamples_UniformPixelsStayCompact) {
+  FrameBuffer fb(8, 8);
+  fb.set_samples(4);
+  ASSERT_EQ(4, fb.samples());
+  auto const red = FrameBuffer::PackColor(colors::Red());
+  fb.Touch(fb.bounds());
+  fb.WriteSamples(2, 3, 0x3, red);
+  ASSERT_TRUE(fb.multi_color(2, 3));
+  ASSERT_EQ(Color::RGBA(128, 0, 0, 128), fb.Get(2, 3));
+  // 其余采样点写入相同的颜色后像素恢复为单个颜色
+  fb.WriteSamples(2, 3, 0xC, red);
+  ASSERT_FALSE(fb.multi_color(2, 3));
+  ASSERT_EQ(colors::Red(), fb.Get(2, 3));
+
+  fb.WriteSamples(5, 5, 0x1, red);
+  fb.Resolve();
+  ASSERT_EQ(FrameBuffer::PackColor(Color::RGBA(64, 0, 0, 64)),
+            fb.color_row(5)[5]);
+  fb.Set(5, 5, colors::White());
+  ASSERT_FALSE(fb.multi_color(5, 5));
+  fb.Clear();
+  fb.Touch(fb.bounds());
+  ASSERT_FALSE(fb.multi_color(2, 3));
+}
+
+TEST(FrameBufferTest, TestSamples_EachSampleHasItsOwnDepth) {
+  FrameBuffer fb(8, 8);
+  fb.set_samples(4);
+  fb.Touch(fb.bounds());
+  float const near[4] = {0.5f, 0.5f, 0.5f, 0.5f};
+  float const far[4] = {0.25f, 0.25f, 0.25f, 0.75f};
+  ASSERT_EQ(0x5u, fb.TestSamples(1, 1, near, 0x5, true));
+  ASSERT_EQ(0xAu, fb.TestSamples(1, 1, far, 0xF, false));
+  ASSERT_EQ(0xAu, fb.TestSamples(1, 1, far, 0xF, true));
+  ASSERT_EQ(0x2u, fb.TestSamples(1, 1, near, 0xF, true));
+  ASSERT_FALSE(fb.NeedRender(1, 1, 0.5f));
+  ASSERT_TRUE(fb.NeedRender(1, 2, 0.5f));
+  ASSERT_EQ(64u * (4 + 16 + 1), fb.ClearedBytes());
+}
+
+TEST(FrameBufferTest, Average4x32_SimdMatchesScalar) {
+  std::vector<std::uint32_t> src(4 * 21);
+  std::uint32_t seed = 12345;
+  for (auto &v : src) {
+    seed = seed * 1664525u + 1013904223u;
+    v = seed;
+  }
+  for (int n = 0; n <= 21; n++) {
+    std::vector<std::uint32_t> expect(n);
+    simd::Average4x32(src.data(), expect.data(), n, simd::Isa::kScalar);
+    for (auto isa : {simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      std::vector<std::uint32_t> actual(n);
+      simd::Average4x32(src.data(), actual.data(), n, isa);
+      ASSERT_EQ(expect, actual) << simd::IsaName(isa) << " n = " << n;
+    }
+  }
+  std::uint32_t const same[4] = {0x80402001, 0x80402001, 0x80402001,
+                                 0x80402001};
+  std::uint32_t avg{};
+  simd::Average4x32(same, &avg, 1);
+  ASSERT_EQ(0x80402001u, avg);
+}
@@ -0,0 +1,84 @@
+#include "lib/frame_pipeline.h"
+
+#include <thread>
+#include <vector>
+
+#include "lib/spsc_queue.h"
+#include "test.h"
+
+using namespace sren;
+
+TEST(SpscQueueTest, PushPop_FifoAndBounded) {
+  SpscQueue<int, 3> queue;
+  int value = 0;
+  ASSERT_FALSE(queue.Pop(&value));
+  ASSERT_TRUE(queue.Push(1));
+  ASSERT_TRUE(queue.Push(2));
+  ASSERT_FALSE(queue.Push(3));
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(1, value);
+  ASSERT_TRUE(queue.Push(3));
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(2, value);
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(3, value);
+  ASSERT_FALSE(queue.Pop(&value));
+}
+
+TEST(SpscQueueTest, PushPop_AcrossThreads) {
+  constexpr int kCount = 10000;
+  SpscQueue<int, 8> queue;
+  std::thread producer([&] {
+    for (int i = 0; i < kCount; i++) {
+      while (!queue.Push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (int i = 0; i < kCount; i++) {
+    int value = -1;
+    while (!queue.Pop(&value)) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(i, value);
+  }
+  producer.join();
+}
+
+namespace {
+
+// 运行 frames 帧，返回每次呈现的帧号，渲染函数将帧号写入左下角像素
+std::vector<int> RunPipeline(int latency, int frames) {
+  FramePipeline pipeline;
+  pipeline.Resize(4, 4, YOrigin::kBottom);
+  pipeline.set_latency(latency);
+  int next = 0;
+  pipeline.set_render_func([&](FrameBuffer *fb) {
+    fb->Clear();
+    fb->Set(0, 0, Color::RGBA(next, 0, 0, 255));
+  });
+  std::vector<int> presented;
+  for (int i = 0; i < frames; i++) {
+    pipeline.Sync();
+    next = i;
+    pipeline.Submit();
+    if (auto const fb = pipeline.Acquire()) {
+      presented.push_back(int(fb->Get(0, 0).r_hex()));
+      pipeline.Release(fb);
+    }
+  }
+  pipeline.Sync();
+  return presented;
+}
+
+}  // namespace
+
+TEST(FramePipelineTest, Acquire_PresentsInOrderAfterLatency) {
+  for (int latency = 1; latency <= FramePipeline::kMaxLatency; latency++) {
+    auto const presented = RunPipeline(latency, 10);
+    ASSERT_EQ(size_t(10 - (latency - 1)), presented.size());
+    for (int i = 0; i < int(presented.size()); i++) {
+      ASSERT_EQ(i, presented[i]) << "latency " << latency;
+    }
+  }
+}
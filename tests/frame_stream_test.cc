@@ -0,0 +1,118 @@
+#include "lib/frame_stream.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace sren;
+
+namespace {
+
+std::vector<std::uint8_t> ReadFile(std::string const &path) {
+  std::vector<std::uint8_t> data;
+  auto const file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return data;
+  }
+  int c = 0;
+  while ((c = std::fgetc(file)) != EOF) {
+    data.push_back(std::uint8_t(c));
+  }
+  std::fclose(file);
+  return data;
+}
+
+// 第 i 帧顶部一行为 (i, 0, 0)，其余为背景色
+void FillFrame(int i, FrameBuffer *fb) {
+  fb->Clear();
+  fb->FillRow(fb->height() - 1, 0, fb->width() - 1,
+              Color::RGBA(i, 0, 0, 255));
+}
+
+}  // namespace
+
+TEST(FrameStreamTest, Write_RgbaFramesInOrderTopRowFirst) {
+  for (bool mmap : {false, true}) {
+    auto const path = ::testing::TempDir() + "stream.rgba";
+    FrameBuffer fb(3, 2);
+    FrameStream stream;
+    // 缓冲比帧数少，写出跟不上时 Write 等待而不丢帧
+    stream.set_buffers(2);
+    stream.set_mmap(mmap);
+    ASSERT_TRUE(stream.Open(path, 3, 2, StreamFormat::kRgba));
+    for (int i = 0; i < 40; i++) {
+      FillFrame(i, &fb);
+      ASSERT_TRUE(stream.Write(&fb));
+    }
+    ASSERT_TRUE(stream.Close());
+    ASSERT_EQ(40u, stream.stats().frames);
+
+    auto const data = ReadFile(path);
+    ASSERT_EQ(40u * 3 * 2 * 4, data.size());
+    auto const background = fb.color_row(0)[0];
+    for (int i = 0; i < 40; i++) {
+      auto const frame = &data[i * 3 * 2 * 4];
+      for (int x = 0; x < 3; x++) {
+        ASSERT_EQ(i, frame[x * 4]);
+        ASSERT_EQ(255, frame[x * 4 + 3]);
+        ASSERT_EQ(0, std::memcmp(&background, &frame[12 + x * 4], 4));
+      }
+    }
+  }
+}
+
+TEST(FrameStreamTest, Write_Y4mHeaderAndPlanes) {
+  auto const path = ::testing::TempDir() + "stream.y4m";
+  ASSERT_EQ(StreamFormat::kY4m, streams::FormatFromPath(path));
+  // 奇数宽度，色度平面为 2x1
+  FrameBuffer fb(3, 2);
+  FrameStream stream;
+  stream.set_fps(30);
+  ASSERT_TRUE(stream.Open(path, 3, 2, StreamFormat::kY4m));
+  for (int i = 0; i < 2; i++) {
+    fb.Clear();
+    fb.FillRow(0, 0, 2, colors::White());
+    fb.FillRow(1, 0, 2, colors::White());
+    ASSERT_TRUE(stream.Write(&fb));
+  }
+  ASSERT_TRUE(stream.Close());
+
+  auto const data = ReadFile(path);
+  std::string const header = "YUV4MPEG2 W3 H2 F30:1 Ip A1:1 C420jpeg\n";
+  std::string const frame = "FRAME\n";
+  std::size_t const planes = 3 * 2 + 2 * 2;
+  ASSERT_EQ(header.size() + 2 * (frame.size() + planes), data.size());
+  ASSERT_EQ(header, std::string(data.begin(), data.begin() + header.size()));
+  for (int i = 0; i < 2; i++) {
+    auto const p = header.size() + i * (frame.size() + planes);
+    ASSERT_EQ(frame, std::string(&data[p], &data[p] + frame.size()));
+    auto const y = &data[p + frame.size()];
+    for (int j = 0; j < 6; j++) {
+      ASSERT_EQ(255, y[j]);
+    }
+    for (int j = 6; j < 10; j++) {
+      ASSERT_EQ(128, y[j]);
+    }
+  }
+}
+
+TEST(FrameStreamTest, RgbaToI420_AveragesChromaOver2x2) {
+  // 左侧 2x2 为红色，右侧一列为蓝色
+  std::uint8_t const rgba[] = {
+      255, 0, 0, 255, 255, 0, 0, 255, 0, 0, 255, 255,
+      255, 0, 0, 255, 255, 0, 0, 255, 0, 0, 255, 255,
+  };
+  std::uint8_t yuv[6 + 2 + 2]{};
+  streams::RgbaToI420(rgba, 3, 2, yuv);
+  ASSERT_EQ(77, yuv[0]);
+  ASSERT_EQ(29, yuv[2]);
+  // 红色的 U 偏小 V 偏大，蓝色相反
+  ASSERT_EQ(85, yuv[6]);
+  ASSERT_EQ(255, yuv[7]);
+  ASSERT_EQ(255, yuv[8]);
+  ASSERT_EQ(107, yuv[9]);
+}
@@ -0,0 +1,58 @@
+#include "lib/g_buffer.h"
+
+#include "lib/object.h"
+#include "test.h"
+
+using namespace sren;
+
+TEST(GBufferTest, AddMaterial_SameObject_SameId) {
+  Object a{};
+  Object b{};
+  GBuffer gbuffer{};
+  gbuffer.Resize(4, 4);
+  auto const id_a = gbuffer.AddMaterial(&a);
+  auto const id_b = gbuffer.AddMaterial(&b);
+  ASSERT_NE(0u, id_a);
+  ASSERT_NE(id_a, id_b);
+  ASSERT_EQ(id_a, gbuffer.AddMaterial(&a));
+  ASSERT_EQ(id_b, gbuffer.MaterialId(&b));
+  ASSERT_EQ(&a, gbuffer.material(id_a));
+}
+
+TEST(GBufferTest, Clear_ResetsSamplesAndMaterials) {
+  Object a{};
+  GBuffer gbuffer{};
+  gbuffer.Resize(4, 4);
+  auto const id = gbuffer.AddMaterial(&a);
+  gbuffer.row(2)[3].material = id;
+  gbuffer.Clear();
+  ASSERT_EQ(0u, gbuffer.row(2)[3].material);
+  ASSERT_EQ(0u, gbuffer.MaterialId(&a));
+}
+
+TEST(GBufferTest, ClearRect_KeepsSamplesOutsideRect) {
+  Object a{};
+  GBuffer gbuffer{};
+  gbuffer.Resize(8, 6);
+  auto const id = gbuffer.AddMaterial(&a);
+  for (int y = 0; y < gbuffer.height(); y++) {
+    for (int x = 0; x < gbuffer.width(); x++) {
+      gbuffer.row(y)[x].material = id;
+    }
+  }
+  // 超出屏幕的部分被忽略
+  Rect const rect{2, 1, 10, 4};
+  gbuffer.Clear(rect);
+  for (int y = 0; y < gbuffer.height(); y++) {
+    for (int x = 0; x < gbuffer.width(); x++) {
+      auto const expect = rect.Contains(x, y) ? 0u : id;
+      ASSERT_EQ(expect, gbuffer.row(y)[x].material) << x << ", " << y;
+    }
+  }
+  ASSERT_EQ(0u, gbuffer.MaterialId(&a));
+
+  // 空矩形不清空任何像素
+  gbuffer.AddMaterial(&a);
+  gbuffer.Clear(Rect{});
+  ASSERT_EQ(id, gbuffer.row(0)[0].material);
+}
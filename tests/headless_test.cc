@@ -0,0 +1,65 @@
+#include "lib/headless.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "lib/camera.h"
+#include "test.h"
+
+using namespace sren;
+
+TEST(HeadlessTest, Run_CallsMainLoopEachFrame) {
+  Headless headless(4, 4);
+  std::vector<float> progress;
+  headless.set_main_loop([&](Headless *h) {
+    ASSERT_EQ(int(progress.size()), h->frame());
+    progress.push_back(h->progress());
+  });
+  ASSERT_TRUE(headless.Run(4));
+  ASSERT_EQ(4, headless.frames());
+  ASSERT_EQ((std::vector<float>{0.0f, 0.25f, 0.5f, 0.75f}), progress);
+}
+
+TEST(HeadlessTest, Run_WritesPpmTopRowFirst) {
+  auto const pattern = ::testing::TempDir() + "headless_%d.ppm";
+  Headless headless(3, 2);
+  headless.set_output(pattern);
+  headless.set_main_loop([](Headless *h) {
+    auto &fb = h->frame_buffer();
+    fb.Clear();
+    // 顶部一行为红色，底部一行保持背景色
+    fb.FillRow(1, 0, 2, Color::RGBA(255, 0, 0, 255));
+  });
+  ASSERT_TRUE(headless.Run(2));
+
+  std::vector<char> path(pattern.size() + 8);
+  std::snprintf(path.data(), path.size(), pattern.c_str(), 1);
+  auto const file = std::fopen(path.data(), "rb");
+  ASSERT_NE(nullptr, file);
+  int width = 0;
+  int height = 0;
+  int max = 0;
+  ASSERT_EQ(3, std::fscanf(file, "P6 %d %d %d", &width, &height, &max));
+  std::fgetc(file);
+  unsigned char pixels[3 * 2 * 3]{};
+  ASSERT_EQ(sizeof(pixels), std::fread(pixels, 1, sizeof(pixels), file));
+  std::fclose(file);
+  ASSERT_EQ(3, width);
+  ASSERT_EQ(2, height);
+  ASSERT_EQ(255, max);
+  for (int x = 0; x < 3; x++) {
+    ASSERT_EQ(255, pixels[x * 3]);
+    ASSERT_EQ(0, pixels[9 + x * 3]);
+  }
+}
+
+TEST(HeadlessTest, Orbit_KeepsDistanceAndLooksAtTarget) {
+  Camera camera{};
+  Vector3 const target{1, 0, 0};
+  for (float t : {0.0f, 0.25f, 0.6f}) {
+    paths::Orbit(t, target, 2.0f, 0.0f, &camera);
+    ASSERT_NEAR(2.0f, (camera.pos() - target).Magnitude(), 1e-5f);
+    ASSERT_EQ(target, camera.target());
+  }
+}
@@ -0,0 +1,46 @@
+#include "lib/hi_z.h"
+
+#include <vector>
+
+#include "test.h"
+
+using namespace sren;
+
+TEST(HiZTest, Occluded_AfterClear_NothingOccluded) {
+  HiZ hi_z{};
+  hi_z.Resize(20, 10, 0.0f);
+  std::vector<float> z_buffer(20 * 10, 0.0f);
+  ASSERT_FALSE(hi_z.Occluded({0, 0, 20, 10}, 0.5f, z_buffer.data()));
+  ASSERT_TRUE(hi_z.Occluded({0, 0, 20, 10}, 0.0f, z_buffer.data()));
+}
+
+TEST(HiZTest, Occluded_DirtyTile_UsesNewMinimum) {
+  HiZ hi_z{};
+  hi_z.Resize(20, 10, 0.0f);
+  std::vector<float> z_buffer(20 * 10, 0.0f);
+  // 填满第一个块
+  for (int y = 0; y < HiZ::kTileSize; y++) {
+    for (int x = 0; x < HiZ::kTileSize; x++) {
+      z_buffer[x + y * 20] = 1.0f;
+    }
+    hi_z.MarkDirty(y, 0, HiZ::kTileSize - 1);
+  }
+  ASSERT_TRUE(hi_z.Occluded({0, 0, 8, 8}, 0.5f, z_buffer.data()));
+  ASSERT_TRUE(hi_z.Occluded({2, 3, 5, 6}, 1.0f, z_buffer.data()));
+  ASSERT_FALSE(hi_z.Occluded({2, 3, 5, 6}, 1.5f, z_buffer.data()));
+  // 跨入未填充的块
+  ASSERT_FALSE(hi_z.Occluded({4, 0, 12, 8}, 0.5f, z_buffer.data()));
+}
+
+TEST(HiZTest, Stats_AddAndReset) {
+  HiZ hi_z{};
+  hi_z.AddStats({1, 2, 3, 4});
+  hi_z.AddStats({1, 0, 0, 6});
+  auto const stats = hi_z.stats();
+  ASSERT_EQ(2u, stats.triangles);
+  ASSERT_EQ(2u, stats.blocks);
+  ASSERT_EQ(3u, stats.spans);
+  ASSERT_EQ(10u, stats.fragments);
+  hi_z.Clear(0.0f);
+  ASSERT_EQ(0u, hi_z.stats().fragments);
+}
@@ -0,0 +1,419 @@
+#include "lib/scene.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "lib/damage.h"
+#include "lib/frame_buffer.h"
+#include "test.h"
+
+using namespace sren;
+
+namespace {
+
+// 法线朝向相机的单色三角形，两种绕向各一个面，背面剔除后总有一个可见
+Model MakeTriangle(Color const &color) {
+  Model model{};
+  model.vertexs() = {{-0.5f, -0.5f, 0}, {0.5f, -0.5f, 0}, {0, 0.5f, 0}};
+  model.normals() = {{0, 0, 1}};
+  model.uvs() = {{0, 0}};
+  model.colors() = {color, color, color};
+  for (int v : {0, 1, 2, 0, 2, 1}) {
+    model.face_indexs().emplace_back(v, 0, 0);
+  }
+  return model;
+}
+
+void SetupScene(Scene *scene) {
+  scene->camera().SetLookAt({0, 0, 2}, {0, 0, 0});
+  scene->camera().SetPerspective(Radian(90.0f), 1.0f);
+  scene->lights().dir_lights().emplace_back(
+      Vector3(0, 0, -1), colors::White(), LightCoefficient{0.1f, 1.0f, 1.0f});
+  auto const red = scene->add_object("red");
+  red->set_model(MakeTriangle(colors::Red()));
+  red->set_render_style(kRenderColor);
+  red->transform().set_world_pos({-0.6f, 0, 0});
+  auto const green = scene->add_object("green");
+  green->set_model(MakeTriangle(colors::Green()));
+  green->set_render_style(kRenderColor);
+  green->transform().set_world_pos({0.6f, 0, 0});
+}
+
+// 单色纹理，与三角形的顶点颜色不同
+void SetSolidTexture(Object *obj) {
+  auto &material = obj->material();
+  material.diffuse_map() =
+      Data2D(1, 1, 3, std::vector<std::uint8_t>{0, 0, 255});
+  material.specular_map() = Data2D(1, 1, 1, std::vector<std::uint8_t>{0});
+  material.normal_map() =
+      Data2D(1, 1, 3, std::vector<std::uint8_t>{128, 128, 255});
+}
+
+void ExpectSameImage(FrameBuffer *expect, FrameBuffer *actual) {
+  expect->Resolve();
+  actual->Resolve();
+  for (int y = 0; y < expect->height(); y++) {
+    for (int x = 0; x < expect->width(); x++) {
+      ASSERT_EQ(expect->color_row(y)[x], actual->color_row(y)[x])
+          << x << ", " << y;
+    }
+  }
+}
+
+// 将 expect 与 fb 中从 (x0, y0) 开始的区域比较，返回 expect 中绘制过的像素数和不同的像素数。
+// 视口偏移后顶点坐标的舍入不同，边缘上个别像素可能不同
+std::pair<int, int> CountDiff(FrameBuffer *expect, FrameBuffer *fb, int x0,
+                              int y0) {
+  expect->Resolve();
+  fb->Resolve();
+  auto const background = FrameBuffer::PackColor(expect->background());
+  int drawn = 0;
+  int diff = 0;
+  for (int y = 0; y < expect->height(); y++) {
+    for (int x = 0; x < expect->width(); x++) {
+      auto const c = expect->color_row(y)[x];
+      drawn += c != background ? 1 : 0;
+      diff += c != fb->color_row(y + y0)[x + x0] ? 1 : 0;
+    }
+  }
+  return {drawn, diff};
+}
+
+// 统计 expect 中内部像素（3x3 邻域颜色都相同且不是背景）的个数，
+// 以及其中与 fb 不同的个数。边缘上的像素受覆盖率或光栅化规则影响，不参与比较
+std::pair<int, int> CountInteriorDiff(FrameBuffer *expect, FrameBuffer *fb) {
+  expect->Resolve();
+  fb->Resolve();
+  auto const background = FrameBuffer::PackColor(expect->background());
+  int interior = 0;
+  int diff = 0;
+  for (int y = 1; y + 1 < expect->height(); y++) {
+    for (int x = 1; x + 1 < expect->width(); x++) {
+      auto const c = expect->color_row(y)[x];
+      bool uniform = c != background;
+      for (int dy = -1; dy <= 1 && uniform; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          uniform = uniform && expect->color_row(y + dy)[x + dx] == c;
+        }
+      }
+      if (uniform) {
+        interior++;
+        diff += fb->color_row(y)[x] != c ? 1 : 0;
+      }
+    }
+  }
+  return {interior, diff};
+}
+
+}  // namespace
+
+TEST(SceneTest, RenderIncremental_RedrawsOnlyMovedObject) {
+  Scene scene{};
+  SetupScene(&scene);
+  scene.set_incremental(true);
+  FrameBuffer fb(96, 96);
+  scene.Render(&fb);
+  ASSERT_EQ((std::vector<Rect>{fb.bounds()}), scene.redrawn());
+
+  // 没有改变时不重绘
+  scene.Render(&fb);
+  ASSERT_TRUE(scene.redrawn().empty());
+  ASSERT_TRUE(fb.damage().empty());
+
+  scene.object(0)->transform().set_world_pos({-0.5f, 0.1f, 0});
+  scene.Render(&fb);
+  auto const redrawn = rects::Area(scene.redrawn());
+  ASSERT_GT(redrawn, 0);
+  ASSERT_LT(redrawn, fb.width() * fb.height() / 2);
+  ASSERT_EQ(scene.redrawn(), fb.damage());
+
+  Scene full{};
+  SetupScene(&full);
+  full.object(0)->transform().set_world_pos({-0.5f, 0.1f, 0});
+  FrameBuffer expect(96, 96);
+  full.Render(&expect);
+  ExpectSameImage(&expect, &fb);
+}
+
+TEST(SceneTest, RenderIncremental_PipelinedBuffersCatchUp) {
+  Scene scene{};
+  SetupScene(&scene);
+  scene.set_incremental(true);
+  scene.set_tiled(true);
+  std::vector<FrameBuffer> fbs(2, FrameBuffer(96, 96));
+  // 两个帧缓冲轮流渲染，每个帧缓冲需要补上另一个渲染的那一帧的改变
+  for (int frame = 0; frame < 6; frame++) {
+    scene.object(frame % 2)->transform().set_world_pos(
+        {frame % 2 ? 0.6f : -0.6f, 0.05f * frame, 0});
+    scene.Render(&fbs[frame % 2]);
+  }
+  Scene full{};
+  SetupScene(&full);
+  full.object(0)->transform().set_world_pos({-0.6f, 0.2f, 0});
+  full.object(1)->transform().set_world_pos({0.6f, 0.25f, 0});
+  FrameBuffer expect(96, 96);
+  full.Render(&expect);
+  ExpectSameImage(&expect, &fbs[1]);
+}
+
+TEST(SceneTest, Render_StaticObjectsReuseVertexs) {
+  Scene scene{};
+  SetupScene(&scene);
+  FrameBuffer first(96, 96);
+  scene.Render(&first);
+  ASSERT_EQ(0, scene.clip_stats().objects_reused);
+
+  // 物体和相机都没有改变，两个物体都沿用上一帧的变换结果
+  FrameBuffer fb(96, 96);
+  scene.Render(&fb);
+  ASSERT_EQ(2, scene.clip_stats().objects_reused);
+  ExpectSameImage(&first, &fb);
+
+  // 只有移动的物体重新变换
+  scene.object(0)->transform().set_world_pos({-0.5f, 0.1f, 0});
+  scene.Render(&fb);
+  ASSERT_EQ(1, scene.clip_stats().objects_reused);
+  Scene full{};
+  SetupScene(&full);
+  full.object(0)->transform().set_world_pos({-0.5f, 0.1f, 0});
+  FrameBuffer expect(96, 96);
+  full.Render(&expect);
+  ExpectSameImage(&expect, &fb);
+
+  // 相机或视口改变后所有物体都重新变换
+  scene.camera().SetLookAt({0, 0, 2.5f}, {0, 0, 0});
+  scene.Render(&fb);
+  ASSERT_EQ(0, scene.clip_stats().objects_reused);
+  scene.set_viewport({0, 0, 48, 48});
+  scene.Render(&fb);
+  ASSERT_EQ(0, scene.clip_stats().objects_reused);
+}
+
+TEST(SceneTest, Render_CullsBackfacesPerObject) {
+  Scene scene{};
+  SetupScene(&scene);
+  FrameBuffer fb(96, 96);
+  scene.Render(&fb);
+  // 每个物体两种绕向的面各一个，背面被剔除，只有正面交给光栅化
+  ASSERT_EQ(2, scene.clip_stats().polygons_backface);
+  for (int i = 0; i < scene.nobjects(); i++) {
+    auto const obj = scene.object(i);
+    ASSERT_EQ(1, obj->vertex_versions().stats.polygons_backface);
+    ASSERT_EQ(std::vector<int>{0}, obj->visible_polygons());
+    ASSERT_EQ(PolygonState::kBackface, obj->polygons()[1].state());
+  }
+}
+
+TEST(SceneTest, Render_ParallelTransformMatchesSingleThread) {
+  Scene single{};
+  SetupScene(&single);
+  Scene parallel{};
+  SetupScene(&parallel);
+  parallel.set_nthreads(4);
+  // 物体比线程多，最后一个物体穿过近平面需要裁剪
+  for (auto *scene : {&single, &parallel}) {
+    for (int i = 0; i < 6; i++) {
+      auto const obj = scene->add_object("extra");
+      obj->set_model(MakeTriangle(colors::Blue()));
+      obj->set_render_style(kRenderColor);
+      obj->transform().set_world_pos({-1.5f + i * 0.6f, -0.6f, 0});
+    }
+    auto const near = scene->object(scene->nobjects() - 1);
+    near->transform().set_world_pos({0, -0.3f, 1.7f});
+    near->transform().set_rotation({1.3f, 0, 0});
+  }
+  FrameBuffer expect(96, 96);
+  single.Render(&expect);
+  FrameBuffer fb(96, 96);
+  parallel.Render(&fb);
+  ExpectSameImage(&expect, &fb);
+  auto const &a = single.clip_stats();
+  auto const &b = parallel.clip_stats();
+  ASSERT_GT(a.polygons_clipped, 0);
+  ASSERT_EQ(a.objects_culled, b.objects_culled);
+  ASSERT_EQ(a.polygons_culled, b.polygons_culled);
+  ASSERT_EQ(a.polygons_clipped, b.polygons_clipped);
+  ASSERT_EQ(a.polygons_emitted, b.polygons_emitted);
+  ASSERT_EQ(a.polygons_backface, b.polygons_backface);
+}
+
+TEST(SceneTest, Render_OpaqueTextureAndColorKeepsColor) {
+  // 不透明物体同时使用纹理和颜色时，后写入的颜色着色覆盖纹理着色
+  Scene color{};
+  SetupScene(&color);
+  FrameBuffer expect(96, 96);
+  color.Render(&expect);
+  Scene both{};
+  SetupScene(&both);
+  for (int i = 0; i < both.nobjects(); i++) {
+    SetSolidTexture(both.object(i));
+    both.object(i)->set_render_style(kRenderTexture | kRenderColor);
+  }
+  FrameBuffer fb(96, 96);
+  both.Render(&fb);
+  ExpectSameImage(&expect, &fb);
+
+  // 只用纹理时结果不同，说明上面的比较确实区分了两种着色
+  for (int i = 0; i < both.nobjects(); i++) {
+    both.object(i)->set_render_style(kRenderTexture);
+  }
+  FrameBuffer texture(96, 96);
+  both.Render(&texture);
+  ASSERT_GT(CountDiff(&expect, &texture, 0, 0).second, 0);
+}
+
+TEST(SceneTest, Render_DeferredMatchesForward) {
+  // 分别使用颜色、纹理、纹理和颜色三种渲染方式的物体
+  auto const setup = [](Scene *scene) {
+    SetupScene(scene);
+    auto const obj = scene->add_object("textured");
+    obj->set_model(MakeTriangle(colors::White()));
+    obj->transform().set_world_pos({0, -0.6f, 0});
+    SetSolidTexture(obj);
+    SetSolidTexture(scene->object(1));
+    scene->object(1)->set_render_style(kRenderTexture | kRenderColor);
+  };
+  Scene forward{};
+  setup(&forward);
+  FrameBuffer expect(96, 96);
+  forward.Render(&expect);
+  for (bool tiled : {false, true}) {
+    Scene deferred{};
+    setup(&deferred);
+    deferred.set_shading(Shading::kDeferred);
+    deferred.set_tiled(tiled);
+    deferred.set_nthreads(4);
+    FrameBuffer fb(96, 96);
+    deferred.Render(&fb);
+    ExpectSameImage(&expect, &fb);
+  }
+}
+
+TEST(SceneTest, Render_MultisampleMatchesInteriorAndTiles) {
+  Scene scene{};
+  SetupScene(&scene);
+  FrameBuffer expect(96, 96);
+  scene.Render(&expect);
+  FrameBuffer serial(96, 96);
+  serial.set_samples(FrameBuffer::kMaxSamples);
+  scene.Render(&serial);
+  // 三角形内部的像素所有采样点都被覆盖，结果与不开多重采样时相同
+  auto const interior = CountInteriorDiff(&expect, &serial);
+  ASSERT_GT(interior.first, 0);
+  ASSERT_EQ(0, interior.second);
+  // 边缘上的像素混合了三角形与背景，只在多重采样时出现
+  ASSERT_GT(CountDiff(&expect, &serial, 0, 0).second, 0);
+
+  // 分块多线程渲染的结果与单线程相同
+  scene.set_tiled(true);
+  scene.set_nthreads(4);
+  FrameBuffer tiled(96, 96);
+  tiled.set_samples(FrameBuffer::kMaxSamples);
+  scene.Render(&tiled);
+  ExpectSameImage(&serial, &tiled);
+}
+
+TEST(SceneTest, Render_HalfSpaceMatchesTrapezoidCoverage) {
+  Scene scene{};
+  SetupScene(&scene);
+  FrameBuffer trapezoid(96, 96);
+  scene.Render(&trapezoid);
+  scene.set_rasterizer(Rasterizer::kHalfSpace);
+  FrameBuffer serial(96, 96);
+  scene.Render(&serial);
+  // 两种光栅化的填充规则不同，每行在每条边上最多差一个像素。
+  // 内部像素完全相同，不同的像素数不超过边缘像素数
+  auto const diff = CountDiff(&trapezoid, &serial, 0, 0);
+  auto const interior = CountInteriorDiff(&trapezoid, &serial);
+  ASSERT_GT(interior.first, 0);
+  ASSERT_EQ(0, interior.second);
+  ASSERT_GT(diff.second, 0);
+  ASSERT_LE(diff.second, diff.first - interior.first);
+
+  // 定点数边函数的结果与分块方式无关，分块多线程渲染的结果逐像素相同
+  scene.set_tiled(true);
+  scene.set_nthreads(4);
+  FrameBuffer tiled(96, 96);
+  scene.Render(&tiled);
+  ExpectSameImage(&serial, &tiled);
+}
+
+TEST(SceneTest, Render_HiZSkipsHiddenObjectWithSameResult) {
+  // 先绘制的红色三角形离相机更近，完全挡住之后绘制的绿色三角形
+  auto const setup = [](Scene *scene) {
+    SetupScene(scene);
+    scene->object(0)->transform().set_world_pos({0, 0, 0.5f});
+    scene->object(1)->transform().set_world_pos({0, -0.05f, 0});
+  };
+  for (auto r : {Rasterizer::kTrapezoid, Rasterizer::kHalfSpace}) {
+    Scene off{};
+    setup(&off);
+    off.set_rasterizer(r);
+    off.set_hi_z(false);
+    FrameBuffer expect(96, 96);
+    off.Render(&expect);
+    auto const none = expect.hi_z().stats();
+    ASSERT_EQ(0u, none.triangles + none.blocks + none.spans);
+
+    Scene on{};
+    setup(&on);
+    on.set_rasterizer(r);
+    FrameBuffer fb(96, 96);
+    on.Render(&fb);
+    ExpectSameImage(&expect, &fb);
+    auto const stats = fb.hi_z().stats();
+    ASSERT_GT(stats.triangles + stats.blocks + stats.spans, 0u);
+    ASSERT_GT(stats.fragments, 0u);
+
+    // 绿色三角形确实完全被挡住
+    off.object(1)->set_state(ObjectState::kDisable);
+    FrameBuffer front(96, 96);
+    off.Render(&front);
+    ExpectSameImage(&front, &fb);
+  }
+}
+
+TEST(SceneTest, RenderViews_EachViewMatchesSingleRender) {
+  Scene scene{};
+  SetupScene(&scene);
+  std::vector<View> views(2);
+  views[0].camera = scene.camera();
+  views[0].viewport = {0, 0, 64, 64};
+  views[1].camera.SetLookAt({0.5f, 0, 2}, {0, 0, 0});
+  views[1].camera.SetPerspective(Radian(60.0f), 1.0f);
+  views[1].viewport = {64, 32, 128, 96};
+  FrameBuffer fb(128, 96);
+  scene.RenderViews(&fb, views);
+  fb.Resolve();
+
+  for (auto const &view : views) {
+    scene.camera() = view.camera;
+    FrameBuffer expect(64, 64);
+    scene.Render(&expect);
+    auto const diff = CountDiff(&expect, &fb, view.viewport.x0,
+                                view.viewport.y0);
+    if (view.viewport.x0 == 0 && view.viewport.y0 == 0) {
+      ASSERT_EQ(0, diff.second);
+    } else {
+      ASSERT_LE(diff.second, diff.first / 50);
+    }
+    ASSERT_GT(diff.first, 0);
+  }
+  // 视口之外保持背景色
+  ASSERT_EQ(FrameBuffer::PackColor(scene.background()), fb.color_row(80)[10]);
+}
+
+TEST(SceneTest, Render_ViewportOffsetsImage) {
+  Scene scene{};
+  SetupScene(&scene);
+  FrameBuffer expect(64, 64);
+  scene.Render(&expect);
+  scene.set_viewport({32, 16, 96, 80});
+  FrameBuffer fb(128, 96);
+  scene.Render(&fb);
+  auto const diff = CountDiff(&expect, &fb, 32, 16);
+  ASSERT_GT(diff.first, 0);
+  ASSERT_LE(diff.second, diff.first / 50);
+  ASSERT_EQ(FrameBuffer::PackColor(scene.background()), fb.color_row(8)[8]);
+}
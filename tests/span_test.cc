@@ -0,0 +1,131 @@
+#include "lib/span.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "test.h"
+
+using namespace sren;
+
+namespace {
+
+SpanSetup MakeTestSetup() {
+  SpanSetup s{};
+  for (int k = 0; k < SpanSetup::kCount; k++) {
+    s.start[k] = 0.5f + 0.1f * k;
+    s.step[k] = 0.01f * (k + 1);
+  }
+  return s;
+}
+
+}  // namespace
+
+TEST(SpanTest, Kernels_AgreeWithScalar) {
+  auto const s = MakeTestSetup();
+  auto const &scalar = spans::GetKernel(simd::Isa::kScalar);
+  ASSERT_EQ(simd::Isa::kScalar, scalar.isa);
+  float depth[16];
+  for (int i = 0; i < 16; i++) {
+    depth[i] = i % 3 == 0 ? 10.0f : 0.0f;
+  }
+  for (auto isa : {simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    auto const &kernel = spans::GetKernel(isa);
+    for (int i = 0; i < 16; i += kernel.lanes) {
+      for (int n = 1; n <= kernel.lanes && i + n <= 16; n++) {
+        ASSERT_EQ(scalar.depth_test(s, depth + i, i, n),
+                  kernel.depth_test(s, depth + i, i, n));
+        spans::Lanes expect{};
+        spans::Lanes actual{};
+        scalar.interp(s, spans::kAllAttrs, i, n, &expect);
+        kernel.interp(s, spans::kAllAttrs, i, n, &actual);
+        for (int k = 0; k < SpanSetup::kCount; k++) {
+          for (int j = 0; j < n; j++) {
+            ASSERT_NEAR(expect.values[k][j], actual.values[k][j], 1e-5f);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(SpanTest, DepthKernels_AgreeWithScalarForEachFormat) {
+  SpanSetup s{};
+  s.start[SpanSetup::kZ] = 0.3f;
+  s.step[SpanSetup::kZ] = 0.02f;
+  for (auto format : {DepthFormat::kFloat32, DepthFormat::kUnorm24,
+                      DepthFormat::kUnorm16}) {
+    auto const &scalar = spans::GetKernel(simd::Isa::kScalar, format);
+    ASSERT_EQ(format, scalar.depth_format);
+    for (auto isa : {simd::Isa::kSse2, simd::Isa::kAvx2}) {
+      auto const &kernel = spans::GetKernel(isa, format);
+      int const n = kernel.lanes;
+      unsigned const mask = 0xA6u & ((1u << n) - 1);
+      // 两份深度缓冲先写入一半像素，再各自测试并写入其余像素
+      std::uint32_t expect[spans::kMaxLanes] = {};
+      std::uint32_t actual[spans::kMaxLanes] = {};
+      scalar.store_depth(s, expect, 4, n, mask);
+      kernel.store_depth(s, actual, 4, n, mask);
+      ASSERT_EQ(0, std::memcmp(expect, actual, sizeof(expect)))
+          << depths::FormatName(format) << " " << simd::IsaName(isa);
+      auto const pass = scalar.depth_test(s, expect, 0, n);
+      ASSERT_EQ(pass, kernel.depth_test(s, actual, 0, n));
+      // 第 4 个像素开始写入的深度比第 0 个像素开始的更近
+      ASSERT_EQ(((1u << n) - 1) & ~mask, pass);
+      scalar.store_depth(s, expect, 0, n, pass);
+      kernel.store_depth(s, actual, 0, n, pass);
+      ASSERT_EQ(0, std::memcmp(expect, actual, sizeof(expect)));
+    }
+  }
+}
+
+TEST(SpanTest, StoreColor_OnlyMaskedLanesWritten) {
+  std::uint32_t const src[spans::kMaxLanes] = {1, 2, 3, 4, 5, 6, 7, 8};
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    auto const &kernel = spans::GetKernel(isa);
+    std::uint32_t color[spans::kMaxLanes] = {};
+    kernel.store_color(src, color, kernel.lanes, 0x5);
+    for (int j = 0; j < kernel.lanes; j++) {
+      ASSERT_EQ(j == 0 || j == 2 ? src[j] : 0u, color[j]);
+    }
+  }
+}
+
+TEST(SpanTest, Interp_OnlyRequestedAttrsWritten) {
+  auto const s = MakeTestSetup();
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    auto const &kernel = spans::GetKernel(isa);
+    spans::Lanes lanes{};
+    kernel.interp(s, spans::kUvAttrs, 0, kernel.lanes, &lanes);
+    for (int j = 0; j < kernel.lanes; j++) {
+      ASSERT_NE(0.0f, lanes.values[SpanSetup::kU][j]);
+      ASSERT_NE(0.0f, lanes.values[SpanSetup::kV][j]);
+      ASSERT_EQ(0.0f, lanes.values[SpanSetup::kR][j]);
+      ASSERT_EQ(0.0f, lanes.values[SpanSetup::kNormalX][j]);
+    }
+  }
+}
+
+TEST(SpanTest, BlendColor_AgreesWithScalar) {
+  std::uint32_t src[8];
+  std::uint32_t dst[8];
+  for (int j = 0; j < 8; j++) {
+    src[j] = 0x01234567u * (j + 1) ^ (0x11u * j << 24);
+    dst[j] = 0x89ABCDEFu * (j + 3);
+  }
+  auto const &scalar = spans::GetKernel(simd::Isa::kScalar);
+  for (auto isa : {simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    auto const &kernel = spans::GetKernel(isa);
+    unsigned const mask = 0xB5u & ((1u << kernel.lanes) - 1);
+    std::uint32_t expect[8];
+    std::uint32_t actual[8];
+    std::copy(dst, dst + 8, expect);
+    std::copy(dst, dst + 8, actual);
+    scalar.blend_color(src, expect, kernel.lanes, mask);
+    kernel.blend_color(src, actual, kernel.lanes, mask);
+    for (int j = 0; j < kernel.lanes; j++) {
+      ASSERT_EQ(expect[j], actual[j]) << simd::IsaName(isa) << " lane " << j;
+    }
+  }
+}
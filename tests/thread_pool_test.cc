@@ -0,0 +1,85 @@
+#include "lib/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "test.h"
+
+using namespace sren;
+
+TEST(ThreadPoolTest, ParallelFor_RunsEachIndexOnce) {
+  for (int nthreads : {1, 4}) {
+    ThreadPool pool(nthreads);
+    ASSERT_EQ(nthreads, pool.nthreads());
+    // 同一个线程池重复执行多轮
+    std::vector<std::atomic<int>> counts(1000);
+    for (int round = 0; round < 3; round++) {
+      pool.ParallelFor(0, 1000, [&](int i) { counts[i]++; });
+    }
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ(3, counts[i].load()) << nthreads << " threads, index " << i;
+    }
+    // 空范围不执行
+    pool.ParallelFor(5, 5, [&](int) { FAIL(); });
+    pool.ParallelFor(5, 3, [&](int) { FAIL(); });
+  }
+}
+
+TEST(ThreadPoolTest, ParallelFor_NestedLoopsComplete) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> counts(16 * 64);
+  pool.ParallelFor(0, 16, [&](int i) {
+    pool.ParallelFor(0, 64, [&](int j) { counts[i * 64 + j]++; });
+  });
+  for (auto const &c : counts) {
+    ASSERT_EQ(1, c.load());
+  }
+}
+
+TEST(ThreadPoolTest, Run_RespectsDependenciesAndRepeats) {
+  ThreadPool pool(4);
+  // a -> b(并行循环) -> d，a -> c -> d
+  std::atomic<int> a{};
+  std::atomic<int> b{};
+  std::atomic<int> c{};
+  std::atomic<int> d{};
+  std::atomic<bool> ordered{true};
+  TaskGraph graph{};
+  int const ta = graph.Add([&] { a++; });
+  int const tb = graph.AddParallelFor(0, 100, [&](int) {
+    ordered = ordered && a == b / 100 + 1;
+    b++;
+  });
+  int const tc = graph.Add([&] {
+    ordered = ordered && a == c + 1;
+    c++;
+  });
+  int const td = graph.Add([&] {
+    ordered = ordered && b == (d + 1) * 100 && c == d + 1;
+    d++;
+  });
+  graph.Precede(ta, tb);
+  graph.Precede(ta, tc);
+  graph.Precede(tb, td);
+  graph.Precede(tc, td);
+  ASSERT_EQ(4, graph.size());
+  for (int run = 1; run <= 3; run++) {
+    pool.Run(&graph);
+    ASSERT_EQ(run, a.load());
+    ASSERT_EQ(run * 100, b.load());
+    ASSERT_EQ(run, c.load());
+    ASSERT_EQ(run, d.load());
+  }
+  ASSERT_TRUE(ordered);
+}
+
+TEST(ThreadPoolTest, Run_EmptyParallelForStillReleasesSuccessors) {
+  ThreadPool pool(2);
+  int done = 0;
+  TaskGraph graph{};
+  int const empty = graph.AddParallelFor(0, 0, [](int) { FAIL(); });
+  int const last = graph.Add([&] { done++; });
+  graph.Precede(empty, last);
+  pool.Run(&graph);
+  ASSERT_EQ(1, done);
+}
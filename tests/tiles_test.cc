@@ -0,0 +1,40 @@
+#include "lib/tiles.h"
+
+#include <vector>
+
+#include "test.h"
+
+using namespace sren;
+
+TEST(TileBinsTest, TileRect_LastTilesAreCutByScreenSize) {
+  TileBins bins{};
+  bins.Resize(100, 70);
+  ASSERT_EQ(bins.tiles_x(), 2);
+  ASSERT_EQ(bins.tiles_y(), 2);
+  ASSERT_EQ(bins.tile_rect(0), Rect(0, 0, 64, 64));
+  ASSERT_EQ(bins.tile_rect(1), Rect(64, 0, 100, 64));
+  ASSERT_EQ(bins.tile_rect(3), Rect(64, 64, 100, 70));
+}
+
+TEST(TileBinsTest, Add_PutsPolygonIntoEveryOverlappedTileInOrder) {
+  TileBins bins{};
+  bins.Resize(200, 200);
+  Polygon p0{};
+  Polygon p1{};
+  bins.Add(&p0, {10, 10, 70, 20});
+  bins.Add(&p1, {-50, -50, 5, 5});
+  ASSERT_EQ(bins.bin(0), (std::vector<Polygon const *>{&p0, &p1}));
+  ASSERT_EQ(bins.bin(1), (std::vector<Polygon const *>{&p0}));
+  ASSERT_TRUE(bins.bin(2).empty());
+  ASSERT_TRUE(bins.bin(4).empty());
+}
+
+TEST(TileBinsTest, Add_IgnoresPolygonOutsideScreen) {
+  TileBins bins{};
+  bins.Resize(128, 128);
+  Polygon p{};
+  bins.Add(&p, {128, 0, 300, 300});
+  for (int i = 0; i < bins.ntiles(); i++) {
+    ASSERT_TRUE(bins.bin(i).empty());
+  }
+}
@@ -0,0 +1,179 @@
+#include "lib/vertex_stream.h"
+
+#include <vector>
+
+#include "lib/clip.h"
+#include "test.h"
+
+using namespace sren;
+
+namespace {
+
+Matrix4x4 TestMatrix() {
+  float m[16] = {
+      0.5f,  1.0f,  0.0f,  0.1f,  // row 0
+      -1.0f, 0.25f, 2.0f,  0.0f,  // row 1
+      0.0f,  3.0f,  -0.5f, 0.2f,  // row 2
+      4.0f,  -2.0f, 1.0f,  1.0f,  // row 3
+  };
+  return Matrix4x4(m);
+}
+
+}  // namespace
+
+TEST(VertexStreamTest, Resize_PadsToLanesWithZero) {
+  VertexStream stream;
+  stream.Resize(3);
+  stream.Set(2, {1, 2, 3, 4});
+  ASSERT_EQ(3, stream.size());
+  ASSERT_EQ(Vector4(1, 2, 3, 4), stream[2]);
+  for (int c = 0; c < 4; c++) {
+    for (int i = 3; i < VertexStream::kLanes; i++) {
+      ASSERT_EQ(0.0f, stream.component(c)[i]);
+    }
+  }
+}
+
+TEST(VertexStreamTest, Transform_AllIsasMatchVectorTimesMatrix) {
+  // 13 个顶点，SIMD 处理整块之后还有剩余
+  std::vector<Vector3> vs;
+  for (int i = 0; i < 13; i++) {
+    vs.emplace_back(i * 0.5f - 3.0f, 1.0f / (i + 1), i * i * 0.1f);
+  }
+  auto const m = TestMatrix();
+  VertexStream src;
+  src.Assign(vs, 1.0f);
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    VertexStream out;
+    src.TransformTo(m, &out, isa);
+    // 原地变换的结果相同
+    auto in_place = src;
+    in_place.Transform(m, isa);
+    ASSERT_EQ(13, out.size());
+    for (int i = 0; i < 13; i++) {
+      auto const expect = Vector4(vs[i], 1.0f) * m;
+      for (int c = 0; c < 4; c++) {
+        ASSERT_FLOAT_EQ(expect[c], out[i][c])
+            << simd::IsaName(isa) << " vertex " << i;
+        ASSERT_EQ(out[i][c], in_place[i][c]);
+      }
+    }
+  }
+}
+
+TEST(VertexStreamTest, Project_MatchesPerVertexTransform) {
+  std::vector<Vector3> vs;
+  for (int i = 0; i < 21; i++) {
+    vs.emplace_back(i * 0.3f - 3.0f, 0.5f - i * 0.05f, i % 3 - 1.0f);
+  }
+  VertexStream model;
+  model.Assign(vs, 1.0f);
+  auto const m = TestMatrix();
+  // 裁剪空间的 z 取世界坐标的 y，y 小于 0 的顶点在近平面之后
+  float p[16] = {
+      1, 0, 0, 0,  // row 0
+      0, 1, 1, 0,  // row 1
+      0, 0, 0, 0,  // row 2
+      0, 0, 0, 1,  // row 3
+  };
+  auto const mvp = m * Matrix4x4(p);
+  ViewportTransform viewport{};
+  viewport.scale = {100.0f, 50.0f, 2.0f};
+  viewport.offset = {110.0f, 60.0f, -1.0f};
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    VertexStream world;
+    VertexStream clip;
+    VertexStream screen;
+    std::vector<unsigned> codes;
+    vertexs::Project(model, m, mvp, viewport, &world, &clip, &screen, &codes,
+                     isa);
+    ASSERT_EQ(21, screen.size());
+    ASSERT_EQ(21u, codes.size());
+    int near = 0;
+    for (int i = 0; i < 21; i++) {
+      auto const v = Vector4(vs[i], 1.0f);
+      auto const c = v * mvp;
+      auto const expect_world = v * m;
+      ASSERT_EQ(clips::Outcode(clip[i]), codes[i]);
+      auto const expect =
+          codes[i] & kClipNear ? clip[i] : viewport.Apply(clip[i]);
+      near += codes[i] & kClipNear ? 1 : 0;
+      for (int k = 0; k < 4; k++) {
+        ASSERT_FLOAT_EQ(c[k], clip[i][k]) << simd::IsaName(isa);
+        ASSERT_FLOAT_EQ(expect_world[k], world[i][k]) << simd::IsaName(isa);
+        // 批量投影与逐个投影的结果逐位相同
+        ASSERT_EQ(expect[k], screen[i][k]) << simd::IsaName(isa);
+      }
+    }
+    ASSERT_GT(near, 0);
+    ASSERT_LT(near, 21);
+  }
+}
+
+TEST(VertexStreamTest, Assemble_SharesVertexsByFaceIndex) {
+  Model model{};
+  model.vertexs() = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}};
+  model.colors() = {colors::Red(), colors::Green(), colors::Blue(),
+                    colors::White()};
+  model.uvs() = {{0, 0}, {1, 1}};
+  model.normals() = {{0, 0, 1}, {0, 0, -1}};
+  // 两个面共用顶点 1 和 2，顶点 2 在第二个面中的纹理坐标不同
+  for (auto const &i : {FaceDataIndex(0, 0, 0), FaceDataIndex(1, 0, 0),
+                        FaceDataIndex(2, 0, 0), FaceDataIndex(1, 0, 0),
+                        FaceDataIndex(3, 1, 1), FaceDataIndex(2, 1, 0)}) {
+    model.face_indexs().push_back(i);
+  }
+  std::vector<FaceDataIndex> unique;
+  std::vector<int> corners;
+  model.UniqueFaceIndexs(&unique, &corners);
+  ASSERT_EQ(5u, unique.size());
+  ASSERT_EQ((std::vector<int>{0, 1, 2, 1, 3, 4}), corners);
+
+  VertexStream screen;
+  screen.Assign(model.vertexs(), 1.0f);
+  screen.Transform(TestMatrix());
+  VertexStream world;
+  world.Assign(model.vertexs(), 1.0f);
+  VertexStream normals;
+  normals.Assign(model.normals(), 0.0f);
+  std::vector<Vertex> out;
+  vertexs::Assemble(unique, screen, world, normals, model, &out);
+  ASSERT_EQ(5u, out.size());
+  for (std::size_t i = 0; i < model.face_indexs().size(); i++) {
+    auto const &index = model.face_indexs()[i];
+    Vertex const expect{screen[index.vertex], world[index.vertex],
+                        model.colors()[index.vertex], model.uvs()[index.uv],
+                        normals[index.normal]};
+    ASSERT_EQ(expect, out[corners[i]]) << i;
+    ASSERT_EQ(expect.world_pos(), out[corners[i]].world_pos()) << i;
+  }
+}
+
+TEST(VertexStreamTest, SignedAreas_AllIsasMatchCrossProduct) {
+  // 19 个面，SIMD 处理整块之后还有剩余
+  std::vector<float> x;
+  std::vector<float> y;
+  for (int i = 0; i < 11; i++) {
+    x.push_back(i * 37 % 11 * 13.5f - 40.0f);
+    y.push_back(i * i % 7 * 21.25f + 0.5f);
+  }
+  std::vector<int> indexs;
+  for (int f = 0; f < 19; f++) {
+    indexs.push_back(f % 11);
+    indexs.push_back((f * 3 + 1) % 11);
+    indexs.push_back((f * 5 + 4) % 11);
+  }
+  for (auto isa : {simd::Isa::kScalar, simd::Isa::kSse2, simd::Isa::kAvx2}) {
+    std::vector<float> areas(19);
+    simd::SignedAreas(x.data(), y.data(), indexs.data(), 19, areas.data(),
+                      isa);
+    for (int f = 0; f < 19; f++) {
+      auto const i = indexs.data() + f * 3;
+      Vector3 const p0{x[i[0]], y[i[0]], 0.0f};
+      Vector3 const p1{x[i[1]], y[i[1]], 0.0f};
+      Vector3 const p2{x[i[2]], y[i[2]], 0.0f};
+      ASSERT_EQ(((p1 - p0) ^ (p2 - p0)).z(), areas[f])
+          << simd::IsaName(isa) << " face " << f;
+    }
+  }
+}